@@ -18,9 +18,9 @@
 #include <FreematicsPlus.h>
 #include <httpd.h>
 #include "config.h"
-#include "mstedarls.h"
-// #include "mptedarls.h"
-#include "mptedarls_cpp.cpp"
+#include "mstedarls_fixed.h"  // src/cpp (build_flags do platformio.ini)
+#include "mptedarls.h"  // src/cpp (build_flags do platformio.ini)
+#include "tedarls_metrics.h"  // src/cpp
 #include "telestore.h"
 #include "teleclient.h"
 #include "telemesh.h"
@@ -112,16 +112,18 @@ const double scale_values[5] = {0.00461173, 0.00015954, 0.00376053, 0.00355971,
 double X[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
 // Output vector
 double output_mstedarls[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+uint32_t flags_mstedarls = 0;
 double output_mptedarls[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+double y_pred_mptedarls[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+int flag_mptedarls = 0;
 
 // Models
 int n_features = 5;
-MSTEDARLS mstedarls(
+MSTEDARLSFixed<5, double> mstedarls(
   8.414,    // threshold
   0.7,      // rls_mu
   1000.0,   // rls_delta
   1.0,      // w_init
-  n_features,
   true      // correct_outlier
 );
 MPTEDARLS mptedarls(
@@ -144,6 +146,12 @@ MPTEDARLS mptedarls(
     false                       // verbose
 );
 
+// Métricas online dos detectores. No veículo não há rótulos: flagged = outliers
+// sinalizados e MAE/RMSE = distorção em relação à entrada. Latência em µs.
+TEDARLSMetrics metrics_mstedarls;
+TEDARLSMetrics metrics_mptedarls;
+#define DETECTOR_METRICS_INTERVAL 600 /* amostras entre resumos no Serial */
+
 
 time_t timestamp;
 long int time_session;
@@ -324,6 +332,17 @@ void printTimeoutStats()
   Serial.println(timeoutsNet);
 }
 
+void printDetectorMetrics()
+{
+  char line[192];
+  metrics_mstedarls.format(line, sizeof(line));
+  Serial.print("[DET] MSTEDARLS ");
+  Serial.println(line);
+  metrics_mptedarls.format(line, sizeof(line));
+  Serial.print("[DET] MPTEDARLS ");
+  Serial.println(line);
+}
+
 void beep(int duration)
 {
     // turn on buzzer at 2000Hz frequency 
@@ -580,34 +599,34 @@ void processOBD(CBuffer* buffer)
 
         if (count_model == 5){
 
-          std::vector<double> x_vec_mstedarls(X, X + n_features);
-
-          // Execução do MSTEDARLS
+          // Execução do MSTEDARLS (sem alocação)
           unsigned long start_time_mstedarls = micros();
-          auto result_mstedarls = mstedarls.update(x_vec_mstedarls);
+          mstedarls.update(X, output_mstedarls, flags_mstedarls);
           unsigned long end_time_mstedarls = micros();
           unsigned long inference_time_mstedarls = end_time_mstedarls - start_time_mstedarls;
 
-          std::vector<double> output_mstedarls = result_mstedarls.first;
-          std::vector<bool> flags_mstedarls = result_mstedarls.second;
-
           // 2. Normaliza entrada para o MPTEDARLS
           double X_norm[5];
           for (int i = 0; i < n_features; ++i)
               X_norm[i] = (X[i] - min_values[i]) * scale_values[i];
 
-          std::vector<double> x_vec(X_norm, X_norm + n_features);
-
-          // Execução do MPTEDARLS com novo formato
+          // Execução do MPTEDARLS (sem alocação; corrige X_norm no lugar)
           unsigned long start_time_mptedarls = micros();
-          MPTEDARLS::RunResult result = mptedarls.run(x_vec);
+          flag_mptedarls = mptedarls.run(X_norm, y_pred_mptedarls, X_norm);
           unsigned long end_time_mptedarls = micros();
           unsigned long inference_time_mptedarls = end_time_mptedarls - start_time_mptedarls;
 
           // 3. Desnormaliza a saída corrigida
-          std::vector<double> output_mptedarls(n_features);
           for (int i = 0; i < n_features; ++i)
-              output_mptedarls[i] = result.x_filtered[i] / scale_values[i] + min_values[i];
+              output_mptedarls[i] = X_norm[i] / scale_values[i] + min_values[i];
+
+          metrics_mstedarls.add_latency(inference_time_mstedarls);
+          metrics_mstedarls.add_detection(flags_mstedarls, 0, n_features);
+          metrics_mstedarls.add_error(output_mstedarls, X, n_features);
+          metrics_mptedarls.add_latency(inference_time_mptedarls);
+          metrics_mptedarls.add_detection(flag_mptedarls != 0, false);
+          metrics_mptedarls.add_error(output_mptedarls, X, n_features);
+          if (metrics_mptedarls.detections() % DETECTOR_METRICS_INTERVAL == 0) printDetectorMetrics();
 
           // 4. Grava os dados no arquivo
           File logFile = SD.open("/data_mstedarls_mptedarls_polo.txt", FILE_APPEND);
@@ -626,7 +645,7 @@ void processOBD(CBuffer* buffer)
 
               // Flags do MSTEDARLS
               for (int i = 0; i < n_features; ++i) {
-                  logFile.print(flags_mstedarls[i] ? 1 : 0); logFile.print(",");
+                  logFile.print((flags_mstedarls >> i) & 1); logFile.print(",");
               }
 
               // Saída do MPTEDARLS
@@ -635,7 +654,7 @@ void processOBD(CBuffer* buffer)
               }
 
               // Flag global do MPTEDARLS
-              logFile.print(result.outlier_flag ? 1 : 0); logFile.print(",");
+              logFile.print(flag_mptedarls ? 1 : 0); logFile.print(",");
 
               // Tempos de inferência
               logFile.print(inference_time_mstedarls); logFile.print(",");
@@ -1473,6 +1492,7 @@ void telemetry(void* inst)
 void standby()
 {
   state.set(STATE_STANDBY);
+  saveDetectorState();
 #if STORAGE != STORAGE_NONE
   if (state.check(STATE_STORAGE_READY)) {
     logger.end();
@@ -1602,6 +1622,50 @@ void loadConfig()
 #endif
 }
 
+/*******************************************************************************
+  Warm restart of the anomaly detectors (state kept in NVS across standby/reboot)
+*******************************************************************************/
+#if __has_include("warmstart_state.h")
+#include "warmstart_state.h"  // gerado por src/cpp/warmstart
+#define HAS_WARMSTART_STATE 1
+#endif
+
+static uint8_t detectorStateBuf[1024];
+
+void saveDetectorState()
+{
+  if (mstedarls.serialized_size() > sizeof(detectorStateBuf) ||
+      mptedarls.serializedSize() > sizeof(detectorStateBuf)) {
+    Serial.println("[DET] State too large");
+    return;
+  }
+  size_t len = mstedarls.serialize(detectorStateBuf);
+  bool ok = nvs_set_blob(nvs, "MST_STATE", detectorStateBuf, len) == ESP_OK;
+  len = mptedarls.serialize(detectorStateBuf);
+  ok = ok && nvs_set_blob(nvs, "MPT_STATE", detectorStateBuf, len) == ESP_OK;
+  ok = ok && nvs_commit(nvs) == ESP_OK;
+  Serial.println(ok ? "[DET] State saved" : "[DET] Error saving state");
+}
+
+void loadDetectorState()
+{
+  size_t len = sizeof(detectorStateBuf);
+  bool mst_ok = nvs_get_blob(nvs, "MST_STATE", detectorStateBuf, &len) == ESP_OK &&
+                mstedarls.deserialize(detectorStateBuf, len);
+  len = sizeof(detectorStateBuf);
+  bool mpt_ok = nvs_get_blob(nvs, "MPT_STATE", detectorStateBuf, &len) == ESP_OK &&
+                mptedarls.deserialize(detectorStateBuf, len);
+#ifdef HAS_WARMSTART_STATE
+  // sem estado salvo (ou inválido): parte do snapshot gerado a partir de viagens anteriores
+  if (!mst_ok) mst_ok = mstedarls.deserialize(warmstart_mst, sizeof(warmstart_mst));
+  if (!mpt_ok) mpt_ok = mptedarls.deserialize(warmstart_mpt, sizeof(warmstart_mpt));
+#endif
+  Serial.print("[DET] MSTEDARLS state:");
+  Serial.println(mst_ok ? "restored" : "fresh");
+  Serial.print("[DET] MPTEDARLS state:");
+  Serial.println(mpt_ok ? "restored" : "fresh");
+}
+
 void processBLE(int timeout)
 {
 #if ENABLE_BLE
@@ -1778,6 +1842,11 @@ void setup()
   // initialize USB serial
   Serial.begin(115200);
 
+  // restore detector state saved before the last standby/reboot
+  if (err == ESP_OK) {
+    loadDetectorState();
+  }
+
   // init LED pin
 #ifdef PIN_LED
   pinMode(PIN_LED, OUTPUT);
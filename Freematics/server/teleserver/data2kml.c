@@ -13,6 +13,7 @@
 #include <math.h>
 #include "logdata.h"
 #include "data2kml.h"
+#include "tripdata.h"
 
 uint16_t hex2uint16(const char *p);
 int ishex(char c);
@@ -257,24 +258,19 @@ void CleanupKML(KML_DATA* kd)
 	kd->cur.next = 0;
 }
 
-int ConvertToKML(KML_DATA* kd, FILE* fp, const char* kmlfile, uint32_t startpos, uint32_t endpos)
+static int OpenKML(KML_DATA* kd, const char* kmlfile)
 {
-	int pid;
-	uint32_t ts = 0;
-	char line[1024];
-
-	if (!kd) return -1;
+	char buf[1024];
 	kd->fp = fopen(kmlfile, "wb");
-	if (!fp || !kd->fp) return -1;
+	if (!kd->fp) return -1;
 	fprintf(stderr, "Opened %s for writing\n", kmlfile);
 
-
 	FILE* fpHeader = fopen("config/kmlstyle.tpl", "rb");
 	if (fpHeader) {
 		for (;;) {
-			int n = fread(line, 1, sizeof(line), fpHeader);
+			int n = fread(buf, 1, sizeof(buf), fpHeader);
 			if (n <= 0) break;
-			fwrite(line, 1, n, kd->fp);
+			fwrite(buf, 1, n, kd->fp);
 		}
 		fclose(fpHeader);
 	}
@@ -283,6 +279,16 @@ int ConvertToKML(KML_DATA* kd, FILE* fp, const char* kmlfile, uint32_t startpos,
 	//fprintf(kd.fp, "%c%c%c", 0xEF, 0xBB, 0xBF);
 
 	fprintf(kd->fp, "<gx:Track>");
+	return 0;
+}
+
+int ConvertToKML(KML_DATA* kd, FILE* fp, const char* kmlfile, uint32_t startpos, uint32_t endpos)
+{
+	int pid;
+	uint32_t ts = 0;
+	char line[1024];
+
+	if (!kd || !fp || OpenKML(kd, kmlfile)) return -1;
 
 	while (fscanf(fp, "%1024s\n", line) > 0) {
 		for (char* p = strtok(line, ","); p; p = strtok(0, ",")) {
@@ -313,3 +319,30 @@ int ConvertToKML(KML_DATA* kd, FILE* fp, const char* kmlfile, uint32_t startpos,
 	WriteKMLTail(kd);
 	return kd->datacount;
 }
+
+static int WriteTripSample(void* arg, const TRIP_SAMPLE* sample)
+{
+	KML_DATA* kd = (KML_DATA*)arg;
+	float value[3];
+	for (int n = 0; n < 3; n++) {
+		value[n] = tripValue(sample, n);
+	}
+	kd->pidMap[sample->pid] = 1;
+	WriteKMLData(kd, sample->ts, sample->pid, value);
+	return 0;
+}
+
+int ConvertTripToKML(KML_DATA* kd, const char* tripfile, const char* kmlfile, uint32_t startpos, uint32_t endpos)
+{
+	TRIP_READER tr;
+	if (!kd || tripOpen(&tr, tripfile) < 0) return -1;
+	if (OpenKML(kd, kmlfile)) {
+		tripRelease(&tr);
+		return -1;
+	}
+	// only blocks in range are read
+	tripRead(&tr, startpos, endpos, 0, WriteTripSample, kd);
+	tripRelease(&tr);
+	WriteKMLTail(kd);
+	return kd->datacount;
+}
@@ -14,6 +14,9 @@
 * THE SOFTWARE.
 ******************************************************************************/
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* recvmmsg/sendmmsg */
+#endif
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/stat.h>
@@ -264,6 +267,14 @@ int mwServerStart(HttpParam* hp)
 	}
 
 	hp->hsSocketQueue = calloc(hp->maxClients, sizeof(HttpSocket));
+	if (hp->udpSocket && hp->pfnUDPDatagram) {
+		hp->udpBuffer = malloc(UDP_BUFFER_SIZE);
+	}
+#ifdef HTTP_EPOLL
+	if (_mwEpollStart(hp)) {
+		SYSLOG(LOG_INFO,"epoll unavailable, using select\n");
+	}
+#endif
 	hp->bKillWebserver=FALSE;
 	hp->bWebserverRunning=TRUE;
 	return 0;
@@ -468,9 +479,389 @@ void _mwCloseAllConnections(HttpParam* hp)
 		if (hp->hsSocketQueue[i].socket) {
 			closesocket(hp->hsSocketQueue[i].socket);
 			hp->hsSocketQueue[i].socket = 0;
+			hp->hsSocketQueue[i].epollEvents = 0;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////
+// _mwPrepareProxy
+// Reconnect the proxy server if needed and fetch data to forward
+// RETURN VALUE: PROXY_WATCH_READ/PROXY_WATCH_WRITE, 0 if not to be watched
+////////////////////////////////////////////////////////////////////////////
+#define PROXY_WATCH_READ 1
+#define PROXY_WATCH_WRITE 2
+
+static int _mwPrepareProxy(HttpParam *hp)
+{
+	int iError = 0;
+	socklen_t iOptSize = sizeof(int);
+
+	if (!(hp->flags & FLAG_ENABLE_PROXY)) return 0;
+	if (getsockopt(hp->proxySocket, SOL_SOCKET, SO_ERROR, (char*)&iError, &iOptSize)) {
+		// if a socket contains a error, close it
+		SYSLOG(LOG_INFO, "[%d] Proxy socket no longer vaild.\n", hp->proxySocket);
+		hp->flags &= ~FLAG_PROXY_CONNECTED;
+	}
+	// proxy enabled
+	if (!(hp->flags & FLAG_PROXY_CONNECTED)) {
+		closesocket(hp->proxySocket);
+		hp->proxySocket = socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(hp->proxySocket, (struct sockaddr*)&hp->proxy_addr, sizeof(hp->proxy_addr)) >= 0) {
+			hp->flags |= FLAG_PROXY_CONNECTED;
+			SYSLOG(LOG_INFO, "[%d] Proxy server reconnected\n", hp->proxySocket);
+		}
+	}
+	if (!(hp->flags & FLAG_PROXY_CONNECTED)) return 0;
+	if (hp->proxyBufferBytes <= 0) {
+		hp->proxyBufferBytes = (*hp->pfnProxyData)(hp, PROXY_DATA_REQUESTED, hp->proxyBuffer, PROXY_TX_BUF_SIZE);
+		if (hp->proxyBufferBytes < 0) {
+			hp->flags &= ~FLAG_PROXY_CONNECTED;
+		}
+	}
+	return hp->proxyBufferBytes > 0 ? PROXY_WATCH_WRITE : PROXY_WATCH_READ;
+}
+
+static void _mwProcessProxy(HttpParam *hp, BOOL bRead, BOOL bWrite)
+{
+	if (bRead) {
+		char data[PROXY_RX_BUF_SIZE];
+		int len = recv(hp->proxySocket, data, sizeof(data) - 1, 0);
+		if (len > 0) {
+			data[len] = 0;
+			(*hp->pfnProxyData)(hp, PROXY_DATA_RECEIVED, data, len);
+		}
+	}
+	if (bWrite) {
+		if (hp->proxyBufferBytes > 0) {
+			if (send(hp->proxySocket, hp->proxyBuffer, hp->proxyBufferBytes, 0) == hp->proxyBufferBytes) {
+				// sent
+				SYSLOG(LOG_INFO, "[%d] %d bytes sent to proxy server\n", hp->proxySocket, hp->proxyBufferBytes);
+				hp->proxyBufferBytes = 0;
+			} else {
+				hp->flags &= ~FLAG_PROXY_CONNECTED;
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////
+// _mwProcessUDP
+// Handle incoming UDP datagrams
+// With pfnUDPDatagram set, datagrams are received and replied in batches
+// until the socket is drained or UDP_MAX_BATCHES batches were handled, in
+// which case udpPending is left set.
+////////////////////////////////////////////////////////////////////////////
+static void _mwProcessUDP(HttpParam *hp)
+{
+#ifdef __linux__
+	struct mmsghdr msgs[UDP_BATCH_SIZE];
+	struct mmsghdr replies[UDP_BATCH_SIZE];
+	struct iovec iovs[UDP_BATCH_SIZE];
+	struct iovec replyIovs[UDP_BATCH_SIZE];
+	struct sockaddr_in peers[UDP_BATCH_SIZE];
+	int batch, i, n, replyCount, sent;
+#else
+	struct sockaddr_in peer;
+	socklen_t socklen = sizeof(peer);
+	char* reply = hp->udpBuffer + UDP_DATAGRAM_SIZE;
+	int len;
+#endif
+
+	hp->udpPending = FALSE;
+	if (!hp->pfnUDPDatagram || !hp->udpBuffer) {
+		if (hp->pfnIncomingUDP) hp->pfnIncomingUDP(hp);
+		return;
+	}
+
+#ifdef __linux__
+	// first half of udpBuffer holds the received datagrams, second half the replies
+	for (batch = 0; batch < UDP_MAX_BATCHES; batch++) {
+		memset(msgs, 0, sizeof(msgs));
+		for (i = 0; i < UDP_BATCH_SIZE; i++) {
+			iovs[i].iov_base = hp->udpBuffer + i * UDP_DATAGRAM_SIZE;
+			iovs[i].iov_len = UDP_DATAGRAM_SIZE - 1;
+			msgs[i].msg_hdr.msg_name = peers + i;
+			msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			msgs[i].msg_hdr.msg_iov = iovs + i;
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		n = recvmmsg(hp->udpSocket, msgs, UDP_BATCH_SIZE, MSG_DONTWAIT, NULL);
+		if (n <= 0) return;
+
+		memset(replies, 0, sizeof(replies));
+		replyCount = 0;
+		for (i = 0; i < n; i++) {
+			char* data = iovs[i].iov_base;
+			char* reply = hp->udpBuffer + (UDP_BATCH_SIZE + replyCount) * UDP_DATAGRAM_SIZE;
+			int len = msgs[i].msg_len;
+			data[len] = 0;
+			len = (*hp->pfnUDPDatagram)(hp, data, len, peers + i, reply, UDP_DATAGRAM_SIZE);
+			if (len > 0) {
+				replyIovs[replyCount].iov_base = reply;
+				replyIovs[replyCount].iov_len = len;
+				replies[replyCount].msg_hdr.msg_name = peers + i;
+				replies[replyCount].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+				replies[replyCount].msg_hdr.msg_iov = replyIovs + replyCount;
+				replies[replyCount].msg_hdr.msg_iovlen = 1;
+				replyCount++;
+			}
+		}
+		for (i = 0; i < replyCount; i += sent) {
+			sent = sendmmsg(hp->udpSocket, replies + i, replyCount - i, 0);
+			if (sent <= 0) {
+				SYSLOG(LOG_INFO, "%d UDP replies unsent\n", replyCount - i);
+				break;
+			}
+		}
+		// a short batch means the socket is drained
+		if (n < UDP_BATCH_SIZE) return;
+	}
+	hp->udpPending = TRUE;
+#else
+	if ((len = recvfrom(hp->udpSocket, hp->udpBuffer, UDP_DATAGRAM_SIZE - 1, 0, (struct sockaddr *)&peer, &socklen)) <= 0)
+		return;
+	hp->udpBuffer[len] = 0;
+	len = (*hp->pfnUDPDatagram)(hp, hp->udpBuffer, len, &peer, reply, UDP_DATAGRAM_SIZE);
+	if (len > 0 && sendto(hp->udpSocket, reply, len, 0, (struct sockaddr *)&peer, socklen) != len) {
+		SYSLOG(LOG_INFO, "UDP reply unsent\n");
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////
+// _mwProcessSocket
+// Process a read/write able client socket
+////////////////////////////////////////////////////////////////////////////
+static void _mwProcessSocket(HttpParam *hp, HttpSocket *phsSocketCur, BOOL bRead, BOOL bWrite)
+{
+	int iRc = -1;
+	if (ISFLAGSET(phsSocketCur,FLAG_SENDING) && bWrite) {
+		iRc=_mwProcessWriteSocket(hp, phsSocketCur);
+	} else if (bRead) {
+		SETFLAG(phsSocketCur, FLAG_RECEIVING);
+		iRc=_mwProcessReadSocket(hp,phsSocketCur);
+	}
+	if (iRc == 0) {
+		// reset expiration timer
+		phsSocketCur->tmExpirationTime = time(NULL) + HTTP_EXPIRATION_TIME;
+	} else {
+		if (iRc == -1) {
+			SETFLAG(phsSocketCur, FLAG_CONN_CLOSE);
+		}
+		_mwCloseSocket(hp, phsSocketCur);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////
+// _mwAcceptConnection
+// Accept a pending connection into a free (or the longest idle) slot
+// RETURN VALUE: the socket slot, NULL if nothing accepted
+////////////////////////////////////////////////////////////////////////////
+static HttpSocket* _mwAcceptConnection(HttpParam *hp)
+{
+	HttpSocket *phsSocketCur = 0;
+	struct sockaddr_in sinaddr;
+	int i;
+
+	// find empty slot
+	for (i = 0; i < hp->maxClients; i++) {
+		if (hp->hsSocketQueue[i].socket == 0) {
+			phsSocketCur = hp->hsSocketQueue + i;
+			break;
+		}
+	}
+
+	if (!phsSocketCur) {
+		// all slots occupied
+		// find longest waiting idle socket and close it
+		time_t earliest = 0;
+		for (i = 0; i < hp->maxClients; i++) {
+			if (!ISFLAGSET((hp->hsSocketQueue + i), FLAG_RECEIVING | FLAG_SENDING)
+				&& (earliest == 0 || hp->hsSocketQueue[i].tmExpirationTime < earliest)) {
+				phsSocketCur = hp->hsSocketQueue + i;
+				earliest = hp->hsSocketQueue[i].tmExpirationTime;
+			}
+		}
+		if (!phsSocketCur) {
+		    SYSLOG(LOG_INFO,"Connection denied\n");
+			return 0;
+		} else {
+			SETFLAG(phsSocketCur, FLAG_CONN_CLOSE);
+			_mwCloseSocket(hp, phsSocketCur);
+		}
+	}
+
+	phsSocketCur->socket = _mwAcceptSocket(hp,&sinaddr);
+	if (phsSocketCur->socket <= 0) {
+		phsSocketCur->socket = 0;
+		return 0;
+	}
+	phsSocketCur->ipAddr.laddr=ntohl(sinaddr.sin_addr.s_addr);
+	SYSLOG(LOG_INFO,"[%d] Client: %d.%d.%d.%d\n",
+		phsSocketCur->socket,
+		phsSocketCur->ipAddr.caddr[3],
+		phsSocketCur->ipAddr.caddr[2],
+		phsSocketCur->ipAddr.caddr[1],
+		phsSocketCur->ipAddr.caddr[0]);
+
+	hp->stats.clientCount++;
+
+	//fill structure with data
+	_mwInitSocketData(phsSocketCur);
+	phsSocketCur->tmExpirationTime = time(NULL) + HTTP_EXPIRATION_TIME;
+
+	//update max client count
+	if (hp->stats.clientCount>hp->stats.clientCountMax) hp->stats.clientCountMax=hp->stats.clientCount;
+	return phsSocketCur;
+}
+
+#ifdef HTTP_EPOLL
+////////////////////////////////////////////////////////////////////////////
+// epoll event loop
+// Client sockets are registered with their slot index as event data and
+// stay level triggered, as a read/write event is served with one recv/send;
+// their interest (EPOLLIN or EPOLLOUT) follows FLAG_SENDING. The UDP socket
+// is edge triggered when datagrams are handled in batches, as _mwProcessUDP
+// drains it. Closing a socket removes it from the epoll set.
+////////////////////////////////////////////////////////////////////////////
+#define EPOLL_TAG_LISTEN ((uint64_t)-1)
+#define EPOLL_TAG_UDP ((uint64_t)-2)
+#define EPOLL_TAG_PROXY ((uint64_t)-3)
+#define EPOLL_TAG_NOTIFY ((uint64_t)-4)
+
+static int _mwEpollAdd(HttpParam *hp, int fd, uint32_t events, uint64_t tag)
+{
+	struct epoll_event ev;
+	ev.events = events;
+	ev.data.u64 = tag;
+	return epoll_ctl(hp->epollFd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int _mwEpollStart(HttpParam *hp)
+{
+	hp->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (hp->epollFd <= 0) {
+		hp->epollFd = 0;
+		return -1;
+	}
+	if (_mwEpollAdd(hp, hp->listenSocket, EPOLLIN, EPOLL_TAG_LISTEN) == 0
+		&& (!hp->udpSocket || _mwEpollAdd(hp, hp->udpSocket, hp->pfnUDPDatagram ? EPOLLIN | EPOLLET : EPOLLIN, EPOLL_TAG_UDP) == 0)
+		&& (!hp->notifyFd || _mwEpollAdd(hp, hp->notifyFd, EPOLLIN, EPOLL_TAG_NOTIFY) == 0)) {
+		return 0;
+	}
+	close(hp->epollFd);
+	hp->epollFd = 0;
+	return -1;
+}
+
+static void _mwEpollUpdate(HttpParam *hp, HttpSocket *phsSocket)
+{
+	struct epoll_event ev;
+	uint32_t events;
+
+	if (!phsSocket->socket) return;
+	events = ISFLAGSET(phsSocket, FLAG_SENDING) ? EPOLLOUT : EPOLLIN;
+	if (events == phsSocket->epollEvents) return;
+	ev.events = events;
+	ev.data.u64 = (uint64_t)(phsSocket - hp->hsSocketQueue);
+	if (epoll_ctl(hp->epollFd, phsSocket->epollEvents ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, phsSocket->socket, &ev)) {
+		SYSLOG(LOG_INFO, "[%d] Unable to watch socket\n", phsSocket->socket);
+		SETFLAG(phsSocket, FLAG_CONN_CLOSE);
+		_mwCloseSocket(hp, phsSocket);
+		return;
+	}
+	phsSocket->epollEvents = events;
+}
+
+static void _mwEpollProxy(HttpParam *hp, int watch)
+{
+	struct epoll_event ev;
+
+	// the proxy socket may have been replaced on reconnection, so fall back to adding it
+	ev.events = watch == PROXY_WATCH_WRITE ? EPOLLOUT : EPOLLIN;
+	ev.data.u64 = EPOLL_TAG_PROXY;
+	if (!watch) {
+		epoll_ctl(hp->epollFd, EPOLL_CTL_DEL, hp->proxySocket, &ev);
+	} else if (epoll_ctl(hp->epollFd, EPOLL_CTL_MOD, hp->proxySocket, &ev) && errno == ENOENT) {
+		epoll_ctl(hp->epollFd, EPOLL_CTL_ADD, hp->proxySocket, &ev);
+	}
+}
+
+static void _mwHttpLoopEpoll(HttpParam *hp, uint32_t timeout)
+{
+	struct epoll_event events[HTTP_EPOLL_EVENTS];
+	HttpSocket *phsSocketCur;
+	time_t tmCurrentTime;
+	BOOL bAccept = FALSE;
+	BOOL bNotify = FALSE;
+	int i, n;
+
+	if (hp->flags & FLAG_ENABLE_PROXY) {
+		_mwEpollProxy(hp, _mwPrepareProxy(hp));
+	}
+
+	// don't wait if datagrams were left over from the last round
+	n = epoll_wait(hp->epollFd, events, HTTP_EPOLL_EVENTS, hp->udpPending ? 0 : (int)timeout);
+
+	// close timed out sockets, once a second is fine enough
+	tmCurrentTime = time(NULL);
+	if (tmCurrentTime != hp->tmLastExpiryCheck) {
+		hp->tmLastExpiryCheck = tmCurrentTime;
+		for (i = 0; i < hp->maxClients; i++) {
+			phsSocketCur = hp->hsSocketQueue + i;
+			if (phsSocketCur->socket && tmCurrentTime > phsSocketCur->tmExpirationTime) {
+				SETFLAG(phsSocketCur, FLAG_CONN_CLOSE);
+				_mwCloseSocket(hp, phsSocketCur);
+			}
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		uint64_t tag = events[i].data.u64;
+		uint32_t ev = events[i].events;
+		if (tag == EPOLL_TAG_LISTEN) {
+			bAccept = TRUE;
+		} else if (tag == EPOLL_TAG_UDP) {
+			hp->udpPending = TRUE;
+		} else if (tag == EPOLL_TAG_NOTIFY) {
+			bNotify = TRUE;
+		} else if (tag == EPOLL_TAG_PROXY) {
+			if (ev & (EPOLLERR | EPOLLHUP)) {
+				hp->flags &= ~FLAG_PROXY_CONNECTED;
+			} else if (hp->pfnProxyData) {
+				_mwProcessProxy(hp, (ev & EPOLLIN) != 0, (ev & EPOLLOUT) != 0);
+			}
+		} else if (tag < hp->maxClients) {
+			phsSocketCur = hp->hsSocketQueue + tag;
+			if (!phsSocketCur->socket) continue;
+			if ((ev & (EPOLLERR | EPOLLHUP)) && !(ev & (EPOLLIN | EPOLLOUT))) {
+				SYSLOG(LOG_INFO,"[%d] Socket no longer vaild.\n",phsSocketCur->socket);
+				SETFLAG(phsSocketCur, FLAG_CONN_CLOSE);
+				_mwCloseSocket(hp, phsSocketCur);
+				continue;
+			}
+			_mwProcessSocket(hp, phsSocketCur, (ev & EPOLLIN) != 0, (ev & EPOLLOUT) != 0);
+			_mwEpollUpdate(hp, phsSocketCur);
+		}
+	}
+
+	if (hp->udpPending) {
+		_mwProcessUDP(hp);
+	}
+
+	if (bNotify && hp->pfnNotify) {
+		(*hp->pfnNotify)(hp);
+	}
+
+	if (bAccept) {
+		// the listen socket is level triggered, what is left is accepted next round
+		for (i = 0; i < HTTP_EPOLL_EVENTS && (phsSocketCur = _mwAcceptConnection(hp)); i++) {
+			_mwEpollUpdate(hp, phsSocketCur);
 		}
 	}
 }
+#endif
 
 ////////////////////////////////////////////////////////////////////////////
 // _mwHttpThread
@@ -480,15 +871,22 @@ void mwHttpLoop(HttpParam *hp, uint32_t timeout)
 {
 	HttpSocket *phsSocketCur;
 	SOCKET sock;
-	struct sockaddr_in sinaddr;
 	int iRc;
 	int i;
+	int proxyWatch;
 
 	time_t tmCurrentTime;
 	SOCKET iSelectMaxFds;
 	fd_set fdsSelectRead;
 	fd_set fdsSelectWrite;
 
+#ifdef HTTP_EPOLL
+	if (hp->epollFd) {
+		_mwHttpLoopEpoll(hp, timeout);
+		return;
+	}
+#endif
+
 	// clear descriptor sets
 	FD_ZERO(&fdsSelectRead);
 	FD_ZERO(&fdsSelectWrite);
@@ -499,38 +897,19 @@ void mwHttpLoop(HttpParam *hp, uint32_t timeout)
 		FD_SET(hp->udpSocket, &fdsSelectRead);
 		if (hp->udpSocket > iSelectMaxFds) iSelectMaxFds = hp->udpSocket;
 	}
-	if (hp->flags & FLAG_ENABLE_PROXY) {
-		int iError = 0;
-		socklen_t iOptSize = sizeof(int);
-		if (getsockopt(hp->proxySocket, SOL_SOCKET, SO_ERROR, (char*)&iError, &iOptSize)) {
-			// if a socket contains a error, close it
-			SYSLOG(LOG_INFO, "[%d] Proxy socket no longer vaild.\n", hp->proxySocket);
-			hp->flags &= ~FLAG_PROXY_CONNECTED;
-		}
-		// proxy enabled
-		if (!(hp->flags & FLAG_PROXY_CONNECTED)) {
-			closesocket(hp->proxySocket);
-			hp->proxySocket = socket(AF_INET, SOCK_STREAM, 0);
-			if (connect(hp->proxySocket, (struct sockaddr*)&hp->proxy_addr, sizeof(hp->proxy_addr)) >= 0) {
-				hp->flags |= FLAG_PROXY_CONNECTED;
-				SYSLOG(LOG_INFO, "[%d] Proxy server reconnected\n", hp->proxySocket);
-			}
+	if (hp->notifyFd) {
+		FD_SET(hp->notifyFd, &fdsSelectRead);
+		if (hp->notifyFd > iSelectMaxFds) iSelectMaxFds = hp->notifyFd;
+	}
+	proxyWatch = _mwPrepareProxy(hp);
+	if (proxyWatch) {
+		if (proxyWatch == PROXY_WATCH_WRITE) {
+			FD_SET(hp->proxySocket, &fdsSelectWrite);
 		}
-		if (hp->flags & FLAG_PROXY_CONNECTED) {
-			if (hp->proxyBufferBytes <= 0) {
-				hp->proxyBufferBytes = (*hp->pfnProxyData)(hp, PROXY_DATA_REQUESTED, hp->proxyBuffer, PROXY_TX_BUF_SIZE);
-				if (hp->proxyBufferBytes < 0) {
-					hp->flags &= ~FLAG_PROXY_CONNECTED;
-				}
-			}
-			if (hp->proxyBufferBytes > 0) {
-				FD_SET(hp->proxySocket, &fdsSelectWrite);
-			}
-			else {
-				FD_SET(hp->proxySocket, &fdsSelectRead);
-			}
-			if (hp->proxySocket > iSelectMaxFds) iSelectMaxFds = hp->proxySocket;
+		else {
+			FD_SET(hp->proxySocket, &fdsSelectRead);
 		}
+		if (hp->proxySocket > iSelectMaxFds) iSelectMaxFds = hp->proxySocket;
 	}
 
 	// get current time
@@ -549,7 +928,7 @@ void mwHttpLoop(HttpParam *hp, uint32_t timeout)
 			if (getsockopt(sock,SOL_SOCKET,SO_ERROR,(char*)&iError,&iOptSize)) {
 				// if a socket contains a error, close it
 				SYSLOG(LOG_INFO,"[%d] Socket no longer vaild.\n",sock);
-				phsSocketCur->flags=FLAG_CONN_CLOSE;
+				SETFLAG(phsSocketCur, FLAG_CONN_CLOSE);
 				_mwCloseSocket(hp, phsSocketCur);
 				continue;
 			}
@@ -557,7 +936,7 @@ void mwHttpLoop(HttpParam *hp, uint32_t timeout)
 		// check expiration timer (for non-listening, in-use sockets)
 		if (tmCurrentTime > phsSocketCur->tmExpirationTime) {
 			// close connection
-			phsSocketCur->flags=FLAG_CONN_CLOSE;
+			SETFLAG(phsSocketCur, FLAG_CONN_CLOSE);
 			_mwCloseSocket(hp, phsSocketCur);
 		} else {
 			if (ISFLAGSET(phsSocketCur,FLAG_SENDING)) {
@@ -591,30 +970,16 @@ void mwHttpLoop(HttpParam *hp, uint32_t timeout)
 
 	// check if any udp socket to read
 	if (hp->udpSocket && FD_ISSET(hp->udpSocket, &fdsSelectRead)) {
-		hp->pfnIncomingUDP(hp);
+		_mwProcessUDP(hp);
+	}
+
+	if (hp->notifyFd && FD_ISSET(hp->notifyFd, &fdsSelectRead) && hp->pfnNotify) {
+		(*hp->pfnNotify)(hp);
 	}
 
 	// check proxy server
-	if ((hp->flags & FLAG_ENABLE_PROXY) && hp->pfnProxyData) {
-		if (FD_ISSET(hp->proxySocket, &fdsSelectRead)) {
-			char data[PROXY_RX_BUF_SIZE];
-			int len = recv(hp->proxySocket, data, sizeof(data) - 1, 0);
-			if (len > 0) {
-				data[len] = 0;
-				(*hp->pfnProxyData)(hp, PROXY_DATA_RECEIVED, data, len);
-			}
-		}
-		if (FD_ISSET(hp->proxySocket, &fdsSelectWrite)) {
-			if (hp->proxyBufferBytes > 0) {
-				if (send(hp->proxySocket, hp->proxyBuffer, hp->proxyBufferBytes, 0) == hp->proxyBufferBytes) {
-					// sent
-					SYSLOG(LOG_INFO, "[%d] %d bytes sent to proxy server\n", hp->proxySocket, hp->proxyBufferBytes);
-					hp->proxyBufferBytes = 0;
-				} else {
-					hp->flags &= ~FLAG_PROXY_CONNECTED;
-				}
-			}
-		}
+	if (proxyWatch && hp->pfnProxyData) {
+		_mwProcessProxy(hp, FD_ISSET(hp->proxySocket, &fdsSelectRead), FD_ISSET(hp->proxySocket, &fdsSelectWrite));
 	}
 
 	// check which sockets are read/write able
@@ -633,76 +998,14 @@ void mwHttpLoop(HttpParam *hp, uint32_t timeout)
 		bWrite = FD_ISSET(sock, &fdsSelectWrite);
 
 		if (bRead || bWrite) {
-			iRc = -1;
-			if (ISFLAGSET(phsSocketCur,FLAG_SENDING) && bWrite) {
-				iRc=_mwProcessWriteSocket(hp, phsSocketCur);
-			} else if (bRead) {
-				SETFLAG(phsSocketCur, FLAG_RECEIVING);
-				iRc=_mwProcessReadSocket(hp,phsSocketCur);
-			}
-			if (iRc == 0) {
-				// reset expiration timer
-				phsSocketCur->tmExpirationTime = time(NULL) + HTTP_EXPIRATION_TIME;
-			} else {
-				if (iRc == -1) {
-					SETFLAG(phsSocketCur, FLAG_CONN_CLOSE);
-				}
-				_mwCloseSocket(hp, phsSocketCur);
-			}
+			_mwProcessSocket(hp, phsSocketCur, bRead, bWrite);
 		}
 	}
 
 	// check if any socket to accept and accept the socket
-	if (FD_ISSET(hp->listenSocket, &fdsSelectRead)) do {
-		// find empty slot
-		phsSocketCur = 0;
-		for (i = 0; i < hp->maxClients; i++) {
-			if (hp->hsSocketQueue[i].socket == 0) {
-				phsSocketCur = hp->hsSocketQueue + i;
-				break;
-			}
-		}
-
-		if (!phsSocketCur) {
-			// all slots occupied
-			// find longest waiting idle socket and close it
-			time_t earliest = 0;
-			for (i = 0; i < hp->maxClients; i++) {
-				if (!ISFLAGSET((hp->hsSocketQueue + i), FLAG_RECEIVING | FLAG_SENDING)
-					&& (earliest == 0 || hp->hsSocketQueue[i].tmExpirationTime < earliest)) {
-					phsSocketCur = hp->hsSocketQueue + i;
-					earliest = hp->hsSocketQueue[i].tmExpirationTime;
-				}
-			}
-			if (!phsSocketCur) {
-			    SYSLOG(LOG_INFO,"Connection denied\n");
-				break;
-			} else {
-				SETFLAG(phsSocketCur, FLAG_CONN_CLOSE);
-				_mwCloseSocket(hp, phsSocketCur);
-			}
-		}
-
-		phsSocketCur->socket = _mwAcceptSocket(hp,&sinaddr);
-		if (phsSocketCur->socket == 0)
-			break;
-		phsSocketCur->ipAddr.laddr=ntohl(sinaddr.sin_addr.s_addr);
-		SYSLOG(LOG_INFO,"[%d] Client: %d.%d.%d.%d\n",
-			phsSocketCur->socket,
-			phsSocketCur->ipAddr.caddr[3],
-			phsSocketCur->ipAddr.caddr[2],
-			phsSocketCur->ipAddr.caddr[1],
-			phsSocketCur->ipAddr.caddr[0]);
-
-		hp->stats.clientCount++;
-
-		//fill structure with data
-		_mwInitSocketData(phsSocketCur);
-		phsSocketCur->tmExpirationTime = time(NULL) + HTTP_EXPIRATION_TIME;
-
-		//update max client count
-		if (hp->stats.clientCount>hp->stats.clientCountMax) hp->stats.clientCountMax=hp->stats.clientCount;
-	} while(0);
+	if (FD_ISSET(hp->listenSocket, &fdsSelectRead)) {
+		_mwAcceptConnection(hp);
+	}
 } // end of _mwHttpThread
 
 void mwServerExit(HttpParam* hp)
@@ -721,6 +1024,16 @@ void mwServerExit(HttpParam* hp)
 		free(hp->proxyBuffer);
 		hp->proxyBuffer = 0;
 	}
+	if (hp->udpBuffer) {
+		free(hp->udpBuffer);
+		hp->udpBuffer = 0;
+	}
+#ifdef HTTP_EPOLL
+	if (hp->epollFd) {
+		close(hp->epollFd);
+		hp->epollFd = 0;
+	}
+#endif
 
 	// clear state vars
 	hp->bKillWebserver = FALSE;
@@ -788,7 +1101,7 @@ int _mwBuildHttpHeader(HttpParam* hp, HttpSocket *phsSocket, time_t contentDateT
 	if (phsSocket->request.iCSeq) {
 		p += snprintf(p, end - p, "CSeq: %d\r\n", phsSocket->request.iCSeq);
 	}
-	if (phsSocket->response.contentLength > 0) {
+	if (phsSocket->response.contentLength > 0 || ISFLAGSET(phsSocket, FLAG_DATA_STREAM)) {
 		p += snprintf(p, end - p, "Content-Type: %s\r\n", phsSocket->mimeType ? phsSocket->mimeType : contentTypeTable[phsSocket->response.fileType]);
 		if (phsSocket->request.startByte) {
 			p += snprintf(p, end - p, "Content-Range: bytes %u-%u/*\r\n",
@@ -796,7 +1109,10 @@ int _mwBuildHttpHeader(HttpParam* hp, HttpSocket *phsSocket, time_t contentDateT
 		}
 	}
 	if (!(phsSocket->flags & FLAG_CHUNK)) {
-		p+=snprintf(p, end - p,"Content-Length: %u\r\n", phsSocket->response.contentLength);
+		// an unchunked stream ends when the connection is closed
+		if (!ISFLAGSET(phsSocket, FLAG_DATA_STREAM)) {
+			p+=snprintf(p, end - p,"Content-Length: %u\r\n", phsSocket->response.contentLength);
+		}
 	} else {
 		p += sprintf(p, "Transfer-Encoding: chunked\r\n");
 	}
@@ -1200,6 +1516,9 @@ int _mwProcessReadSocket(HttpParam* hp, HttpSocket* phsSocket)
 	if (phsSocket->request.iHttpVer == 0) {
 		CLRFLAG(phsSocket, FLAG_CHUNK);
 	}
+	if (ISFLAGSET(phsSocket, FLAG_DATA_STREAM) && !ISFLAGSET(phsSocket, FLAG_CHUNK)) {
+		SETFLAG(phsSocket, FLAG_CONN_CLOSE);
+	}
 	if (ISFLAGSET(phsSocket,FLAG_DATA_RAW | FLAG_DATA_STREAM)) {
 		SETFLAG(phsSocket,FLAG_SENDING);
 		return _mwStartSendRawData(hp, phsSocket);
@@ -1282,6 +1601,7 @@ void _mwCloseSocket(HttpParam* hp, HttpSocket* phsSocket)
 	SYSLOG(LOG_INFO,"[%d] Socket closed, %u connections\n",phsSocket->socket, hp->stats.clientCount);
 	phsSocket->socket = 0;
 	phsSocket->reqCount=0;
+	phsSocket->epollEvents = 0;
 } // end of _mwCloseSocket
 
 void _mwSetSocketOpts(SOCKET socket)
@@ -1522,12 +1842,38 @@ int _mwSendFileChunk(HttpParam *hp, HttpSocket* phsSocket)
 	return 0;
 } // end of _mwSendFileChunk
 
+////////////////////////////////////////////////////////////////////////////
+// _mwSetStreamData
+// Queue a piece of stream data for sending, framed as one chunk if chunked
+// (needs HTTP_CHUNK_HEAD_SIZE bytes before data and 2 bytes after it)
+////////////////////////////////////////////////////////////////////////////
+static void _mwSetStreamData(HttpSocket* phsSocket, char* data, uint32_t len)
+{
+	if ((phsSocket->flags & FLAG_CHUNK) && len > 0) {
+		char head[HTTP_CHUNK_HEAD_SIZE + 1];
+		int bytes = snprintf(head, sizeof(head), "%x\r\n", len);
+		data -= bytes;
+		memcpy(data, head, bytes);
+		memcpy(data + bytes + len, "\r\n", 2);
+		len += bytes + 2;
+	}
+	phsSocket->pucData = data;
+	phsSocket->contentLength = len;
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // _mwStartSendRawData
 // Start sending raw data blocks
 ////////////////////////////////////////////////////////////////////////////
 int _mwStartSendRawData(HttpParam *hp, HttpSocket* phsSocket)
 {
+	if (ISFLAGSET(phsSocket, FLAG_DATA_STREAM) && (phsSocket->flags & FLAG_CHUNK) && phsSocket->contentLength > 0) {
+		// move data returned with the request into place for chunk framing
+		uint32_t len = phsSocket->contentLength;
+		if (len > HTTP_BUFFER_SIZE - HTTP_CHUNK_HEAD_SIZE - 2) len = HTTP_BUFFER_SIZE - HTTP_CHUNK_HEAD_SIZE - 2;
+		memmove(phsSocket->buffer + HTTP_CHUNK_HEAD_SIZE, phsSocket->pucData, len);
+		_mwSetStreamData(phsSocket, phsSocket->buffer + HTTP_CHUNK_HEAD_SIZE, len);
+	}
 	if (ISFLAGSET(phsSocket, FLAG_CUSTOM_HEADER)) {
 		return _mwSendRawDataChunk(hp, phsSocket);
 	} else {
@@ -1558,26 +1904,7 @@ int _mwSendRawDataChunk(HttpParam *hp, HttpSocket* phsSocket)
 {
 	int  iBytesWritten = 0;
 
-	if (phsSocket->flags & FLAG_CHUNK) {
-		char buf[16];
-		int bytes = snprintf(buf, sizeof(buf), "%x\r\n", phsSocket->contentLength);
-		iBytesWritten = send(phsSocket->socket, buf, bytes, 0);
-		if (iBytesWritten<=0) return -1;
-		hp->stats.totalSentBytes+=iBytesWritten;
-	}
-    // send a chunk of data
-	if (phsSocket->contentLength > 0) {
-		iBytesWritten=(int)send(phsSocket->socket, phsSocket->pucData, phsSocket->contentLength, 0);
-		if (iBytesWritten<=0) {
-			// failure - close connection
-			return -1;
-		} else {
-			hp->stats.totalSentBytes+=iBytesWritten;
-			phsSocket->response.sentBytes+=iBytesWritten;
-			phsSocket->pucData+=iBytesWritten;
-			phsSocket->contentLength-=iBytesWritten;
-		}
-	} else {
+	if (phsSocket->contentLength == 0) {
 		if (ISFLAGSET(phsSocket,FLAG_DATA_STREAM) && phsSocket->handler) {
 			//load next chuck of raw data
 			UrlHandlerParam up;
@@ -1585,19 +1912,21 @@ int _mwSendRawDataChunk(HttpParam *hp, HttpSocket* phsSocket)
 			memset(&up, 0, sizeof(up));
 			up.hs = phsSocket;
 			up.hp = hp;
-			up.pucBuffer=phsSocket->buffer;
-			up.bufSize=HTTP_BUFFER_SIZE;
+			up.pucBuffer=phsSocket->buffer + HTTP_CHUNK_HEAD_SIZE;
+			up.bufSize=HTTP_BUFFER_SIZE - HTTP_CHUNK_HEAD_SIZE - 2;
 			if ((pfnHandler->pfnUrlHandler)(&up) == 0) {
 				if (phsSocket->flags & FLAG_CHUNK) {
 					iBytesWritten = send(phsSocket->socket, "0\r\n\r\n", 5, 0);
 					if (iBytesWritten<=0) return -1;
+					hp->stats.totalSentBytes+=iBytesWritten;
+				} else {
+					SETFLAG(phsSocket, FLAG_CONN_CLOSE);
 				}
-				hp->stats.totalSentBytes+=iBytesWritten;
-				SETFLAG(phsSocket, FLAG_CONN_CLOSE);
 				return 1;	// EOF
 			}
-			phsSocket->contentLength = up.contentLength;
-			phsSocket->pucData = up.pucBuffer;
+			if (up.contentLength > up.bufSize) up.contentLength = up.bufSize;
+			_mwSetStreamData(phsSocket, up.pucBuffer, up.contentLength);
+			if (phsSocket->contentLength == 0) return 0;
 		} else {
 			if (phsSocket->flags & FLAG_CHUNK) {
 				iBytesWritten = send(phsSocket->socket, "0\r\n\r\n", 5, 0);
@@ -1607,6 +1936,16 @@ int _mwSendRawDataChunk(HttpParam *hp, HttpSocket* phsSocket)
 			return 1;
 		}
 	}
+	// send a chunk of data
+	iBytesWritten=(int)send(phsSocket->socket, phsSocket->pucData, phsSocket->contentLength, 0);
+	if (iBytesWritten<=0) {
+		// failure - close connection
+		return -1;
+	}
+	hp->stats.totalSentBytes+=iBytesWritten;
+	phsSocket->response.sentBytes+=iBytesWritten;
+	phsSocket->pucData+=iBytesWritten;
+	phsSocket->contentLength-=iBytesWritten;
 	return 0;
 } // end of _mwSendRawDataChunk
 
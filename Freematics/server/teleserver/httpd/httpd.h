@@ -95,6 +95,10 @@ typedef enum {
 #define FLAG_DATA_FILE		0x10000
 #define FLAG_DATA_RAW		0x20000
 #define FLAG_DATA_REDIRECT	0x80000
+// the handler is called again with the socket flagged FLAG_DATA_STREAM to fill
+// pucBuffer with the next piece of data until it returns 0, and once more with
+// a NULL pucBuffer when the connection is done; pieces go out as chunks with
+// FLAG_CHUNK, otherwise the connection is closed at the end of data
 #define FLAG_DATA_STREAM	0x100000
 #define FLAG_CUSTOM_HEADER	0x200000
 #define FLAG_MULTIPART		0x400000
@@ -175,6 +179,7 @@ typedef struct _HttpSocket{
 	char* mimeType;
 	char* buffer;
 	uint16_t reqCount;
+	uint32_t epollEvents;			// events registered with epoll, 0 if not registered
 } HttpSocket;
 
 typedef struct {
@@ -195,7 +200,9 @@ typedef struct {
 // Callback function protos
 typedef int (*PFNURLCALLBACK)(UrlHandlerParam*);
 typedef int (*PFN_UDP_CALLBACK)(void* hp);
+typedef int (*PFN_UDP_DATAGRAM_CALLBACK)(void* hp, char* data, int len, struct sockaddr_in* peer, char* reply, int replySize);
 typedef int (*PFN_PROXY_CALLBACK)(void* hp, int op, char* buf, int len);
+typedef int (*PFN_NOTIFY_CALLBACK)(void* hp);
 
 typedef struct {
 	const char* pchUrlPrefix;
@@ -228,6 +235,11 @@ typedef struct {
 #define PROXY_RX_BUF_SIZE 1024
 #define PROXY_TX_BUF_SIZE 1024
 
+#define UDP_DATAGRAM_SIZE 4096
+#define UDP_BATCH_SIZE 32 /* datagrams per recvmmsg/sendmmsg call */
+#define UDP_MAX_BATCHES 8 /* batches received before serving the other sockets again */
+#define HTTP_EPOLL_EVENTS 64
+
 typedef struct _httpParam {
 	HttpSocket* hsSocketQueue;				/* socket queue*/
 	uint16_t maxClients;
@@ -240,8 +252,16 @@ typedef struct _httpParam {
 	char* pchWebPath;
 	UrlHandler *pxUrlHandler;		/* pointer to URL handler array */
 	AuthHandler *pxAuthHandler;     /* pointer to authorization handler array */
-	// incoming udp callback
+	// incoming udp callback, reads the datagram from udpSocket itself
 	PFN_UDP_CALLBACK pfnIncomingUDP;
+	// udp datagram callback, takes precedence over pfnIncomingUDP
+	// returns the length of the reply written to reply, 0 for no reply
+	PFN_UDP_DATAGRAM_CALLBACK pfnUDPDatagram;
+	char* udpBuffer;
+	BOOL udpPending;
+	// extra descriptor (e.g. an eventfd) watched for reading, pfnNotify is called when readable
+	int notifyFd;
+	PFN_NOTIFY_CALLBACK pfnNotify;
 	// proxy
 	struct sockaddr_in proxy_addr;
 	SOCKET proxySocket;
@@ -256,6 +276,9 @@ typedef struct _httpParam {
 	DWORD hlBindIP;
 	BOOL bKillWebserver;
 	BOOL bWebserverRunning;
+	// epoll
+	int epollFd;
+	time_t tmLastExpiryCheck;
 } HttpParam;
 
 typedef struct {
@@ -78,6 +78,10 @@
 #define HTTPMAXRECVBUFFER HTTP_BUFFER_SIZE
 #define HTTPUPLOAD_CHUNKSIZE (HTTPMAXRECVBUFFER / 2/*bytes*/)
 #define MAX_REQUEST_SIZE (2*1024 /*bytes*/)
+// chunk size line ("%x\r\n") in front of each piece of chunked stream data
+#define HTTP_CHUNK_HEAD_SIZE 10
+// received datagrams followed by their replies
+#define UDP_BUFFER_SIZE (UDP_BATCH_SIZE * 2 * UDP_DATAGRAM_SIZE)
 
 #define SLASH '/'
 
@@ -114,6 +118,9 @@ int _mwStrHeadMatch(char** pbuf1, const char* buf2);
 void _mwSetSocketOpts(SOCKET socket);
 void _mwSendErrorPage(SOCKET socket, const char* header, const char* body);
 void _mwCloseAllConnections(HttpParam* hp);
+#ifdef HTTP_EPOLL
+int _mwEpollStart(HttpParam* hp);
+#endif
 void _mwFreeJSONPairs(UrlHandlerParam* up);
 #endif
 ////////////////////////// END OF FILE //////////////////////////////////////
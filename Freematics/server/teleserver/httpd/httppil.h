@@ -54,6 +54,12 @@
 #include <sys/stat.h>
 #include <netdb.h>
 
+// epoll event loop with batched UDP (recvmmsg/sendmmsg), build with -DHTTP_NO_EPOLL to use select
+#if defined(__linux__) && !defined(HTTP_NO_EPOLL)
+#define HTTP_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #if !defined(O_BINARY)
 #define O_BINARY 0
 #endif
@@ -24,8 +24,6 @@
 #include "teleserver.h"
 #include "logdata.h"
 
-extern CHANNEL_DATA ld[];
-
 char* genHttpPostPayload(CHANNEL_DATA* pld)
 {
 	int n = 0;
@@ -96,9 +94,9 @@ int genRequest(char* buf, int bufsize)
 	uint8_t mask = 0;
 	int len = 0;
 
-	for (int i = 0; i < MAX_CHANNELS; i++) {
-		if (ld[i].id) {
-			CHANNEL_DATA* pld = ld + i;
+	for (int i = 0; i < getChannelSlots(); i++) {
+		CHANNEL_DATA* pld = getChannelSlot(i);
+		if (pld->id) {
 
 			if ((pld->flags & FLAG_PINGED)) {
 				len = snprintf(buf, bufsize, "GET ?id=%s HTTP/1.1\r\nConnection: keep-alive\r\n\r\n", pld->devid);
@@ -0,0 +1,273 @@
+/******************************************************************************
+* Freematics Hub Server
+* Developed by Stanley Huang <stanley@freematics.com.au>
+* Distributed under GPL v3.0 license
+* Visit https://freematics.com/hub for more information
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+/*
+Channel registry
+Channels live in slabs of CHANNEL_SLAB_SIZE entries that are never moved, so
+CHANNEL_DATA pointers stay valid while the table grows. Slots are numbered in
+allocation order (slab * CHANNEL_SLAB_SIZE + offset); a removed channel has id 0
+and its slot goes to a free list for reuse. Two open addressing hash indexes
+(linear probing, backward shift deletion) map numeric id and device ID to slots.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "httpd.h"
+#include "teleserver.h"
+
+#define CHANNEL_SLAB_SIZE 64
+#define CHANNEL_HASH_INIT_SIZE 64
+#define MAX_NUMERIC_ID 0xFFFF /* numeric IDs are sent as up to 4 hex digits */
+
+uint32_t maxChannels = MAX_CHANNELS;
+
+static CHANNEL_DATA** slabs = 0;
+static int slabCount = 0;
+static int slotCount = 0;
+static int* freeSlots = 0;
+static int freeCount = 0;
+static uint32_t channelCount = 0;
+static uint32_t maxChannelID = 0;
+
+/* hash indexes: slot + 1, 0 for an empty bucket */
+static uint32_t* idIndex = 0;
+static uint32_t* devidIndex = 0;
+static uint32_t indexSize = 0;
+
+static uint32_t hashID(uint32_t id)
+{
+	return id * 2654435761u;
+}
+
+static uint32_t hashDeviceID(const char* devid)
+{
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	for (; *devid; devid++) {
+		h = (h ^ (uint8_t)*devid) * 16777619u;
+	}
+	return h;
+}
+
+static uint32_t hashSlot(const uint32_t* index, int slot)
+{
+	CHANNEL_DATA* pld = getChannelSlot(slot);
+	return index == idIndex ? hashID(pld->id) : hashDeviceID(pld->devid);
+}
+
+static void indexInsert(uint32_t* index, uint32_t hash, int slot)
+{
+	uint32_t mask = indexSize - 1;
+	uint32_t i = hash & mask;
+	while (index[i]) i = (i + 1) & mask;
+	index[i] = slot + 1;
+}
+
+static void indexRemove(uint32_t* index, uint32_t hash, int slot)
+{
+	uint32_t mask = indexSize - 1;
+	uint32_t i = hash & mask;
+	while (index[i] != (uint32_t)slot + 1) {
+		if (!index[i]) return;
+		i = (i + 1) & mask;
+	}
+	// shift back following entries that would become unreachable
+	for (uint32_t j = i;;) {
+		j = (j + 1) & mask;
+		if (!index[j]) break;
+		uint32_t k = hashSlot(index, index[j] - 1) & mask;
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+		index[i] = index[j];
+		i = j;
+	}
+	index[i] = 0;
+}
+
+static int growIndexes()
+{
+	uint32_t size = indexSize ? indexSize * 2 : CHANNEL_HASH_INIT_SIZE;
+	uint32_t* ids = calloc(size, sizeof(uint32_t));
+	uint32_t* devids = calloc(size, sizeof(uint32_t));
+	if (!ids || !devids) {
+		free(ids);
+		free(devids);
+		return -1;
+	}
+	free(idIndex);
+	free(devidIndex);
+	idIndex = ids;
+	devidIndex = devids;
+	indexSize = size;
+	for (int slot = 0; slot < slotCount; slot++) {
+		CHANNEL_DATA* pld = getChannelSlot(slot);
+		if (!pld->id) continue;
+		indexInsert(idIndex, hashID(pld->id), slot);
+		indexInsert(devidIndex, hashDeviceID(pld->devid), slot);
+	}
+	return 0;
+}
+
+static int findSlotByID(uint32_t id)
+{
+	if (!indexSize) return -1;
+	uint32_t mask = indexSize - 1;
+	for (uint32_t i = hashID(id) & mask; idIndex[i]; i = (i + 1) & mask) {
+		int slot = idIndex[i] - 1;
+		if (getChannelSlot(slot)->id == id) return slot;
+	}
+	return -1;
+}
+
+static int allocSlot()
+{
+	if (freeCount) {
+		return freeSlots[--freeCount];
+	}
+	if (slotCount == slabCount * CHANNEL_SLAB_SIZE) {
+		// the free list never holds more than all slots
+		int* f = realloc(freeSlots, (slabCount + 1) * CHANNEL_SLAB_SIZE * sizeof(int));
+		if (!f) return -1;
+		freeSlots = f;
+		CHANNEL_DATA** p = realloc(slabs, (slabCount + 1) * sizeof(CHANNEL_DATA*));
+		if (!p) return -1;
+		slabs = p;
+		slabs[slabCount] = calloc(CHANNEL_SLAB_SIZE, sizeof(CHANNEL_DATA));
+		if (!slabs[slabCount]) return -1;
+		slabCount++;
+	}
+	return slotCount++;
+}
+
+/* takes a slot for a channel with the given ID and device ID and indexes it */
+static CHANNEL_DATA* addChannel(uint32_t id, const char* devid)
+{
+	if (channelCount >= maxChannels) {
+		return 0;
+	}
+	if ((channelCount + 1) * 2 > indexSize && growIndexes()) {
+		return 0;
+	}
+	int slot = allocSlot();
+	if (slot < 0) return 0;
+
+	CHANNEL_DATA* pld = getChannelSlot(slot);
+	memset(pld, 0, sizeof(CHANNEL_DATA));
+	pld->id = id;
+	strncpy(pld->devid, devid, sizeof(pld->devid) - 1);
+	indexInsert(idIndex, hashID(pld->id), slot);
+	indexInsert(devidIndex, hashDeviceID(pld->devid), slot);
+	channelCount++;
+	if (id > maxChannelID) maxChannelID = id;
+	return pld;
+}
+
+int getChannelSlots()
+{
+	return slotCount;
+}
+
+CHANNEL_DATA* getChannelSlot(int index)
+{
+	return slabs[index / CHANNEL_SLAB_SIZE] + index % CHANNEL_SLAB_SIZE;
+}
+
+int getChannelIndex(CHANNEL_DATA* pld)
+{
+	return pld && pld->id ? findSlotByID(pld->id) : -1;
+}
+
+uint32_t getChannelCount()
+{
+	return channelCount;
+}
+
+CHANNEL_DATA* findChannelByID(uint32_t id)
+{
+	if (id) {
+		int slot = findSlotByID(id);
+		if (slot >= 0) {
+			//printf("Channel found (ID:%u)\n", id);
+			return getChannelSlot(slot);
+		}
+	}
+	printf("Channel not found (ID:%u)\n", id);
+	return 0;
+}
+
+CHANNEL_DATA* findChannelByDeviceID(const char* devid)
+{
+	if (devid && *devid && indexSize) {
+		uint32_t mask = indexSize - 1;
+		for (uint32_t i = hashDeviceID(devid) & mask; devidIndex[i]; i = (i + 1) & mask) {
+			CHANNEL_DATA* pld = getChannelSlot(devidIndex[i] - 1);
+			if (!strcmp(pld->devid, devid)) return pld;
+		}
+	}
+	return 0;
+}
+
+CHANNEL_DATA* findEmptyChannel(const char* devid)
+{
+	// new channels take the ID after the highest one in use; once that no longer
+	// fits, free IDs are searched round-robin from where the last search stopped
+	static uint32_t reuseID = 0;
+	uint32_t id = maxChannelID + 1;
+	if (id > MAX_NUMERIC_ID) {
+		if (channelCount >= MAX_NUMERIC_ID) return 0;
+		do {
+			reuseID = reuseID % MAX_NUMERIC_ID + 1;
+		} while (findSlotByID(reuseID) >= 0);
+		id = reuseID;
+	}
+	return addChannel(id, devid);
+}
+
+CHANNEL_DATA* restoreChannel(const CHANNEL_DATA* saved)
+{
+	if (!saved->id || findSlotByID(saved->id) >= 0 || findChannelByDeviceID(saved->devid)) {
+		return 0;
+	}
+	CHANNEL_DATA* pld = addChannel(saved->id, saved->devid);
+	if (pld) {
+		memcpy(pld, saved, sizeof(CHANNEL_DATA));
+		pld->devid[sizeof(pld->devid) - 1] = 0;
+	}
+	return pld;
+}
+
+void removeChannel(CHANNEL_DATA* pld)
+{
+	int slot = getChannelIndex(pld);
+	if (slot < 0) return;
+	indexRemove(idIndex, hashID(pld->id), slot);
+	indexRemove(devidIndex, hashDeviceID(pld->devid), slot);
+	uint32_t id = pld->id;
+
+	if (pld->cache) free(pld->cache);
+	closeDataFile(pld);
+	memset(pld, 0, sizeof(CHANNEL_DATA));
+	freeSlots[freeCount++] = slot;
+	channelCount--;
+
+	if (id == maxChannelID) {
+		maxChannelID = 0;
+		for (int i = 0; i < slotCount; i++) {
+			CHANNEL_DATA* p = getChannelSlot(i);
+			if (p->id > maxChannelID) maxChannelID = p->id;
+		}
+	}
+}
@@ -0,0 +1,308 @@
+/******************************************************************************
+* Freematics Hub Server trip data converter
+* Developed by Stanley Huang <stanley@freematics.com.au>
+* Distributed under GPL v3.0 license
+* Visit https://freematics.com/hub for more information
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+/*
+Migrates text trip data files (<date>-<time>.txt) to binary trip data files
+(<date>-<time>.bin) and dumps binary files back as text (Linux only)
+
+Build: make teleconv
+Usage: teleconv [-r] <file or directory>...   convert, -r removes converted text files
+                                               (each binary file is read back and compared first)
+       teleconv -d <file.bin>                  dump as text lines
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "tripdata.h"
+
+static int removeText = 0;
+static int converted = 0;
+static int failed = 0;
+
+static int isTripFile(const char* name)
+{
+	// same naming as data files written by the server
+	return strlen(name) == 19 && name[8] == '-' && !strcmp(name + 15, ".txt");
+}
+
+/* samples of a trip in the order they were written, for checking the conversion */
+typedef struct {
+	uint32_t seq;
+	uint32_t ts;
+	uint16_t pid;
+	int len;
+	size_t text;
+} CHECK_SAMPLE;
+
+typedef struct {
+	CHECK_SAMPLE* samples;
+	int count;
+	int size;
+	char* text;
+	size_t textLen;
+	size_t textSize;
+} CHECK_LIST;
+
+static int addCheckSample(void* arg, uint32_t ts, uint16_t pid, const char* value, int len)
+{
+	CHECK_LIST* list = (CHECK_LIST*)arg;
+	if (list->count == list->size) {
+		int size = list->size ? list->size * 2 : 1024;
+		CHECK_SAMPLE* p = realloc(list->samples, size * sizeof(CHECK_SAMPLE));
+		if (!p) return -1;
+		list->samples = p;
+		list->size = size;
+	}
+	if (list->textLen + len > list->textSize) {
+		size_t size = list->textSize ? list->textSize : 65536;
+		while (list->textLen + len > size) size *= 2;
+		char* p = realloc(list->text, size);
+		if (!p) return -1;
+		list->text = p;
+		list->textSize = size;
+	}
+	CHECK_SAMPLE* s = list->samples + list->count;
+	s->seq = list->count++;
+	s->ts = ts;
+	s->pid = pid;
+	s->len = len;
+	s->text = list->textLen;
+	memcpy(list->text + list->textLen, value, len);
+	list->textLen += len;
+	return 0;
+}
+
+static int addReadSample(void* arg, const TRIP_SAMPLE* s)
+{
+	char value[TRIP_MAX_TEXT_LEN + 1];
+	int len = tripFormatValue(s, value, sizeof(value));
+	return addCheckSample(arg, s->ts, s->pid, value, len);
+}
+
+static int compareCheckSamples(const void* a, const void* b)
+{
+	// samples of a PID keep their order, PIDs of the same time may be read in another order
+	const CHECK_SAMPLE* x = (const CHECK_SAMPLE*)a;
+	const CHECK_SAMPLE* y = (const CHECK_SAMPLE*)b;
+	if (x->pid != y->pid) return x->pid < y->pid ? -1 : 1;
+	return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/* reads the binary file back, returns 0 if it gives every sample of the text file as written */
+static int checkFile(const char* bin, CHECK_LIST* expected)
+{
+	CHECK_LIST actual = { 0 };
+	TRIP_READER tr;
+	int ret = -1;
+	if (tripOpen(&tr, bin) < 0) {
+		fprintf(stderr, "%s: cannot be read back\n", bin);
+		return -1;
+	}
+	if (tripRead(&tr, 0, 0, 0, addReadSample, &actual) != expected->count || actual.count != expected->count) {
+		fprintf(stderr, "%s: %d samples read back, %d written\n", bin, actual.count, expected->count);
+	}
+	else {
+		qsort(expected->samples, expected->count, sizeof(CHECK_SAMPLE), compareCheckSamples);
+		qsort(actual.samples, actual.count, sizeof(CHECK_SAMPLE), compareCheckSamples);
+		ret = 0;
+		for (int i = 0; i < actual.count && !ret; i++) {
+			const CHECK_SAMPLE* x = expected->samples + i;
+			const CHECK_SAMPLE* y = actual.samples + i;
+			if (x->pid != y->pid || x->ts != y->ts || x->len != y->len
+				|| memcmp(expected->text + x->text, actual.text + y->text, x->len)) {
+				fprintf(stderr, "%s: %X:%.*s at %u reads back as %X:%.*s at %u\n", bin,
+					x->pid, x->len, expected->text + x->text, x->ts, y->pid, y->len, actual.text + y->text, y->ts);
+				ret = -1;
+			}
+		}
+	}
+	tripRelease(&tr);
+	free(actual.samples);
+	free(actual.text);
+	return ret;
+}
+
+static int convertFile(const char* path)
+{
+	char bin[1024];
+	int len = strlen(path);
+	if (len < 4 || len >= (int)sizeof(bin) || strcmp(path + len - 4, ".txt")) {
+		fprintf(stderr, "%s: not a text data file\n", path);
+		return -1;
+	}
+	memcpy(bin, path, len - 4);
+	strcpy(bin + len - 4, ".bin");
+	if (!access(bin, F_OK)) {
+		fprintf(stderr, "%s: already exists\n", bin);
+		return -1;
+	}
+
+	FILE* fp = fopen(path, "r");
+	if (!fp) {
+		perror(path);
+		return -1;
+	}
+	TRIP_WRITER* tw = tripCreate(bin);
+	if (!tw) {
+		perror(bin);
+		fclose(fp);
+		return -1;
+	}
+	CHECK_LIST expected = { 0 };
+	uint32_t ts = 0;
+	char* line = 0;
+	size_t size = 0;
+	ssize_t n;
+	int samples = 0;
+	int lines = 0;
+	int error = 0;
+	while ((n = getline(&line, &size, fp)) > 0) {
+		while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = 0;
+		int count = tripAppend(tw, line);
+		if (count < 0) {
+			fprintf(stderr, "%s: error writing line %d\n", bin, lines + 1);
+			error = 1;
+			break;
+		}
+		if (tripParseLine(line, &ts, addCheckSample, &expected) < 0) {
+			fprintf(stderr, "%s: out of memory\n", path);
+			error = 1;
+			break;
+		}
+		samples += count;
+		lines++;
+	}
+	if (ferror(fp)) {
+		perror(path);
+		error = 1;
+	}
+	free(line);
+	fclose(fp);
+	if (tripClose(tw)) {
+		fprintf(stderr, "%s: error writing file\n", bin);
+		error = 1;
+	}
+	// the text file is only replaced by a binary file that reads back the same
+	if (!error && checkFile(bin, &expected)) error = 1;
+	free(expected.samples);
+	free(expected.text);
+	if (error) {
+		// an incomplete binary file would block converting again, the text file is kept
+		unlink(bin);
+		return -1;
+	}
+
+	struct stat st;
+	long textSize = stat(path, &st) ? 0 : (long)st.st_size;
+	long binSize = stat(bin, &st) ? 0 : (long)st.st_size;
+	printf("%s: %d lines, %d samples, %ld -> %ld bytes\n", path, lines, samples, textSize, binSize);
+	if (removeText) unlink(path);
+	return 0;
+}
+
+static void convertDir(const char* path)
+{
+	DIR* dir = opendir(path);
+	struct dirent* de;
+	if (!dir) {
+		perror(path);
+		failed++;
+		return;
+	}
+	while ((de = readdir(dir))) {
+		char sub[1024];
+		struct stat st;
+		if (de->d_name[0] == '.') continue;
+		snprintf(sub, sizeof(sub), "%s/%s", path, de->d_name);
+		if (stat(sub, &st)) continue;
+		if (S_ISDIR(st.st_mode)) {
+			convertDir(sub);
+		}
+		else if (isTripFile(de->d_name)) {
+			if (convertFile(sub) == 0) converted++; else failed++;
+		}
+	}
+	closedir(dir);
+}
+
+static int dumpSample(void* arg, const TRIP_SAMPLE* s)
+{
+	uint32_t* ts = (uint32_t*)arg;
+	char value[TRIP_MAX_TEXT_LEN + 1];
+	tripFormatValue(s, value, sizeof(value));
+	if (s->ts != *ts || ts[1] == 0) {
+		// one line per timestamp
+		printf("%s0:%u", ts[1] ? "\n" : "", s->ts);
+		ts[0] = s->ts;
+		ts[1] = 1;
+	}
+	printf(",%X:%s", s->pid, value);
+	return 0;
+}
+
+static int dumpFile(const char* path)
+{
+	TRIP_READER tr;
+	uint32_t ts[2] = { 0 };
+	if (tripOpen(&tr, path) < 0) {
+		fprintf(stderr, "%s: not a trip data file\n", path);
+		return -1;
+	}
+	tripRead(&tr, 0, 0, 0, dumpSample, ts);
+	if (ts[1]) printf("\n");
+	tripRelease(&tr);
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	int dump = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "rd")) != -1) {
+		switch (opt) {
+		case 'r': removeText = 1; break;
+		case 'd': dump = 1; break;
+		default:
+			optind = argc + 1;
+		}
+	}
+	if (optind >= argc) {
+		fprintf(stderr, "Usage: %s [-r] <file or directory>...\n       %s -d <file.bin>\n", argv[0], argv[0]);
+		return 1;
+	}
+	for (int i = optind; i < argc; i++) {
+		struct stat st;
+		if (dump) {
+			if (dumpFile(argv[i])) failed++;
+		}
+		else if (!stat(argv[i], &st) && S_ISDIR(st.st_mode)) {
+			convertDir(argv[i]);
+		}
+		else if (convertFile(argv[i]) == 0) {
+			converted++;
+		}
+		else {
+			failed++;
+		}
+	}
+	if (!dump) printf("%d files converted, %d failed\n", converted, failed);
+	return failed ? 2 : 0;
+}
@@ -0,0 +1,527 @@
+/******************************************************************************
+* Freematics Hub Server
+* Developed by Stanley Huang <stanley@freematics.com.au>
+* Distributed under GPL v3.0 license
+* Visit https://freematics.com/hub for more information
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+/*
+Ingest pipeline
+UDP datagrams go through four stages:
+1. receive (web server thread): each datagram is copied into the ring of the
+   worker its channel is sharded to (channel ID modulo worker count)
+2. parse (worker threads): checksum, header, event fields and data samples
+   are parsed in the ring slot
+3. apply (web server thread): woken through an eventfd, parsed datagrams are
+   applied to their channels in ring order and replies are sent in batches
+4. write (log writer thread): data file lines, flushes and closes are queued
+   to a byte ring and appended to binary trip data files (tripdata.c) in order
+
+A channel always goes to the same worker and rings are FIFO, so datagrams of a
+channel are applied and logged in arrival order. Channel data is still only
+touched on the web server thread, so HTTP handlers need no locking. Every ring
+index has a single writer, so rings are lock-free; a thread only takes its
+lock to sleep on an empty ring.
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* sendmmsg */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "httpd.h"
+#include "teleserver.h"
+#include "tripdata.h"
+
+#if defined(__linux__) && !defined(NO_INGEST_THREADS)
+#define INGEST_THREADS
+#endif
+
+int ingestWorkers = -1; /* -1 for one per additional CPU core, 0 to process datagrams inline */
+
+#ifdef INGEST_THREADS
+
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+
+#define MAX_INGEST_WORKERS 8
+#define INGEST_RING_SIZE 256 /* datagram slots per worker, power of 2 */
+#define INGEST_SLOT_SAMPLES 256 /* larger payloads are parsed when applied */
+#define WRITER_RING_SIZE (4 * 1024 * 1024) /* bytes, power of 2 */
+#define WRITER_ALIGN 16 /* record alignment, a record header always fits before the ring end */
+#define REPLY_BATCH_SIZE 32
+#define REPLY_SIZE 128
+
+typedef struct {
+	struct sockaddr_in peer;
+	int len;
+	int result;
+	UDP_PACKET pkt;
+	PAYLOAD_SAMPLE samples[INGEST_SLOT_SAMPLES];
+	char data[UDP_DATAGRAM_SIZE];
+} INGEST_SLOT;
+
+/* thread consuming a ring, sleeps on cond while the ring is empty */
+typedef struct {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	atomic_int sleeping;
+} INGEST_THREAD;
+
+typedef struct {
+	INGEST_THREAD t;
+	INGEST_SLOT* slots;
+	atomic_uint head; /* next slot to fill, receive stage */
+	atomic_uint parsed; /* next slot to parse, worker */
+	unsigned int tail; /* next slot to apply, apply stage */
+} INGEST_WORKER;
+
+#define WRITER_APPEND 0 /* append the line that follows */
+#define WRITER_FLUSH 1 /* write out samples buffered for DATA_FLUSH_INTERVAL */
+#define WRITER_CLOSE 2
+
+/* log writer record, followed by len bytes of null-terminated text, trip 0 wraps to the ring start */
+typedef struct {
+	TRIP_WRITER* trip;
+	uint32_t len;
+	uint32_t op;
+} WRITER_RECORD;
+
+typedef struct {
+	struct sockaddr_in peer;
+	char data[REPLY_SIZE];
+} INGEST_REPLY;
+
+static INGEST_WORKER workers[MAX_INGEST_WORKERS];
+static int workerCount = 0;
+static INGEST_THREAD writer;
+static char* writerRing = 0;
+static atomic_uint writerHead; /* apply stage */
+static atomic_uint writerTail; /* log writer */
+static atomic_int running;
+static atomic_int notified;
+static int notifyFd = -1;
+static HttpParam* ingestHp = 0;
+static INGEST_REPLY replies[REPLY_BATCH_SIZE];
+static int replyCount = 0;
+
+static void wakeThread(INGEST_THREAD* t)
+{
+	// the consumer flags sleeping before checking its ring for the last time
+	if (atomic_load(&t->sleeping)) {
+		pthread_mutex_lock(&t->lock);
+		pthread_cond_signal(&t->cond);
+		pthread_mutex_unlock(&t->lock);
+	}
+}
+
+static void sleepThread(INGEST_THREAD* t, int (*isIdle)(void*), void* arg)
+{
+	atomic_store(&t->sleeping, 1);
+	pthread_mutex_lock(&t->lock);
+	while (isIdle(arg) && atomic_load(&running)) {
+		pthread_cond_wait(&t->cond, &t->lock);
+	}
+	pthread_mutex_unlock(&t->lock);
+	atomic_store(&t->sleeping, 0);
+}
+
+static void stopThread(INGEST_THREAD* t)
+{
+	pthread_mutex_lock(&t->lock);
+	pthread_cond_signal(&t->cond);
+	pthread_mutex_unlock(&t->lock);
+	pthread_join(t->thread, 0);
+	pthread_mutex_destroy(&t->lock);
+	pthread_cond_destroy(&t->cond);
+}
+
+static int startThread(INGEST_THREAD* t, void* (*proc)(void*), void* arg)
+{
+	pthread_mutex_init(&t->lock, 0);
+	pthread_cond_init(&t->cond, 0);
+	atomic_init(&t->sleeping, 0);
+	return pthread_create(&t->thread, 0, proc, arg);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// parse stage
+//////////////////////////////////////////////////////////////////////////
+
+static int isWorkerIdle(void* arg)
+{
+	INGEST_WORKER* w = (INGEST_WORKER*)arg;
+	return atomic_load(&w->parsed) == atomic_load(&w->head);
+}
+
+static void* workerThread(void* arg)
+{
+	INGEST_WORKER* w = (INGEST_WORKER*)arg;
+	while (atomic_load(&running)) {
+		unsigned int parsed = atomic_load_explicit(&w->parsed, memory_order_relaxed);
+		unsigned int head = atomic_load_explicit(&w->head, memory_order_acquire);
+		if (parsed == head) {
+			sleepThread(&w->t, isWorkerIdle, w);
+			continue;
+		}
+		for (; parsed != head; parsed++) {
+			INGEST_SLOT* slot = w->slots + (parsed & (INGEST_RING_SIZE - 1));
+			slot->result = parseDatagram(slot->data, slot->len, &slot->pkt, slot->samples, INGEST_SLOT_SAMPLES);
+			atomic_store_explicit(&w->parsed, parsed + 1, memory_order_release);
+		}
+		// wake up the web server thread once for what has been parsed
+		if (!atomic_exchange(&notified, 1)) {
+			uint64_t one = 1;
+			if (write(notifyFd, &one, sizeof(one)) < 0) {
+				atomic_store(&notified, 0);
+			}
+		}
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// apply stage
+//////////////////////////////////////////////////////////////////////////
+
+static void sendReplies()
+{
+	struct mmsghdr msgs[REPLY_BATCH_SIZE];
+	struct iovec iovs[REPLY_BATCH_SIZE];
+	int i, sent;
+
+	memset(msgs, 0, sizeof(struct mmsghdr) * replyCount);
+	for (i = 0; i < replyCount; i++) {
+		iovs[i].iov_base = replies[i].data;
+		iovs[i].iov_len = strlen(replies[i].data);
+		msgs[i].msg_hdr.msg_name = &replies[i].peer;
+		msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		msgs[i].msg_hdr.msg_iov = iovs + i;
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	for (i = 0; i < replyCount; i += sent) {
+		sent = sendmmsg(ingestHp->udpSocket, msgs + i, replyCount - i, 0);
+		if (sent <= 0) {
+			fprintf(stderr, "%d replies unsent\n", replyCount - i);
+			break;
+		}
+	}
+	replyCount = 0;
+}
+
+static int applyParsed(INGEST_WORKER* w)
+{
+	unsigned int parsed = atomic_load_explicit(&w->parsed, memory_order_acquire);
+	int count = 0;
+	for (; w->tail != parsed; w->tail++, count++) {
+		INGEST_SLOT* slot = w->slots + (w->tail & (INGEST_RING_SIZE - 1));
+		INGEST_REPLY* reply = replies + replyCount;
+		if (applyDatagram(&slot->pkt, slot->result, &slot->peer, reply->data, REPLY_SIZE) > 0) {
+			reply->peer = slot->peer;
+			if (++replyCount == REPLY_BATCH_SIZE) sendReplies();
+		}
+	}
+	return count;
+}
+
+static int applyIngest(void* hp)
+{
+	uint64_t count;
+	if (read(notifyFd, &count, sizeof(count)) < 0) {
+		// nothing signaled
+	}
+	// workers signal again for anything parsed from now on, exchanging (rather
+	// than storing) also makes what the last signaling worker parsed visible
+	atomic_exchange(&notified, 0);
+	for (int i = 0; i < workerCount; i++) {
+		applyParsed(workers + i);
+	}
+	if (replyCount) sendReplies();
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// receive stage
+//////////////////////////////////////////////////////////////////////////
+
+static unsigned int channelShard(const char* data)
+{
+	// resolve the channel the way applyDatagram does, so that a device logging
+	// in by device ID shares the worker with its data sent by channel ID
+	const char* p = strchr(data, '#');
+	if (!p || p == data) return 0;
+	int len = (int)(p - data);
+	if (len <= 4) {
+		return (unsigned int)hex2uint16(data);
+	}
+	char devid[MAX_DEVID_LEN + 1];
+	if (len > MAX_DEVID_LEN) len = MAX_DEVID_LEN;
+	memcpy(devid, data, len);
+	devid[len] = 0;
+	CHANNEL_DATA* pld = findChannelByDeviceID(devid);
+	if (pld) return pld->id;
+	unsigned int h = 0;
+	for (p = devid; *p; p++) h = h * 31 + (uint8_t)*p;
+	return h;
+}
+
+static int ingestDatagram(void* hp, char* data, int len, struct sockaddr_in* peer, char* reply, int replySize)
+{
+	INGEST_WORKER* w = workers + channelShard(data) % workerCount;
+	unsigned int head = atomic_load_explicit(&w->head, memory_order_relaxed);
+	while (head - w->tail == INGEST_RING_SIZE) {
+		// ring full, apply what has been parsed or let the worker catch up
+		wakeThread(&w->t);
+		if (!applyParsed(w)) sched_yield();
+		if (replyCount) sendReplies();
+	}
+	INGEST_SLOT* slot = w->slots + (head & (INGEST_RING_SIZE - 1));
+	memcpy(slot->data, data, len + 1);
+	slot->len = len;
+	slot->peer = *peer;
+	atomic_store(&w->head, head + 1);
+	wakeThread(&w->t);
+	// replied when applied
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// log writer stage
+//////////////////////////////////////////////////////////////////////////
+
+static int isWriterIdle(void* arg)
+{
+	return atomic_load(&writerTail) == atomic_load(&writerHead);
+}
+
+static void* writerThread(void* arg)
+{
+	for (;;) {
+		unsigned int tail = atomic_load_explicit(&writerTail, memory_order_relaxed);
+		unsigned int head = atomic_load_explicit(&writerHead, memory_order_acquire);
+		if (tail == head) {
+			// what has been queued is written before quitting
+			if (!atomic_load(&running)) break;
+			sleepThread(&writer, isWriterIdle, 0);
+			continue;
+		}
+		while (tail != head) {
+			unsigned int offset = tail & (WRITER_RING_SIZE - 1);
+			WRITER_RECORD* r = (WRITER_RECORD*)(writerRing + offset);
+			if (!r->trip) {
+				tail += WRITER_RING_SIZE - offset;
+			}
+			else {
+				if (r->op == WRITER_APPEND) {
+					tripAppend(r->trip, (const char*)(r + 1));
+				}
+				else if (r->op == WRITER_FLUSH) {
+					tripFlushAged(r->trip, DATA_FLUSH_INTERVAL);
+				}
+				else if (tripClose(r->trip)) {
+					fprintf(stderr, "Error writing data file\n");
+				}
+				tail += (sizeof(WRITER_RECORD) + r->len + WRITER_ALIGN - 1) & ~(WRITER_ALIGN - 1);
+			}
+			atomic_store_explicit(&writerTail, tail, memory_order_release);
+		}
+	}
+	return 0;
+}
+
+static void queueRecord(TRIP_WRITER* trip, uint32_t op, const char* text, uint32_t len)
+{
+	static int warned = 0;
+	uint32_t size = (sizeof(WRITER_RECORD) + len + (len ? 1 : 0) + WRITER_ALIGN - 1) & ~(WRITER_ALIGN - 1);
+	unsigned int head = atomic_load_explicit(&writerHead, memory_order_relaxed);
+	unsigned int offset = head & (WRITER_RING_SIZE - 1);
+	unsigned int skip = offset + size > WRITER_RING_SIZE ? WRITER_RING_SIZE - offset : 0;
+
+	while (head + skip + size - atomic_load_explicit(&writerTail, memory_order_acquire) > WRITER_RING_SIZE) {
+		// disk is not keeping up, wait for room instead of losing data
+		if (!warned) {
+			fprintf(stderr, "Data file writing falls behind\n");
+			warned = 1;
+		}
+		wakeThread(&writer);
+		usleep(1000);
+	}
+	if (skip) {
+		((WRITER_RECORD*)(writerRing + offset))->trip = 0;
+		head += skip;
+		offset = 0;
+	}
+	WRITER_RECORD* r = (WRITER_RECORD*)(writerRing + offset);
+	r->trip = trip;
+	r->op = op;
+	r->len = len ? len + 1 : 0;
+	if (len) {
+		memcpy(r + 1, text, len);
+		((char*)(r + 1))[len] = 0;
+	}
+	atomic_store(&writerHead, head + size);
+	wakeThread(&writer);
+}
+
+void writeDataFile(CHANNEL_DATA* pld, const char* line, int len)
+{
+	if (writerRing) {
+		if (len > 0) queueRecord(pld->trip, WRITER_APPEND, line, len);
+	}
+	else {
+		tripAppend(pld->trip, line);
+	}
+}
+
+void closeDataFile(CHANNEL_DATA* pld)
+{
+	if (!pld->trip) return;
+	if (writerRing) {
+		queueRecord(pld->trip, WRITER_CLOSE, 0, 0);
+	}
+	else if (tripClose(pld->trip)) {
+		fprintf(stderr, "Error writing data file of %s\n", pld->devid);
+	}
+	pld->trip = 0;
+}
+
+void flushDataFile(CHANNEL_DATA* pld)
+{
+	if (!pld->trip) return;
+	if (writerRing) {
+		queueRecord(pld->trip, WRITER_FLUSH, 0, 0);
+	}
+	else {
+		tripFlushAged(pld->trip, DATA_FLUSH_INTERVAL);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// pipeline control
+//////////////////////////////////////////////////////////////////////////
+
+int startIngest(HttpParam* hp)
+{
+	int count = ingestWorkers;
+	if (count < 0) {
+		count = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+		if (count < 1) count = 1;
+	}
+	if (count > MAX_INGEST_WORKERS) count = MAX_INGEST_WORKERS;
+	if (count == 0 || !hp->udpPort) return 0;
+
+	notifyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	writerRing = malloc(WRITER_RING_SIZE);
+	if (notifyFd < 0 || !writerRing) {
+		fprintf(stderr, "Unable to start ingest pipeline\n");
+		if (notifyFd >= 0) close(notifyFd);
+		free(writerRing);
+		writerRing = 0;
+		return 0;
+	}
+	atomic_init(&running, 1);
+	atomic_init(&notified, 0);
+	atomic_init(&writerHead, 0);
+	atomic_init(&writerTail, 0);
+	if (startThread(&writer, writerThread, 0)) {
+		fprintf(stderr, "Unable to start log writer\n");
+		close(notifyFd);
+		free(writerRing);
+		writerRing = 0;
+		return 0;
+	}
+	for (workerCount = 0; workerCount < count; workerCount++) {
+		INGEST_WORKER* w = workers + workerCount;
+		w->slots = calloc(INGEST_RING_SIZE, sizeof(INGEST_SLOT));
+		atomic_init(&w->head, 0);
+		atomic_init(&w->parsed, 0);
+		w->tail = 0;
+		if (!w->slots || startThread(&w->t, workerThread, w)) {
+			free(w->slots);
+			w->slots = 0;
+			break;
+		}
+	}
+	if (!workerCount) {
+		// datagrams are processed inline, data files still written by the log writer
+		fprintf(stderr, "Unable to start ingest workers\n");
+		return 0;
+	}
+
+	ingestHp = hp;
+	hp->notifyFd = notifyFd;
+	hp->pfnNotify = applyIngest;
+	hp->pfnUDPDatagram = ingestDatagram;
+	return workerCount;
+}
+
+void stopIngest()
+{
+	if (!writerRing) return;
+	atomic_store(&running, 0);
+	for (int i = 0; i < workerCount; i++) {
+		stopThread(&workers[i].t);
+		free(workers[i].slots);
+		workers[i].slots = 0;
+	}
+	workerCount = 0;
+	// the log writer drains its ring before quitting
+	stopThread(&writer);
+	free(writerRing);
+	writerRing = 0;
+	if (ingestHp) {
+		ingestHp->notifyFd = 0;
+		ingestHp->pfnNotify = 0;
+		ingestHp = 0;
+	}
+	close(notifyFd);
+	notifyFd = -1;
+}
+
+#else
+
+int startIngest(HttpParam* hp)
+{
+	return 0;
+}
+
+void stopIngest()
+{
+}
+
+void writeDataFile(CHANNEL_DATA* pld, const char* line, int len)
+{
+	tripAppend(pld->trip, line);
+}
+
+void closeDataFile(CHANNEL_DATA* pld)
+{
+	if (pld->trip) {
+		if (tripClose(pld->trip)) {
+			fprintf(stderr, "Error writing data file of %s\n", pld->devid);
+		}
+		pld->trip = 0;
+	}
+}
+
+void flushDataFile(CHANNEL_DATA* pld)
+{
+	if (pld->trip) tripFlushAged(pld->trip, DATA_FLUSH_INTERVAL);
+}
+
+#endif
@@ -0,0 +1,292 @@
+/******************************************************************************
+* Freematics Hub Server load generator
+* Developed by Stanley Huang <stanley@freematics.com.au>
+* Distributed under GPL v3.0 license
+* Visit https://freematics.com/hub for more information
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+/*
+Replays the device UDP protocol against a running server (Linux only)
+1. every simulated device logs in (EV=1) and gets its channel ID
+2. data packets <ID>#0:<ts>,<pid>:<data>,...*<checksum> are sent round-robin
+   for the given duration, optionally rate limited
+3. every device is pinged (EV=7), the RX counter in the reply tells how many
+   packets the server has processed for it; as a channel is processed in
+   order, the last reply marks the end of processing
+4. devices log out (EV=2)
+
+Build: make teleload
+Usage: teleload [-h host] [-p port] [-d devices] [-t seconds] [-r packets/s] [-s samples/packet]
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define PACKET_SIZE 1024
+#define SEND_BATCH 64
+#define MAX_RETRIES 3
+#define PING_TIMEOUT 10 /* seconds */
+
+typedef struct {
+	uint32_t id; /* channel ID assigned by the server */
+	uint32_t sent;
+	uint32_t processed;
+	int replied;
+} DEVICE;
+
+static int sock;
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int addChecksum(char* data, int len)
+{
+	uint8_t sum = 0;
+	for (int i = 0; i < len; i++) sum += data[i];
+	return len + sprintf(data + len, "*%X", sum);
+}
+
+/* receives one reply, returns its length or 0 on timeout */
+static int receiveReply(char* buf, int size, int timeoutMs)
+{
+	struct timeval tv = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	int len = recv(sock, buf, size - 1, 0);
+	if (len <= 0) return 0;
+	buf[len] = 0;
+	return len;
+}
+
+static int login(DEVICE* devices, int count)
+{
+	char buf[PACKET_SIZE];
+	for (int i = 0; i < count; i++) {
+		int retry;
+		for (retry = 0; retry < MAX_RETRIES; retry++) {
+			int len = sprintf(buf, "LOAD%05u#EV=1,TS=0,ID=LOAD%05u", i, i);
+			len = addChecksum(buf, len);
+			send(sock, buf, len, 0);
+			// stale replies (e.g. sync events) are skipped
+			while (receiveReply(buf, sizeof(buf), 1000)) {
+				if (strstr(buf, "#EV=1,")) break;
+			}
+			if (strstr(buf, "#EV=1,")) break;
+		}
+		if (retry == MAX_RETRIES) {
+			fprintf(stderr, "Device %u login failed\n", i);
+			return -1;
+		}
+		devices[i].id = (uint32_t)strtoul(buf, 0, 16);
+	}
+	return 0;
+}
+
+static uint32_t blast(DEVICE* devices, int count, double seconds, uint32_t rate, int samples)
+{
+	static char packets[SEND_BATCH][PACKET_SIZE];
+	struct mmsghdr msgs[SEND_BATCH];
+	struct iovec iovs[SEND_BATCH];
+	double start = now();
+	double elapsed = 0;
+	uint32_t total = 0;
+	uint32_t ts = 1000;
+	int dev = 0;
+
+	memset(msgs, 0, sizeof(msgs));
+	for (int i = 0; i < SEND_BATCH; i++) {
+		iovs[i].iov_base = packets[i];
+		msgs[i].msg_hdr.msg_iov = iovs + i;
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	while (elapsed < seconds) {
+		int n = SEND_BATCH;
+		if (rate) {
+			// send no more than the rate allows so far
+			uint32_t allowed = (uint32_t)(elapsed * rate) + 1;
+			if (total >= allowed) {
+				usleep(100);
+				elapsed = now() - start;
+				continue;
+			}
+			if (allowed - total < (uint32_t)n) n = allowed - total;
+		}
+		for (int i = 0; i < n; i++) {
+			char* p = packets[i];
+			int len = sprintf(p, "%X#0:%u", devices[dev].id, ts);
+			for (int j = 0; j < samples; j++) {
+				len += sprintf(p + len, ",%X:%u", 0x100 + j, (ts / 100 + j * 7) % 256);
+			}
+			iovs[i].iov_len = addChecksum(p, len);
+			devices[dev].sent++;
+			if (++dev == count) {
+				dev = 0;
+				ts += 100;
+			}
+		}
+		int sent = sendmmsg(sock, msgs, n, 0);
+		if (sent < 0) {
+			if (errno != ENOBUFS && errno != EAGAIN) {
+				perror("sendmmsg");
+				break;
+			}
+			sent = 0;
+		}
+		// unsent packets are not counted
+		for (int i = sent; i < n; i++) {
+			if (--dev < 0) {
+				dev = count - 1;
+				ts -= 100;
+			}
+			devices[dev].sent--;
+		}
+		total += sent;
+		elapsed = now() - start;
+	}
+	return total;
+}
+
+/* pings devices until all replied, returns the time of the last reply */
+static double ping(DEVICE* devices, int count, int* missing)
+{
+	char buf[PACKET_SIZE];
+	int pending = count;
+	double start = now();
+	double last = start;
+	// pings get lost as well while the server is behind, so resend them after a short wait
+	while (pending && now() - start < PING_TIMEOUT) {
+		for (int i = 0; i < count; i++) {
+			if (devices[i].replied) continue;
+			int len = sprintf(buf, "%X#EV=7,TS=0", devices[i].id);
+			len = addChecksum(buf, len);
+			send(sock, buf, len, 0);
+		}
+		while (pending && receiveReply(buf, sizeof(buf), 200)) {
+			char* rx = strstr(buf, "#EV=7,RX=");
+			if (!rx) continue;
+			uint32_t id = (uint32_t)strtoul(buf, 0, 16);
+			for (int i = 0; i < count; i++) {
+				if (devices[i].id == id && !devices[i].replied) {
+					// the ping itself is counted too
+					devices[i].processed = (uint32_t)atol(rx + 9) - 1;
+					devices[i].replied = 1;
+					last = now();
+					pending--;
+					break;
+				}
+			}
+		}
+	}
+	*missing = pending;
+	return last;
+}
+
+static void logout(DEVICE* devices, int count)
+{
+	char buf[PACKET_SIZE];
+	for (int i = 0; i < count; i++) {
+		int len = sprintf(buf, "%X#EV=2,TS=0", devices[i].id);
+		len = addChecksum(buf, len);
+		send(sock, buf, len, 0);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const char* host = "127.0.0.1";
+	int port = 8081;
+	int count = 100;
+	double seconds = 5;
+	uint32_t rate = 0;
+	int samples = 10;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "h:p:d:t:r:s:")) != -1) {
+		switch (opt) {
+		case 'h': host = optarg; break;
+		case 'p': port = atoi(optarg); break;
+		case 'd': count = atoi(optarg); break;
+		case 't': seconds = atof(optarg); break;
+		case 'r': rate = (uint32_t)atol(optarg); break;
+		case 's': samples = atoi(optarg); break;
+		default:
+			fprintf(stderr, "Usage: %s [-h host] [-p port] [-d devices] [-t seconds] [-r packets/s] [-s samples/packet]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (count <= 0 || count > 99999 || seconds <= 0 || samples < 0 || samples > 64) {
+		fprintf(stderr, "Invalid arguments\n");
+		return 1;
+	}
+
+	struct hostent* he = gethostbyname(host);
+	if (!he) {
+		fprintf(stderr, "Unknown host %s\n", host);
+		return 1;
+	}
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	memcpy(&addr.sin_addr, he->h_addr, he->h_length);
+	addr.sin_port = htons(port);
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr))) {
+		perror("socket");
+		return 1;
+	}
+	int bufsize = 4 * 1024 * 1024;
+	setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+
+	DEVICE* devices = calloc(count, sizeof(DEVICE));
+	double t = now();
+	if (login(devices, count)) return 1;
+	printf("%d devices logged in (%.2fs)\n", count, now() - t);
+
+	t = now();
+	uint32_t sent = blast(devices, count, seconds, rate, samples);
+	double sendTime = now() - t;
+	int missing;
+	double total = ping(devices, count, &missing) - t;
+
+	uint64_t processed = 0;
+	uint64_t expected = 0;
+	for (int i = 0; i < count; i++) {
+		if (!devices[i].replied) continue;
+		processed += devices[i].processed;
+		expected += devices[i].sent;
+	}
+	logout(devices, count);
+
+	printf("Sent: %u packets in %.2fs (%.0f packets/s)\n", sent, sendTime, sent / sendTime);
+	printf("Processed: %llu packets in %.2fs (%.0f packets/s)\n", (unsigned long long)processed, total, processed / total);
+	if (expected > processed) {
+		printf("Lost: %llu packets (%.2f%%)\n", (unsigned long long)(expected - processed), (expected - processed) * 100.0 / expected);
+	}
+	if (missing) {
+		printf("No ping reply from %d devices\n", missing);
+	}
+	free(devices);
+	close(sock);
+	return 0;
+}
@@ -14,6 +14,7 @@
 ******************************************************************************/
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include <fcntl.h>
 #include <stdint.h>
@@ -24,6 +25,7 @@
 #include "httpd.h"
 #include "teleserver.h"
 #include "logdata.h"
+#include "tripdata.h"
 #include "processpil.h"
 #include "revision.h"
 
@@ -77,8 +79,6 @@ char logDir[256] = "log";
 char serverKey[256] = { 0 };
 int noGUI = 0;
 
-CHANNEL_DATA ld[MAX_CHANNELS];
-
 uint8_t hex2uint8(const char *p)
 {
 	uint8_t c1 = *p;
@@ -154,34 +154,6 @@ int checkVIN(const char* vin)
 	return n >= 8;
 }
 
-CHANNEL_DATA* findChannelByID(uint32_t id)
-{
-	if (id) {
-		int i;
-		for (i = 0; i < MAX_CHANNELS; i++) {
-			if (ld[i].id == id) {
-				//printf("Channel found (ID:%u)\n", id);
-				return ld + i;
-			}
-		}
-	}
-	printf("Channel not found (ID:%u)\n", id);
-	return 0;
-}
-
-CHANNEL_DATA* findChannelByDeviceID(const char* devid)
-{
-	if (devid && *devid) {
-		int i;
-		for (i = 0; i < MAX_CHANNELS; i++) {
-			if (ld[i].id && !strcmp(ld[i].devid, devid)) {
-				return ld + i;
-			}
-		}
-	}
-	return 0;
-}
-
 void initChannel(CHANNEL_DATA* pld, int cacheSize)
 {
 	pld->cacheSize = min(cacheSize, CACHE_MAX_SIZE);
@@ -195,39 +167,6 @@ void initChannel(CHANNEL_DATA* pld, int cacheSize)
 	memset(pld->cmd, 0, sizeof(pld->cmd));
 }
 
-CHANNEL_DATA* findEmptyChannel()
-{
-	unsigned int id = 1;
-	int index = -1;
-	int i;
-	for (i = 0; i < MAX_CHANNELS; i++) {
-		if (ld[i].id >= id) {
-			id = ld[i].id + 1;
-		}
-	}
-	for (i = 0; i < MAX_CHANNELS; i++) {
-		if (!ld[i].id) {
-			// empty channel found
-			index = i;
-			break;
-		}
-	}
-	if (index == -1) {
-		return 0;
-	}
-	// initialize channel
-	memset(&ld[index], 0, sizeof(CHANNEL_DATA));
-	ld[index].id = id;
-	return ld + index;
-}
-
-void removeChannel(CHANNEL_DATA* pld)
-{
-	if (pld->cache) free(pld->cache);
-	if (pld->fp) fclose(pld->fp);
-	memset(pld, 0, sizeof(CHANNEL_DATA));
-}
-
 FILE* getLogFile()
 {
 	static uint32_t curDate = 0;
@@ -251,11 +190,11 @@ FILE* getLogFile()
 	return fpLog;
 }
 
-FILE* createDataFile(CHANNEL_DATA* pld)
+TRIP_WRITER* createDataFile(CHANNEL_DATA* pld)
 {
 	if (!pld) return NULL;
 
-	if (pld->fp) fclose(pld->fp);
+	closeDataFile(pld);
 
 	// Create data directory if it doesn't exist yet, print error message on failure
 	if (!IsDir(dataDir) && mkdir(dataDir, 0755) < 0) {
@@ -278,25 +217,29 @@ FILE* createDataFile(CHANNEL_DATA* pld)
 	mkdir(filename, 0755);
 	n += snprintf(filename + n, sizeof(filename) - n, "/%02u", btm->tm_mday);
 	mkdir(filename, 0755);
-	n += snprintf(filename + n, sizeof(filename) - n, "/%04u%02u%02u-%02u%02u%02u.txt",
+	n += snprintf(filename + n, sizeof(filename) - n, "/%04u%02u%02u-%02u%02u%02u.bin",
 		btm->tm_year + 1900,
 		btm->tm_mon + 1,
 		btm->tm_mday,
 		btm->tm_hour,
 		btm->tm_min,
 		btm->tm_sec);
-	pld->fp = fopen(filename, "a+");
-	if (!pld->fp) return 0;
-	if (ftell(pld->fp) == 0) {
+	struct stat st;
+	int newFile = stat(filename, &st) || st.st_size == 0;
+	pld->trip = tripCreate(filename);
+	if (!pld->trip) return 0;
+	if (newFile) {
 		// write initial data
 		if (pld->data[PID_GPS_LATITUDE].ts && pld->data[PID_GPS_LONGITUDE].ts) {
-			fprintf(pld->fp, "%X:%s,%X:%s,%X:%s\n",
+			char line[MAX_PID_DATA_LEN * 3 + 32];
+			int len = snprintf(line, sizeof(line), "%X:%s,%X:%s,%X:%s",
 				PID_GPS_LATITUDE, pld->data[PID_GPS_LATITUDE].value,
 				PID_GPS_LONGITUDE, pld->data[PID_GPS_LONGITUDE].value,
 				PID_GPS_ALTITUDE, pld->data[PID_GPS_ALTITUDE].value);
+			writeDataFile(pld, line, len);
 		}
 	}
-	return pld->fp;
+	return pld->trip;
 }
 
 void deviceLogin(CHANNEL_DATA* pld)
@@ -309,7 +252,7 @@ void deviceLogin(CHANNEL_DATA* pld)
 	pld->recvCount = 0;
 	pld->txCount = 0;
 	pld->elapsedTime = 0;
-	SaveChannels();
+	SaveChannel(pld);
 	createDataFile(pld);
 	fprintf(getLogFile(), " LOGIN:%s\n", pld->devid);
 }
@@ -319,79 +262,93 @@ void deviceLogout(CHANNEL_DATA* pld)
 	uint64_t serverTick = GetTickCount64();
 	pld->flags &= ~FLAG_RUNNING;
 	pld->serverPingTick = serverTick;
-	if (pld->fp) {
-		fclose(pld->fp);
-		pld->fp = 0;
-	}
+	closeDataFile(pld);
 	fprintf(getLogFile(), " LOGOUT:%s\n", pld->devid);
 }
 
-int processPayload(char* payload, CHANNEL_DATA* pld, uint16_t eventID)
+/* locates data samples without modifying payload, returns sample count or -1 if more than maxSamples */
+int parsePayload(const char* payload, PAYLOAD_SAMPLE* samples, int maxSamples, uint32_t* ts)
 {
-	uint64_t tick = GetTickCount64();
-	if (eventID == 0) {
-		if (!pld->fp && (pld->flags & FLAG_RUNNING)) {
-			createDataFile(pld);
-		}
-		// save data to log file
-		if (pld->fp) {
-			fprintf(pld->fp, "%s\n", payload);
-		}
-	}
-
-	char *p = payload;
-	uint32_t ts = 0;
+	const char *p = payload;
 	int count = 0;
+	*ts = 0;
 	do {
 		int pid = hex2uint16(p);
 		if (pid == -1) {
 			p = strchr(p, ',');
-			if (p) *(p++) = 0;
+			if (p) p++;
 			continue;
 		}
 		while (ishex(*p)) p++;
 		if (*p != ':' && *p != '=') break;
-		char *value = ++p;
+		const char *value = ++p;
 		p = strchr(p, ',');
-		if (p) *(p++) = 0;
-		size_t len = strlen(value);
+		size_t len = p ? (size_t)(p++ - value) : strlen(value);
 		if (len >= MAX_PID_DATA_LEN) len = MAX_PID_DATA_LEN - 1;
 		// now we have pid and value
 		if (pid == 0) {
 			// special PID 0 for timestamp
-			ts = atol(value);
+			*ts = atol(value);
 			continue;
 		}
-		if (ts == 0) {
+		if (*ts == 0) {
 			// no valid timestamp yet
 			continue;
 		}
+		if (count == maxSamples) return -1;
+		samples[count].ts = *ts;
+		samples[count].pid = pid;
+		samples[count].offset = (uint32_t)(value - payload);
+		samples[count].len = (uint8_t)len;
+		count++;
+	} while (p && *p);
+	return count;
+}
+
+/* stores samples located by parsePayload in the channel and logs the payload */
+int applyPayload(const char* payload, PAYLOAD_SAMPLE* samples, int count, uint32_t ts, CHANNEL_DATA* pld, uint16_t eventID)
+{
+	uint64_t tick = GetTickCount64();
+	if (eventID == 0) {
+		if (!pld->trip && (pld->flags & FLAG_RUNNING)) {
+			createDataFile(pld);
+		}
+		// save data to log file
+		if (pld->trip) {
+			writeDataFile(pld, payload, strlen(payload));
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		int pid = samples[i].pid;
+		const char *value = payload + samples[i].offset;
+		uint8_t len = samples[i].len;
 		// store in table
 		int m = pid >> 8;
 		if (m < PID_MODES) {
-			pld->data[pid].ts = ts;
-			memcpy(pld->data[pid].value, value, len + 1);
+			pld->data[pid].ts = samples[i].ts;
+			memcpy(pld->data[pid].value, value, len);
+			pld->data[pid].value[len] = 0;
 			// collect some stats
 			switch (pid) {
 			case PID_RSSI: /* signal strength */
-				pld->rssi = atoi(value);
+				pld->rssi = atoi(pld->data[pid].value);
 				break;
 			case PID_DEVICE_TEMP:
-				pld->deviceTemp = atoi(value);
+				pld->deviceTemp = atoi(pld->data[pid].value);
 				break;
 			}
 		}
-		count++;
 		// store in cache
-		if (pld->cacheReadPos != pld->cacheWritePos && pld->cache[pld->cacheReadPos].ts > ts) {
+		if (pld->cacheReadPos != pld->cacheWritePos && pld->cache[pld->cacheReadPos].ts > samples[i].ts) {
 			// clear cache as data looks staled
 			pld->cacheReadPos = 0;
 			pld->cacheWritePos = 0;
 		}
 		CACHE_DATA *d = &pld->cache[pld->cacheWritePos];
-		d->ts = ts;
+		d->ts = samples[i].ts;
 		d->pid = pid;
-		d->len = (uint8_t)len;
+		d->len = len;
 		memcpy(d->data, value, len);
 		d->data[len] = 0;
 		// adjust cache pointers
@@ -401,7 +358,7 @@ int processPayload(char* payload, CHANNEL_DATA* pld, uint16_t eventID)
 			// move forward read pos to discard just overwrited data
 			pld->cacheReadPos = (pld->cacheReadPos + 1) % pld->cacheSize;
 		}
-	} while (p && *p);
+	}
 	if (ts == 0) ts = pld->deviceTick;
 	int interval = ts - pld->deviceTick;
 	pld->deviceTick = ts;
@@ -428,6 +385,23 @@ int processPayload(char* payload, CHANNEL_DATA* pld, uint16_t eventID)
 	return count;
 }
 
+int processPayload(char* payload, CHANNEL_DATA* pld, uint16_t eventID)
+{
+	PAYLOAD_SAMPLE buf[MAX_PAYLOAD_SAMPLES(UDP_DATAGRAM_SIZE)];
+	PAYLOAD_SAMPLE* samples = buf;
+	uint32_t ts;
+	// HTTP payloads can be larger than a datagram
+	int maxSamples = MAX_PAYLOAD_SAMPLES(strlen(payload));
+	if (maxSamples > MAX_PAYLOAD_SAMPLES(UDP_DATAGRAM_SIZE)) {
+		samples = malloc(maxSamples * sizeof(PAYLOAD_SAMPLE));
+		if (!samples) return 0;
+	}
+	int count = parsePayload(payload, samples, maxSamples, &ts);
+	count = applyPayload(payload, samples, count, ts, pld, eventID);
+	if (samples != buf) free(samples);
+	return count;
+}
+
 void __inline setPIDData(CHANNEL_DATA* pld, int pid, uint32_t ts, const char* value)
 {
 	pld->data[pid].ts = ts;
@@ -440,16 +414,30 @@ void SaveChannels()
 	snprintf(path, sizeof(path), "%s/channels.dat", dataDir);
 	FILE *fp = fopen(path, "wb");
 	if (!fp) return;
-	printf("Saving channels");
-	for (int i = 0; i < MAX_CHANNELS; i++) {
-		if (ld[i].id) printf(" [%d]", ld[i].id);
+	printf("Saving %u channels...", getChannelCount());
+	// one record per slot, so that SaveChannel() can rewrite a single record in place
+	for (int i = 0; i < getChannelSlots(); i++) {
+		fwrite(getChannelSlot(i), 1, sizeof(CHANNEL_DATA), fp);
 	}
-	printf("...");
-	fwrite(ld, MAX_CHANNELS, sizeof(CHANNEL_DATA), fp);
 	fclose(fp);
 	printf("OK\n");
 }
 
+void SaveChannel(CHANNEL_DATA* pld)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s/channels.dat", dataDir);
+	int index = getChannelIndex(pld);
+	FILE *fp = index >= 0 ? fopen(path, "r+b") : 0;
+	if (!fp) {
+		SaveChannels();
+		return;
+	}
+	fseek(fp, (long)index * sizeof(CHANNEL_DATA), SEEK_SET);
+	fwrite(pld, 1, sizeof(CHANNEL_DATA), fp);
+	fclose(fp);
+}
+
 int LoadChannels()
 {
 	char path[256];
@@ -460,42 +448,61 @@ int LoadChannels()
 	fseek(fp, 0, SEEK_END);
 	unsigned int len = ftell(fp);
 	fseek(fp, 0, SEEK_SET);
-	if (len == MAX_CHANNELS * sizeof(CHANNEL_DATA)) {
-		fread(ld, MAX_CHANNELS, sizeof(CHANNEL_DATA), fp);
+	if (len % sizeof(CHANNEL_DATA)) {
+		fprintf(stderr, "Channel data file size mismatch (expected multiple of %u, actual %u)\n", (unsigned int)sizeof(CHANNEL_DATA), len);
+		fclose(fp);
+		return 0;
 	}
-	else {
-		fprintf(stderr, "Channel data file size mismatch (expected %u, actual %u)\n", (unsigned int)(MAX_CHANNELS * sizeof(CHANNEL_DATA)), len);
+	CHANNEL_DATA* saved = malloc(sizeof(CHANNEL_DATA));
+	if (!saved) {
+		fclose(fp);
+		return 0;
 	}
-	fclose(fp);
 	int count = 0;
-	for (int i = 0; i < MAX_CHANNELS; i++) {
+	for (int i = 0; fread(saved, sizeof(CHANNEL_DATA), 1, fp) == 1; i++) {
 		int valid = 1;
-		for (char* p = ld[i].devid; *p; p++) if (!isalpha(*p) && !isdigit(*p)) valid = 0;
-		if (ld[i].id && valid) {
-			printf("[%u] ID:%u DEVID:%s\n", i, ld[i].id, ld[i].devid);
-			ld[i].fp = 0; /* file handle no longer valid*/
-			initChannel(&ld[i], ld[i].cacheSize);
-			count++;
-		}
-		else {
-			memset(ld + i, 0, sizeof(CHANNEL_DATA));
+		saved->devid[sizeof(saved->devid) - 1] = 0;
+		for (char* p = saved->devid; *p; p++) if (!isalpha(*p) && !isdigit(*p)) valid = 0;
+		if (!saved->id || !valid) continue;
+		saved->trip = 0; /* file handle no longer valid*/
+		CHANNEL_DATA* pld = restoreChannel(saved);
+		if (!pld) {
+			fprintf(stderr, "[%u] ID:%u DEVID:%s not restored\n", i, saved->id, saved->devid);
+			continue;
 		}
+		printf("[%u] ID:%u DEVID:%s\n", i, pld->id, pld->devid);
+		initChannel(pld, pld->cacheSize);
+		count++;
 	}
+	free(saved);
+	fclose(fp);
 	printf("%d channels loaded\n", count);
+	// records are kept in slot order from now on
+	SaveChannels();
 	return count;
 }
 
 void CheckChannels()
 {
+	static uint64_t flushTick = 0;
 	uint64_t tick = GetTickCount64();
-	for (int i = 0; i < MAX_CHANNELS; i++) {
-		if (!ld[i].id) continue;
-		CHANNEL_DATA* pld = ld + i;
+	int flush = tick - flushTick >= DATA_FLUSH_INTERVAL * 1000;
+	if (flush) flushTick = tick;
+	for (int i = 0; i < getChannelSlots(); i++) {
+		CHANNEL_DATA* pld = getChannelSlot(i);
+		if (!pld->id) continue;
 		if (pld->flags & FLAG_RUNNING) {
 			if (tick - pld->serverDataTick > CHANNEL_TIMEOUT * 1000) {
 				pld->flags &= ~FLAG_RUNNING;
 			}
 		}
+		if (flush) {
+			/*
+			samples of a device sending slowly or timed out are not held for a whole block,
+			the data file stays open for data still coming in until the next login
+			*/
+			flushDataFile(pld);
+		}
 	}
 }
 
@@ -568,6 +575,31 @@ CHANNEL_DATA* locateChannel(UrlHandlerParam* param)
 	return pld;
 }
 
+/* bounded append for the channel lists: returns 0 and leaves *pl as it was if the text does not fit in bs */
+static int appendf(char* buf, int bs, int* pl, const char* fmt, ...)
+{
+	int room = bs - *pl;
+	if (room <= 0) return 0;
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(buf + *pl, room, fmt, args);
+	va_end(args);
+	if (n < 0 || n >= room) return 0;
+	*pl += n;
+	return 1;
+}
+
+static int appendData(char* buf, int bs, int* pl, const char* s)
+{
+	// copyData writes at most strlen(s) + 2 characters and the terminator
+	if (bs - *pl < (int)strlen(s) + 3) return 0;
+	*pl += copyData(buf + *pl, s);
+	return 1;
+}
+
+/* room kept at the end of the buffer for closing a truncated channel list */
+#define CHANNEL_LIST_TAIL 32
+
 int uhChannelsXML(UrlHandlerParam* param)
 {
 	int extend = mwGetVarValueInt(param->pxVars, "extend", 0);
@@ -577,37 +609,49 @@ int uhChannelsXML(UrlHandlerParam* param)
 		param->hs->ipAddr.caddr[3], param->hs->ipAddr.caddr[2], param->hs->ipAddr.caddr[1], param->hs->ipAddr.caddr[0]);
 	*/
 
-	char *p = param->pucBuffer;
-	p += sprintf(p, "<?xml version=\"1.0\" encoding=\"utf-8\"?><channels>\n");
-	for (int n = 0; n < MAX_CHANNELS; n++) {
-		CHANNEL_DATA* pld = ld + n;
+	char *buf = param->pucBuffer;
+	int bs = param->bufSize;
+	int lim = bs - CHANNEL_LIST_TAIL;
+	int l = 0;
+	int truncated = 0;
+	appendf(buf, lim, &l, "<?xml version=\"1.0\" encoding=\"utf-8\"?><channels>\n");
+	for (int n = 0; n < getChannelSlots(); n++) {
+		CHANNEL_DATA* pld = getChannelSlot(n);
+		int mark = l;
+		int ok;
 		if (pld->id) {
-			p += sprintf(p, "<channel id=\"%u\" devid=\"%s\" recv=\"%u\" rate=\"%u\" tick=\"%u\" elapsed=\"%u\" age=\"%u\" parked=\"%u\" rssi=\"%d\" flags=\"%u\"",
+			ok = appendf(buf, lim, &l, "<channel id=\"%u\" devid=\"%s\" recv=\"%u\" rate=\"%u\" tick=\"%u\" elapsed=\"%u\" age=\"%u\" parked=\"%u\" rssi=\"%d\" flags=\"%u\"",
 				pld->id, pld->devid, pld->dataReceived, (unsigned int)pld->sampleRate, pld->deviceTick, pld->elapsedTime, 
 				(int)(tick - pld->serverDataTick), (pld->flags & FLAG_RUNNING) ? 0 : 1, (int)pld->rssi, pld->devflags);
 
-			if (extend) {
-				if (*pld->vin) p += sprintf(p, "<vin>%s</vin>", pld->vin);
-				p += sprintf(p, "><cache size=\"%u\" read=\"%u\" write=\"%u\"/></channel>\n",
+			if (ok && extend) {
+				if (*pld->vin) ok = appendf(buf, lim, &l, "<vin>%s</vin>", pld->vin);
+				if (ok) ok = appendf(buf, lim, &l, "><cache size=\"%u\" read=\"%u\" write=\"%u\"/></channel>\n",
 					pld->cacheSize, pld->cacheReadPos, pld->cacheWritePos);
-				if (pld->ip.laddr) {
-					p += sprintf(p, "<ip>%u.%u.%u.%u</ip>", pld->ip.caddr[3], pld->ip.caddr[2], pld->ip.caddr[1], pld->ip.caddr[0]);
+				if (ok && pld->ip.laddr) {
+					ok = appendf(buf, lim, &l, "<ip>%u.%u.%u.%u</ip>", pld->ip.caddr[3], pld->ip.caddr[2], pld->ip.caddr[1], pld->ip.caddr[0]);
 				}
-				else {
-					p += sprintf(p, "<ip>%s</ip>", inet_ntoa(pld->udpPeer.sin_addr));
+				else if (ok) {
+					ok = appendf(buf, lim, &l, "<ip>%s</ip>", inet_ntoa(pld->udpPeer.sin_addr));
 				}
 			}
-			else {
-				p += sprintf(p, "/>\n");
+			else if (ok) {
+				ok = appendf(buf, lim, &l, "/>\n");
 			}
 
 		}
 		else {
-			p += sprintf(p, "<channel/>\n");
+			ok = appendf(buf, lim, &l, "<channel/>\n");
+		}
+		if (!ok) {
+			// buffer full: drop the partial channel and say the list is incomplete
+			l = mark;
+			truncated = 1;
+			break;
 		}
 	}
-	p += sprintf(p, "</channels>");
-	param->contentLength = (int)(p - param->pucBuffer);
+	appendf(buf, bs, &l, truncated ? "<eos>0</eos></channels>" : "</channels>");
+	param->contentLength = l;
 	param->contentType = HTTPFILETYPE_XML;
 	return FLAG_DATA_RAW;
 }
@@ -648,11 +692,13 @@ int uhChannels(UrlHandlerParam* param)
 			id = 0;
 		}
 	}
+	int lim = bs - CHANNEL_LIST_TAIL;
+	int truncated = 0;
 	if (!devid) {
-		l += snprintf(buf + l, bs - l, "{\"channels\":[");
+		appendf(buf, lim, &l, "{\"channels\":[");
 	}
-	for (n = 0; n < MAX_CHANNELS; n++) {
-		CHANNEL_DATA* pld = ld + n;
+	for (n = 0; n < getChannelSlots(); n++) {
+		CHANNEL_DATA* pld = getChannelSlot(n);
 		if (!pld->id) continue;
 		if (devid && strcmp(pld->devid, devid)) continue;
 		if (id == 0 || pld->id == id) {
@@ -662,46 +708,53 @@ int uhChannels(UrlHandlerParam* param)
 				removeChannel(pld);
 				continue;
 			}
-			l += snprintf(buf + l, bs - l, "\n{\"id\":\"%u\",\"devid\":\"%s\",\"recv\":%u,\"rate\":%u,\"tick\":%llu,\"devtick\":%u,\"elapsed\":%u,\"age\":{\"data\":%u,\"ping\":%u},\"rssi\":%d,\"flags\":%u,\"parked\":%u",
+			int mark = l;
+			int ok = appendf(buf, lim, &l, "\n{\"id\":\"%u\",\"devid\":\"%s\",\"recv\":%u,\"rate\":%u,\"tick\":%llu,\"devtick\":%u,\"elapsed\":%u,\"age\":{\"data\":%u,\"ping\":%u},\"rssi\":%d,\"flags\":%u,\"parked\":%u",
 				pld->id, pld->devid, pld->dataReceived, (unsigned int)pld->sampleRate, pld->serverDataTick, pld->deviceTick, pld->elapsedTime,
 				age, pingage, (int)pld->rssi, pld->devflags, (pld->flags & FLAG_RUNNING) ? 0 : 1);
 
-			if (extend) {
+			if (ok && extend) {
 				if (*pld->vin) {
-					l += snprintf(buf + l, bs - l, ",\"vin\":\"%s\"", pld->vin);
+					ok = appendf(buf, lim, &l, ",\"vin\":\"%s\"", pld->vin);
 				}
-				if (pld->ip.laddr) {
-					l += snprintf(buf + l, bs - l, ",\"ip\":\"%u.%u.%u.%u\"", pld->ip.caddr[3], pld->ip.caddr[2], pld->ip.caddr[1], pld->ip.caddr[0]);
+				if (ok && pld->ip.laddr) {
+					ok = appendf(buf, lim, &l, ",\"ip\":\"%u.%u.%u.%u\"", pld->ip.caddr[3], pld->ip.caddr[2], pld->ip.caddr[1], pld->ip.caddr[0]);
 				}
-				else {
-					l += snprintf(buf + l, bs - l, ",\"ip\":\"%s\"", inet_ntoa(pld->udpPeer.sin_addr));
+				else if (ok) {
+					ok = appendf(buf, lim, &l, ",\"ip\":\"%s\"", inet_ntoa(pld->udpPeer.sin_addr));
 				}
 			}
 
-			if (data) {
-				l += snprintf(buf + l, bs - l, ",\"data\":[");
-				for (unsigned int i = 0; i < 0x100 * PID_MODES; i++) {
+			if (ok && data) {
+				ok = appendf(buf, lim, &l, ",\"data\":[");
+				for (unsigned int i = 0; ok && i < 0x100 * PID_MODES; i++) {
 					if (pld->data[i].ts) {
-						l += snprintf(buf + l, bs - l, "[%u,", i);
-						l += copyData(buf + l, pld->data[i].value);
-						l += snprintf(buf + l, bs - l, ",%u],", age + (pld->deviceTick - pld->data[i].ts));
+						ok = appendf(buf, lim, &l, "[%u,", i)
+							&& appendData(buf, lim, &l, pld->data[i].value)
+							&& appendf(buf, lim, &l, ",%u],", age + (pld->deviceTick - pld->data[i].ts));
 					}
 				}
-				if (buf[l - 1] == ',') l--;
-				l += snprintf(buf + l, bs - l, "]");
+				if (ok && buf[l - 1] == ',') l--;
+				if (ok) ok = appendf(buf, lim, &l, "]");
+			}
+			if (ok) ok = appendf(buf, lim, &l, "},");
+			if (!ok) {
+				// buffer full: drop the partial channel and say the list is incomplete
+				l = mark;
+				truncated = 1;
+				break;
 			}
-			l += snprintf(buf + l, bs - l, "},");
 		}
 	}
 
 	if (l == 0) {
-		l += snprintf(buf + l, bs - l, "{}");
+		appendf(buf, bs, &l, "{}");
 	}
 	else if (buf[l - 1] == ',') {
 		buf[--l] = 0;
 	}
 	if (!devid) {
-		l += snprintf(buf + l, bs - l, "]}");
+		appendf(buf, bs, &l, truncated ? "],\"eos\":0}" : "]}");
 	}
 	param->contentLength = l;
 	param->contentType = HTTPFILETYPE_JSON;
@@ -727,11 +780,11 @@ CHANNEL_DATA* assignChannel(const char* devid)
 	if (pld) {
 		return pld;
 	}
-	pld = findEmptyChannel();
+	pld = findEmptyChannel(devid);
 	if (!pld) {
+		fprintf(getLogFile(), "No channel available for %s (max %u)\n", devid, maxChannels);
 		return 0;
 	}
-	strncpy(pld->devid, devid, sizeof(pld->devid) - 1);
 	initChannel(pld, CACHE_INIT_SIZE);
 
 	// clear history data cache
@@ -743,7 +796,7 @@ CHANNEL_DATA* assignChannel(const char* devid)
 	pld->dataReceived = 0;
 	pld->elapsedTime = 0;
 	pld->serverDataTick = GetTickCount64();
-	SaveChannels();
+	SaveChannel(pld);
 	printf("DEVID:%s ID:%u\r\n", devid, pld->id);
 	return pld;
 }
@@ -826,8 +879,138 @@ int uhGet(UrlHandlerParam* param)
 	return FLAG_DATA_RAW;
 }
 
+#define PULL_HEAD 0
+#define PULL_DATA 1
+#define PULL_DONE 2
+
+/* state of a streamed pull response, kept in hs->ptr */
+typedef struct {
+	CHANNEL_DATA* pld;
+	CACHE_DATA* cache;
+	uint32_t id;
+	uint32_t pos; /* next cache entry to send */
+	uint32_t end; /* cache write position at the time of request */
+	uint32_t lastts;
+	uint64_t endts;
+	int pid;
+	int count; /* data entries sent */
+	int state;
+} PULL_STREAM;
+
+static int formatUint(char* d, uint32_t v)
+{
+	char tmp[10];
+	int n = 0;
+	do {
+		tmp[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	for (int i = 0; i < n; i++) d[i] = tmp[n - 1 - i];
+	return n;
+}
+
+static int isPullValid(PULL_STREAM* ps)
+{
+	CHANNEL_DATA* pld = ps->pld;
+	if (pld->id != ps->id || pld->cache != ps->cache) return 0;
+	if (ps->pos == ps->end) return 1;
+	// entries still to send must not have been cleared or overwritten meanwhile
+	uint32_t size = pld->cacheSize;
+	uint32_t cached = (pld->cacheWritePos + size - pld->cacheReadPos) % size;
+	uint32_t offset = (ps->pos + size - pld->cacheReadPos) % size;
+	uint32_t remain = (ps->end + size - ps->pos) % size;
+	return offset + remain <= cached && pld->cache[ps->pos].ts >= ps->lastts;
+}
+
+static int streamPull(UrlHandlerParam* param)
+{
+	PULL_STREAM* ps = (PULL_STREAM*)param->hs->ptr;
+	if (!param->pucBuffer) {
+		// connection done
+		free(ps);
+		param->hs->ptr = 0;
+		return 0;
+	}
+	if (!ps || ps->state == PULL_DONE) return 0;
+
+	CHANNEL_DATA* pld = ps->pld;
+	char* buf = param->pucBuffer;
+	int bufsize = param->bufSize;
+	int bytes = 0;
+
+	if (ps->state == PULL_HEAD) {
+		uint64_t tick = GetTickCount64();
+		unsigned int age = (unsigned int)(tick - pld->serverDataTick);
+		unsigned int pingage = (unsigned int)(tick - pld->serverPingTick);
+
+		bytes += sprintf(buf + bytes, "{");
+		bytes += snprintf(buf + bytes, bufsize - bytes, "\"stats\":{\"recv\":%u,\"rate\":%u,\"tick\":%llu,\"devtick\":%u,\"elapsed\":%u,\"age\":{\"data\":%u,\"ping\":%u},\"parked\":%u}",
+			pld->dataReceived, (unsigned int)pld->sampleRate, pld->serverDataTick, pld->deviceTick, pld->elapsedTime, age, pingage, (pld->flags & FLAG_RUNNING) ? 0 : 1);
+
+		bytes += snprintf(buf + bytes, bufsize - bytes, ",\"live\":[");
+		for (unsigned int i = 0; i < 0x100 * PID_MODES; i++) {
+			if (pld->data[i].ts) {
+				bytes += snprintf(buf + bytes, bufsize - bytes, "[%u,", i);
+				bytes += copyData(buf + bytes, pld->data[i].value);
+				bytes += snprintf(buf + bytes, bufsize - bytes, "],");
+			}
+		}
+		if (buf[bytes - 1] == ',') bytes--;
+		bytes += snprintf(buf + bytes, bufsize - bytes, "]");
+		// start of data array
+		bytes += sprintf(buf + bytes, ",\"data\":[");
+		ps->state = PULL_DATA;
+	}
+
+	int eos = -1;
+	if (!isPullValid(ps)) {
+		// client carries on from the last timestamp received
+		eos = 0;
+	}
+	else {
+		// entries are formatted right into the socket buffer until it is nearly full
+		char* p = buf + bytes;
+		char* end = buf + bufsize - MAX_PID_DATA_LEN - 64;
+		for (; p < end; ps->pos = (ps->pos + 1) % pld->cacheSize) {
+			if (ps->pos == ps->end) {
+				// cache completely read
+				eos = 1;
+				break;
+			}
+			CACHE_DATA *d = pld->cache + ps->pos;
+			if (ps->endts && d->ts >= ps->endts) {
+				eos = 0;
+				break;
+			}
+			ps->lastts = d->ts;
+			if (!d->data[0] || (ps->pid && ps->pid != d->pid)) continue;
+			if (ps->count++) *(p++) = ',';
+			*(p++) = '[';
+			p += formatUint(p, d->ts);
+			*(p++) = ',';
+			p += formatUint(p, d->pid);
+			*(p++) = ',';
+			p += copyData(p, d->data);
+			*(p++) = ']';
+		}
+		bytes = (int)(p - buf);
+	}
+	if (eos >= 0) {
+		// end of data array
+		bytes += sprintf(buf + bytes, "],\"eos\":%d}", eos);
+		ps->state = PULL_DONE;
+	}
+	param->contentLength = bytes;
+	return FLAG_DATA_STREAM;
+}
+
 int uhPull(UrlHandlerParam* param)
 {
+	if (ISFLAGSET(param->hs, FLAG_DATA_STREAM)) {
+		// next piece of response
+		return streamPull(param);
+	}
+
 	param->contentType = HTTPFILETYPE_JSON;
 	param->contentLength = 0;
 	CHANNEL_DATA *pld = locateChannel(param);
@@ -842,76 +1025,41 @@ int uhPull(UrlHandlerParam* param)
 	uint32_t rollback = mwGetVarValueInt(param->pxVars, "rollback", 0);
 	int pid = mwGetVarValueInt(param->pxVars, "pid", 0);
 
-	uint64_t tick = GetTickCount64();
-	unsigned int age = (unsigned int)(tick - pld->serverDataTick);
-	unsigned int pingage = (unsigned int)(tick - pld->serverPingTick);
-
-	int bytes = 0;
-	char* buf = param->pucBuffer;
-	int bufsize = param->bufSize;
-
-	bytes += sprintf(buf + bytes, "{");
-	bytes += snprintf(buf + bytes, bufsize - bytes, "\"stats\":{\"recv\":%u,\"rate\":%u,\"tick\":%llu,\"devtick\":%u,\"elapsed\":%u,\"age\":{\"data\":%u,\"ping\":%u},\"parked\":%u}",
-		pld->dataReceived, (unsigned int)pld->sampleRate, pld->serverDataTick, pld->deviceTick, pld->elapsedTime, age, pingage, (pld->flags & FLAG_RUNNING) ? 0 : 1);
-
-	bytes += snprintf(buf + bytes, bufsize - bytes, ",\"live\":[");
-	for (unsigned int i = 0; i < 0x100 * PID_MODES; i++) {
-		if (pld->data[i].ts) {
-			bytes += snprintf(buf + bytes, bufsize - bytes, "[%u,", i);
-			bytes += copyData(buf + bytes, pld->data[i].value);
-			bytes += snprintf(buf + bytes, bufsize - bytes, "],");
-		}
-	}
-	if (buf[bytes - 1] == ',') bytes--;
-	bytes += snprintf(buf + bytes, bufsize - bytes, "]");
-
 	if (rollback) {
 		// calculate and override ts
 		uint64_t t = GetTickCount64() - pld->serverDataTick + pld->deviceTick;
 		startts = t > rollback ? (t - rollback) : 0;
 	}
-	// start of data array
-	bytes += sprintf(buf + bytes, ",\"data\":[");
-	uint32_t readPos = pld->cacheReadPos;
-	uint64_t begin = 0;
-	int bytesMargin = bytes;
+
+	PULL_STREAM* ps = calloc(1, sizeof(PULL_STREAM));
+	if (!ps) {
+		param->hs->response.statusCode = 503;
+		return FLAG_DATA_RAW;
+	}
+	ps->pld = pld;
+	ps->cache = pld->cache;
+	ps->id = pld->id;
+	ps->end = pld->cacheWritePos;
+	ps->endts = endts;
+	ps->pid = pid;
+	ps->state = PULL_HEAD;
+
+	// locate the first entry to send, the whole requested range goes out in one response
 	uint32_t lastts = 0;
-	for (; readPos != pld->cacheWritePos; readPos = (readPos + 1) % pld->cacheSize) {
-		CACHE_DATA *d = pld->cache + readPos;
-		if (d->ts < lastts) {
+	ps->pos = ps->end;
+	for (uint32_t readPos = pld->cacheReadPos; readPos != ps->end; readPos = (readPos + 1) % pld->cacheSize) {
+		uint32_t ts = pld->cache[readPos].ts;
+		if (ts < lastts) {
 			// timestamp looping or device reset detected, wipe out all previous data
-			bytes = bytesMargin;
+			ps->pos = ps->end;
 		}
-		lastts = d->ts;
-		if (d->ts >= startts) {
-			if (endts && d->ts >= endts) break;
-			if (bytes + d->len + 64 > bufsize) {
-				// buffer full
-				break;
-			}
-			if (d->data[0] && (pid == 0 || pid == d->pid)) {
-				bytes += sprintf(buf + bytes, "[%u,%d,", d->ts, d->pid);
-				bytes += copyData(buf + bytes, d->data);
-				bytes += sprintf(buf + bytes, "],");
-			}
-			// keep ts range
-			if (begin == 0) begin = d->ts;
-		}
-	}
-	if (buf[bytes - 1] == ',') bytes--;
-	// end of data array
-	buf[bytes++] = ']';
-	if (readPos == pld->cacheWritePos) {
-		// cache completely read
-		bytes += sprintf(buf + bytes, ",\"eos\":1");
-	}
-	else {
-		bytes += sprintf(buf + bytes, ",\"eos\":0");
+		if (ts >= startts && ps->pos == ps->end) ps->pos = readPos;
+		lastts = ts;
 	}
-	buf[bytes++] = '}';
-	buf[bytes] = 0;
-	param->contentLength = bytes;
-	return FLAG_DATA_RAW;
+	ps->lastts = ps->pos == ps->end ? 0 : pld->cache[ps->pos].ts;
+
+	param->hs->ptr = ps;
+	return FLAG_DATA_STREAM | FLAG_CHUNK;
 }
 
 int isNum(const char* s)
@@ -1026,13 +1174,10 @@ int uhNotify(UrlHandlerParam* param)
 		return FLAG_DATA_RAW;
 	} else if (event == EVENT_LOGOUT) {
 		param->contentLength = snprintf(param->pucBuffer, param->bufSize, "{\"result\":\"done\"}");
-		if (pld->fp) {
-			fclose(pld->fp);
-			pld->fp = 0;
-		}
+		closeDataFile(pld);
 		pld->flags &= ~FLAG_RUNNING;
 		deviceLogout(pld);
-		SaveChannels();
+		SaveChannel(pld);
 		return FLAG_DATA_RAW;
 	}
 	else if (event == EVENT_SYNC) {
@@ -1153,7 +1298,7 @@ int main(int argc,char* argv[])
 	httpParam.udpPort = 8081;
 	httpParam.pxUrlHandler = urlHandlerList;
 	httpParam.hlBindIP = htonl(INADDR_ANY);
-	httpParam.pfnIncomingUDP = incomingUDPCallback;
+	httpParam.pfnUDPDatagram = incomingUDPDatagram;
 	httpParam.pfnProxyData = phData;
 
 #ifdef WIN32
@@ -1185,10 +1330,12 @@ int main(int argc,char* argv[])
 						"	-l	: specify log file directory\n"
 						"	-d	: specify data file directory\n"
 						"	-m	: specifiy max clients [default 256]\n"
+						"	-c	: specifiy max channels (devices) [default %u]\n"
 						"	-M	: specifiy max clients per IP\n"
 						"	-n	: specifiy HTTP authentication user name for remote access [default: admin]\n"
 						"	-w	: specifiy HTTP authentication password for remote access\n"
-						"	-g	: do not launch GUI\n\n");
+						"	-t	: specify UDP ingest worker threads [default: one per additional CPU core, 0 to disable]\n"
+						"	-g	: do not launch GUI\n\n", MAX_CHANNELS);
 					fflush(stderr);
 					exit(1);
 					break;
@@ -1201,6 +1348,9 @@ int main(int argc,char* argv[])
 				case 'M':
 					if ((++i)<argc) httpParam.maxClientsPerIP=atoi(argv[i]);
 					break;
+				case 'c':
+					if ((++i)<argc) maxChannels=atoi(argv[i]);
+					break;
 				case 'g':
 					noGUI = 1;
 					break;
@@ -1222,6 +1372,9 @@ int main(int argc,char* argv[])
 				case 'w':
 					if (++i < argc) strncpy(password, argv[i], sizeof(password) - 1);
 					break;
+				case 't':
+					if (++i < argc) ingestWorkers = atoi(argv[i]);
+					break;
 				}
 			}
 		}
@@ -1235,16 +1388,21 @@ int main(int argc,char* argv[])
 	if (httpParam.udpPort) {
 		printf("UDP Port: %u\n", httpParam.udpPort);
 	}
-	printf("Max Channels: %u\n", MAX_CHANNELS);
+	printf("Max Channels: %u\n", maxChannels);
 	if (password[0]) {
 		printf("Authentication: ON\n");
 	}
 	printf("\nWeb UI:\nhttp://%s:%u\n\n", GetLocalAddrString(), httpParam.httpPort);
 	printf("Data Feed Simulator:\nhttp://%s:%u/simulator.html\n\n", GetLocalAddrString(), httpParam.httpPort);
 
-	memset(ld, 0, sizeof(ld));
 	LoadChannels();
 
+	// hooks the UDP callbacks, so has to start before the server
+	int workers = startIngest(&httpParam);
+	if (workers) {
+		printf("Ingest Workers: %d\n", workers);
+	}
+
 	if (mwServerStart(&httpParam)) {
 		printf("Error starting HTTP server on port %u\nPress ENTER to exit\n", httpParam.httpPort);
 		return -1;
@@ -1275,6 +1433,11 @@ int main(int argc,char* argv[])
 		return 0;
 	}
 
+	// data files are closed while the log writer is still running
+	for (int i = 0; i < getChannelSlots(); i++) {
+		closeDataFile(getChannelSlot(i));
+	}
+	stopIngest();
 	mwServerExit(&httpParam);
 	return 0;
 }
@@ -13,8 +13,9 @@
 * THE SOFTWARE.
 ******************************************************************************/
 
+/* default channel limit, can be changed at run time with -c */
 #ifndef MAX_CHANNELS
-#define MAX_CHANNELS 16
+#define MAX_CHANNELS 65535
 #endif
 
 #define META_REVISION 1
@@ -24,6 +25,7 @@
 #define MAX_COMMAND_MSG_LEN 128
 #define SYNC_INTERVAL 30 /* seconds*/
 #define CHANNEL_TIMEOUT 180 /* seconds */
+#define DATA_FLUSH_INTERVAL 10 /* seconds, older buffered samples are written to the data file on the next check */
 #define SESSION_GAP (15 * 60 * 1000)
 #define MIN_DEVID_LEN 6
 #define MAX_DEVID_LEN 64
@@ -114,19 +116,73 @@ typedef struct {
 	// authorized UDP source address
 	struct sockaddr_in udpPeer;
 	// handles
-	FILE* fp;
+	struct _TRIP_WRITER* trip; /* data file being written */
 } CHANNEL_DATA;
 
-CHANNEL_DATA* findEmptyChannel();
+/* data sample located by parsePayload, value is at payload + offset */
+typedef struct {
+	uint32_t ts;
+	uint32_t offset;
+	uint16_t pid;
+	uint8_t len;
+} PAYLOAD_SAMPLE;
+
+/* a sample takes at least 3 bytes (<pid>:,) */
+#define MAX_PAYLOAD_SAMPLES(size) ((size) / 3 + 1)
+
+/* UDP datagram split up by parseDatagram, strings point into the datagram */
+typedef struct {
+	char* header; /* ID or device ID before '#' */
+	char* data; /* data payload or first field of an event */
+	char* devid;
+	char* vin;
+	char* key;
+	char* msg;
+	uint32_t deviceTick;
+	uint32_t token;
+	uint16_t eventID;
+	uint16_t devflags;
+	int rssi;
+	int len;
+	/* data samples (event 0), sampleCount is -1 if not parsed yet */
+	PAYLOAD_SAMPLE* samples;
+	int sampleCount;
+	uint32_t ts;
+} UDP_PACKET;
+
+/* channel registry (telechannels.c) */
+extern uint32_t maxChannels;
+CHANNEL_DATA* findEmptyChannel(const char* devid);
 CHANNEL_DATA* findChannelByID(uint32_t id);
 CHANNEL_DATA* findChannelByDeviceID(const char* devid);
+CHANNEL_DATA* restoreChannel(const CHANNEL_DATA* saved);
+void removeChannel(CHANNEL_DATA* pld);
+/* slots include removed channels (id 0), iterate with getChannelSlot(0 .. getChannelSlots() - 1) */
+int getChannelSlots();
+CHANNEL_DATA* getChannelSlot(int index);
+int getChannelIndex(CHANNEL_DATA* pld);
+uint32_t getChannelCount();
+
 void SaveChannels();
+void SaveChannel(CHANNEL_DATA* pld);
 FILE* getLogFile();
 uint8_t hex2uint8(const char *p);
 int hex2uint16(const char *p);
 int checkVIN(const char* vin);
 int processPayload(char* payload, CHANNEL_DATA* pld, uint16_t eventID);
+int parsePayload(const char* payload, PAYLOAD_SAMPLE* samples, int maxSamples, uint32_t* ts);
+int applyPayload(const char* payload, PAYLOAD_SAMPLE* samples, int count, uint32_t ts, CHANNEL_DATA* pld, uint16_t eventID);
 uint32_t issueCommand(HttpParam* hp, CHANNEL_DATA *pld, const char* cmd, uint32_t token);
-int incomingUDPCallback(void* _hp);
+int parseDatagram(char* buf, int len, UDP_PACKET* pkt, PAYLOAD_SAMPLE* samples, int maxSamples);
+int applyDatagram(UDP_PACKET* pkt, int result, struct sockaddr_in* peer, char* reply, int replySize);
+int incomingUDPDatagram(void* _hp, char* buf, int recv, struct sockaddr_in* peer, char* reply, int replySize);
 void deviceLogin(CHANNEL_DATA* pld);
-void deviceLogout(CHANNEL_DATA* pld);
\ No newline at end of file
+void deviceLogout(CHANNEL_DATA* pld);
+
+/* ingest pipeline (teleingest.c) */
+extern int ingestWorkers;
+int startIngest(HttpParam* hp);
+void stopIngest();
+void writeDataFile(CHANNEL_DATA* pld, const char* line, int len);
+void closeDataFile(CHANNEL_DATA* pld);
+void flushDataFile(CHANNEL_DATA* pld);
\ No newline at end of file
@@ -24,8 +24,7 @@
 #include "teleserver.h"
 #include "logdata.h"
 #include "data2kml.h"
-
-extern CHANNEL_DATA ld[];
+#include "tripdata.h"
 
 int loadConfig();
 char* getUserByDeviceID(const char* devid);
@@ -131,8 +130,19 @@ int UploadCallback(HttpMultipart *pxMP, OCTET *poData, size_t dwDataChunkSize)
 #endif
 
 int ConvertToKML(KML_DATA* kd, FILE* fp, const char* kmlfile, uint32_t startpos, uint32_t endpos);
+int ConvertTripToKML(KML_DATA* kd, const char* tripfile, const char* kmlfile, uint32_t startpos, uint32_t endpos);
 void CleanupKML(KML_DATA* kd);
 
+/* locates data file of a trip, returns 1 for binary, 0 for text (before binary data files) or -1 if not found */
+static int getDataFile(const char* file, char* path, int size)
+{
+	snprintf(path, size, "%s/%s.bin", dataDir, file);
+	if (IsFileExist(path)) return 1;
+	snprintf(path, size, "%s/%s.txt", dataDir, file);
+	if (IsFileExist(path)) return 0;
+	return -1;
+}
+
 void WriteGeoJSON(FILE* fpout, KML_DATA* kd, int size, int count)
 {
 	int pos = fprintf(fpout, "{\"meta\":{\"rev\":%u,\"size\":%u,\"samples\":%u,\"duration\":", META_REVISION, size, count);
@@ -203,20 +213,34 @@ void WriteGeoJSON(FILE* fpout, KML_DATA* kd, int size, int count)
 int CreateDataFiles(KML_DATA* kd, const char* file)
 {
 	char path[256];
+	char kmlpath[256];
 	FILE* fp;
 	int count;
 	int size;
 
-	snprintf(path, sizeof(path), "%s/%s.txt", dataDir, file);
-	fp = fopen(path, "r");
-	if (!fp) {
+	int binary = getDataFile(file, path, sizeof(path));
+	if (binary < 0) {
+		return -1;
+	}
+	snprintf(kmlpath, sizeof(kmlpath), "%s/%s.kml", dataDir, file);
+	if (binary) {
+		count = ConvertTripToKML(kd, path, kmlpath, 0, 0);
+		struct stat st;
+		size = stat(path, &st) ? 0 : (int)st.st_size;
+	}
+	else {
+		fp = fopen(path, "r");
+		if (!fp) {
+			return -1;
+		}
+		count = ConvertToKML(kd, fp, kmlpath, 0, 0);
+		fseek(fp, 0, SEEK_END);
+		size = ftell(fp);
+		fclose(fp);
+	}
+	if (count < 0) {
 		return -1;
 	}
-	snprintf(path, sizeof(path), "%s/%s.kml", dataDir, file);
-	count = ConvertToKML(kd, fp, path, 0, 0);
-	fseek(fp, 0, SEEK_END);
-	size = ftell(fp);
-	fclose(fp);
 
 	snprintf(path, sizeof(path), "%s/%s.json", dataDir, file);
 	fp = fopen(path, "w");
@@ -244,23 +268,50 @@ int loadMetaInfo(const char* file, uint32_t* duration, uint32_t* size)
 	return rev;
 }
 
+typedef struct {
+	UrlHandlerParam* param;
+	int len;
+	int64_t offset;
+} DATA_OUTPUT;
+
+static int writeDataSample(void* arg, const TRIP_SAMPLE* sample)
+{
+	DATA_OUTPUT* out = (DATA_OUTPUT*)arg;
+	char* buf = out->param->pucBuffer;
+	int bs = out->param->bufSize - 1;
+	if (bs - out->len < 64) return 1;
+	if (sample->count <= 1) {
+		if (sample->pid >= 0x100)
+			out->len += snprintf(buf + out->len, bs - out->len, "[%lld,%d],", (long long)(out->offset + sample->ts), (int)tripValue(sample, 0));
+		else
+			out->len += snprintf(buf + out->len, bs - out->len, "[%lld,%.2f],", (long long)(out->offset + sample->ts), tripValue(sample, 0));
+	}
+	else {
+		out->len += snprintf(buf + out->len, bs - out->len, "[%lld,[%d,%d,%d]],", (long long)(out->offset + sample->ts),
+			(int)tripValue(sample, 0), (int)tripValue(sample, 1), (int)tripValue(sample, 2));
+	}
+	return 0;
+}
+
 int uhData(UrlHandlerParam* param)
 {
 	const char* devid = mwGetVarValue(param->pxVars, "devid", 0);
 	const char* tripid = mwGetVarValue(param->pxVars, "tripid", 0);
 	int64_t offset = mwGetVarValueInt64(param->pxVars, "offset");
 	int pidreq = mwGetVarValueInt(param->pxVars, "pid", 0);
+	uint32_t begin = (uint32_t)mwGetVarValueInt64(param->pxVars, "begin");
+	uint32_t end = (uint32_t)mwGetVarValueInt64(param->pxVars, "end");
 	param->contentType = HTTPFILETYPE_TEXT;
 
+	if (!devid || !tripid || strlen(tripid) != 15) {
+		param->contentLength = sprintf(param->pucBuffer, "Invalid arguments");
+		return FLAG_DATA_RAW;
+	}
 	int devidlen = strlen(devid);
 	if (devidlen < MIN_DEVID_LEN || devidlen > MAX_DEVID_LEN) {
 		param->contentLength = sprintf(param->pucBuffer, "Invalid device ID");
 		return FLAG_DATA_RAW;
 	}
-	if (!devid || !tripid || strlen(tripid) != 15) {
-		param->contentLength = sprintf(param->pucBuffer, "Invalid arguments");
-		return FLAG_DATA_RAW;
-	}
 
 	char buf[1024];
 	char* p = buf + snprintf(buf, 66, "%s/", devid);
@@ -276,8 +327,27 @@ int uhData(UrlHandlerParam* param)
 	strcpy(p, tripid);
 
 	param->contentType = HTTPFILETYPE_JSON;
-	snprintf(param->pucBuffer, param->bufSize, "%s/%s.txt", dataDir, buf);
-	FILE* fp = fopen(param->pucBuffer, "r");
+	char path[256];
+	int binary = getDataFile(buf, path, sizeof(path));
+	if (binary == 1) {
+		// only the column of the requested PID is read from blocks in range
+		TRIP_READER tr;
+		DATA_OUTPUT out = { param, 1, offset };
+		if (tripOpen(&tr, path) < 0) {
+			param->contentLength = sprintf(param->pucBuffer, "Data file not found");
+			return FLAG_DATA_RAW;
+		}
+		param->pucBuffer[0] = '[';
+		if (pidreq > 0 && pidreq <= 0xffff) {
+			tripRead(&tr, begin, end, (uint16_t)pidreq, writeDataSample, &out);
+		}
+		tripRelease(&tr);
+		if (param->pucBuffer[out.len - 1] == ',') out.len--;
+		out.len += snprintf(param->pucBuffer + out.len, param->bufSize - out.len, "]");
+		param->contentLength = out.len;
+		return FLAG_DATA_RAW;
+	}
+	FILE* fp = binary == 0 ? fopen(path, "r") : 0;
 	if (!fp) {
 		param->contentLength = sprintf(param->pucBuffer, "Data file not found");
 		return FLAG_DATA_RAW;
@@ -286,7 +356,7 @@ int uhData(UrlHandlerParam* param)
 	uint32_t ts = 0;
 	int len = 0;
 	len += snprintf(param->pucBuffer + len, param->bufSize - len, "[");
-	while (fscanf(fp, "%1024s\n", buf) > 0) {
+	while (fscanf(fp, "%1024s\n", buf) > 0 && len < param->bufSize - 64) {
 		for (char* p = strtok(buf, ","); p; p = strtok(0, ",")) {
 			int pid = hex2uint16(p);
 			if (!(p = strchr(p, ':'))) break;
@@ -300,7 +370,7 @@ int uhData(UrlHandlerParam* param)
 				ts = (uint32_t)value[0];
 				continue;
 			}
-			if (pid == pidreq) {
+			if (pid == pidreq && ts >= begin && (!end || ts <= end) && len < param->bufSize - 64) {
 				if (n == 1) {
 					if (pid >= 0x100)
 						len += snprintf(param->pucBuffer + len, param->bufSize - len, "[%lld,%d],", offset + ts, (int)value[0]);
@@ -341,13 +411,11 @@ int processTripData(const char* devid, const char* tripid, int force, char* file
 	uint32_t size = 0, duration = 0;
 	int rev = loadMetaInfo(path, &duration, &size);
 	if (rev == META_REVISION) {
-		snprintf(path, sizeof(path), "%s/%s.txt", dataDir, file);
-		FILE* fp = fopen(path, "r");
-		if (fp) {
-			fseek(fp, 0, SEEK_END);
-			if (ftell(fp) == size) processed = 1;
+		char datapath[256];
+		struct stat st;
+		if (getDataFile(file, datapath, sizeof(datapath)) >= 0 && !stat(datapath, &st) && st.st_size == size) {
+			processed = 1;
 		}
-		fclose(fp);
 		if (psize)* psize = size;
 		if (pduration)* pduration = duration;
 	}
@@ -369,8 +437,87 @@ int processTripData(const char* devid, const char* tripid, int force, char* file
 	return 0;
 }
 
+/* state of a text export of a binary data file, kept in hs->ptr */
+typedef struct {
+	TRIP_READER tr;
+	int block; /* data block being sent, blockCount when done */
+	int sample; /* samples of the block already sent */
+	int skip; /* samples to pass over as the block is read again */
+	int full; /* buffer has no room for the next sample */
+	uint32_t ts; /* timestamp of the line being sent */
+	int lines;
+	char* buf;
+	int len;
+	int size;
+} RAW_STREAM;
+
+static int writeRawSample(void* arg, const TRIP_SAMPLE* sample)
+{
+	RAW_STREAM* rs = (RAW_STREAM*)arg;
+	if (rs->skip) {
+		rs->skip--;
+		return 0;
+	}
+	if (rs->size - rs->len < TRIP_MAX_TEXT_LEN + 32) {
+		rs->full = 1;
+		return 1;
+	}
+	if (!rs->lines || sample->ts != rs->ts) {
+		// one line per timestamp as in text data files
+		rs->len += sprintf(rs->buf + rs->len, "%s0:%u", rs->lines ? "\n" : "", sample->ts);
+		rs->ts = sample->ts;
+		rs->lines++;
+	}
+	rs->len += sprintf(rs->buf + rs->len, ",%X:", sample->pid);
+	rs->len += tripFormatValue(sample, rs->buf + rs->len, rs->size - rs->len);
+	rs->sample++;
+	return 0;
+}
+
+static int streamRaw(UrlHandlerParam* param)
+{
+	RAW_STREAM* rs = (RAW_STREAM*)param->hs->ptr;
+	if (!param->pucBuffer) {
+		// connection done
+		if (rs) {
+			tripRelease(&rs->tr);
+			free(rs);
+		}
+		param->hs->ptr = 0;
+		return 0;
+	}
+	if (!rs || rs->block > rs->tr.blockCount) return 0;
+
+	rs->buf = param->pucBuffer;
+	rs->size = param->bufSize;
+	rs->len = 0;
+	rs->full = 0;
+	while (rs->block < rs->tr.blockCount) {
+		// a block only partly sent is read again from its start
+		rs->skip = rs->sample;
+		if (tripReadBlock(&rs->tr, rs->block, 0, writeRawSample, rs) < 0) {
+			rs->block = rs->tr.blockCount;
+			break;
+		}
+		if (rs->full) break;
+		rs->block++;
+		rs->sample = 0;
+	}
+	if (rs->block == rs->tr.blockCount) {
+		if (rs->lines) rs->buf[rs->len++] = '\n';
+		rs->block++;
+	}
+	param->contentLength = rs->len;
+	return FLAG_DATA_STREAM;
+}
+
 int uhTrip(UrlHandlerParam* param)
 {
+	if (ISFLAGSET(param->hs, FLAG_DATA_STREAM)) {
+		// next piece of text export
+		return streamRaw(param);
+	}
+
 	const char* devid = mwGetVarValue(param->pxVars, "devid", 0);
 	const char* tripid = mwGetVarValue(param->pxVars, "tripid", 0);
 	const char* redir = mwGetVarValue(param->pxVars, "redir", 0);
@@ -398,8 +545,29 @@ int uhTrip(UrlHandlerParam* param)
 		ext = "kml";
 		param->contentType = HTTPFILETYPE_XML;
 	} else if (!strcmp(param->pucRequest, ".raw")) {
+		char path[256];
 		ext = "txt";
 		param->contentType = HTTPFILETYPE_TEXT;
+		if (getDataFile(file, path, sizeof(path)) == 1) {
+			// binary data file is exported as lines of text data files
+			RAW_STREAM* rs = calloc(1, sizeof(RAW_STREAM));
+			if (!rs || tripOpen(&rs->tr, path) < 0) {
+				free(rs);
+				param->contentLength = sprintf(param->pucBuffer, "Data file not found");
+				return FLAG_DATA_RAW;
+			}
+			param->hs->ptr = rs;
+			param->contentLength = 0;
+			return FLAG_DATA_STREAM | FLAG_CHUNK;
+		}
+	} else if (!strcmp(param->pucRequest, ".bin")) {
+		char path[256];
+		if (getDataFile(file, path, sizeof(path)) != 1) {
+			param->contentLength = sprintf(param->pucBuffer, "{\"status\":2,\"error\":\"No binary data\"}");
+			return FLAG_DATA_RAW;
+		}
+		ext = "bin";
+		param->contentType = HTTPFILETYPE_OCTET;
 	}
 	else {
 		param->contentType = HTTPFILETYPE_JSON;
@@ -501,8 +669,16 @@ int uhHistory(UrlHandlerParam* param)
 			do {
 				if (strlen(file) != 19 || file[8] != '-') continue;
 				char *q = strchr(file, '.');
-				if (!q || strcmp(q + 1, "txt")) continue;
+				if (!q) continue;
 				sprintf(p, "/%s", file);
+				if (!strcmp(q + 1, "txt")) {
+					// text data file converted to binary is listed once
+					strcpy(p + (q - file) + 2, "bin");
+					if (IsFileExist(path)) continue;
+				}
+				else if (strcmp(q + 1, "bin")) {
+					continue;
+				}
 				*q = 0;
 				unsigned int time = atoi(file + 9);
 				date = atoi(file);
@@ -0,0 +1,711 @@
+/******************************************************************************
+* Freematics Hub Server - Binary trip data files
+* Developed by Stanley Huang <stanley@freematics.com.au>
+* Distributed under GPL v3.0 license
+* Visit https://freematics.com/hub for more information
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "tripdata.h"
+
+#define MAX_BLOCK_SIZE (64 * 1024 * 1024) /* sanity limit when reading */
+#define MAX_NUMBER_DIGITS 18 /* fits int64_t */
+
+static const int64_t pow10s[TRIP_MAX_DECIMALS + 1] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static int grow(void** p, int* size, int need, int elemSize)
+{
+	if (need <= *size) return 0;
+	int n = *size ? *size : 64;
+	while (n < need) n *= 2;
+	void* q = realloc(*p, (size_t)n * elemSize);
+	if (!q) return -1;
+	*p = q;
+	*size = n;
+	return 0;
+}
+
+static uint8_t* putVarint(uint8_t* p, uint64_t v)
+{
+	while (v >= 0x80) {
+		*(p++) = (uint8_t)v | 0x80;
+		v >>= 7;
+	}
+	*(p++) = (uint8_t)v;
+	return p;
+}
+
+static const uint8_t* getVarint(const uint8_t* p, const uint8_t* end, uint64_t* v)
+{
+	uint64_t n = 0;
+	for (int shift = 0; p < end && shift < 64; shift += 7) {
+		uint8_t c = *(p++);
+		n |= (uint64_t)(c & 0x7f) << shift;
+		if (!(c & 0x80)) {
+			*v = n;
+			return p;
+		}
+	}
+	return 0;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/*
+parses a value like 12 or -33.8688 or 12;-5;980 into integers scaled by 10^decimals,
+returns number of values or -1 if not numeric, decimals and integer digits are the
+maximum of all values
+*/
+static int parseNumbers(const char* s, int len, int64_t* values, int* decimals, int* digits)
+{
+	const char* end = s + len;
+	int decs[TRIP_MAX_VALUES];
+	int count = 0;
+	*decimals = 0;
+	*digits = 0;
+	for (;;) {
+		int64_t m = 0;
+		int neg = 0, n = 0, dec = -1;
+		if (s < end && *s == '-') {
+			neg = 1;
+			s++;
+		}
+		for (; s < end && *s != ';'; s++) {
+			if (*s == '.' && dec < 0) {
+				dec = 0;
+				continue;
+			}
+			if (*s < '0' || *s > '9' || n == MAX_NUMBER_DIGITS) return -1;
+			m = m * 10 + (*s - '0');
+			n++;
+			if (dec >= 0) dec++;
+		}
+		if (n == 0 || dec > TRIP_MAX_DECIMALS || count == TRIP_MAX_VALUES) return -1;
+		if (dec < 0) dec = 0;
+		if (values) values[count] = neg ? -m : m;
+		decs[count++] = dec;
+		if (dec > *decimals) *decimals = dec;
+		if (n - dec > *digits) *digits = n - dec;
+		if (s == end) break;
+		s++;
+	}
+	if (values) {
+		for (int i = 0; i < count; i++) {
+			values[i] *= pow10s[*decimals - decs[i]];
+		}
+	}
+	return count;
+}
+
+/* formats values scaled by 10^decimals as parseNumbers() reads them */
+static int formatNumbers(const int64_t* values, int count, int decimals, char* buf, int size)
+{
+	int len = 0;
+	for (int i = 0; i < count && len < size; i++) {
+		int64_t v = values[i];
+		uint64_t u = v < 0 ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+		int64_t p = pow10s[decimals];
+		if (decimals) {
+			len += snprintf(buf + len, size - len, "%s%s%llu.%0*llu", i ? ";" : "", v < 0 ? "-" : "",
+				(unsigned long long)(u / p), decimals, (unsigned long long)(u % p));
+		}
+		else {
+			len += snprintf(buf + len, size - len, "%s%lld", i ? ";" : "", (long long)v);
+		}
+	}
+	return len < size ? len : size - 1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// writing
+//////////////////////////////////////////////////////////////////////////
+
+TRIP_WRITER* tripCreate(const char* path)
+{
+	TRIP_WRITER* tw = calloc(1, sizeof(TRIP_WRITER));
+	if (!tw) return 0;
+	// the file is examined when the first block is written, as a previous
+	// writer of the same file may still have data to write
+	tw->fp = fopen(path, "a+b");
+	if (!tw->fp) {
+		free(tw);
+		return 0;
+	}
+	return tw;
+}
+
+static int readIndex(FILE* fp, uint32_t size, TRIP_INDEX_ENTRY** pindex, int* pcount);
+
+static int prepareFile(TRIP_WRITER* tw)
+{
+	fseek(tw->fp, 0, SEEK_END);
+	long size = ftell(tw->fp);
+	if (size <= 0) {
+		TRIP_FILE_HEADER fh = { TRIP_FILE_MAGIC, TRIP_FILE_VERSION, 0 };
+		if (fwrite(&fh, sizeof(fh), 1, tw->fp) != 1) return -1;
+		tw->size = sizeof(fh);
+		return 0;
+	}
+	// appending to an existing trip file, its blocks go into the new index
+	if (readIndex(tw->fp, (uint32_t)size, &tw->index, &tw->blockCount) < 0) return -1;
+	tw->indexSize = tw->blockCount;
+	tw->size = (uint32_t)size;
+	return 0;
+}
+
+static uint8_t* reserve(TRIP_WRITER* tw, uint32_t n)
+{
+	int size = (int)tw->bufSize;
+	if (grow((void**)&tw->buf, &size, (int)(tw->bufLen + n), 1)) return 0;
+	tw->bufSize = size;
+	return tw->buf + tw->bufLen;
+}
+
+static int compareKeys(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+	return x < y ? -1 : x > y;
+}
+
+/* encodes samples of one PID (keys[0..n-1]) as a column, returns 0 on success */
+static int encodeColumn(TRIP_WRITER* tw, const uint32_t* keys, int n, TRIP_COLUMN* col, uint32_t firstTs)
+{
+	int decimals = 0, digits = 0;
+	int count = -1;
+	uint8_t* p;
+
+	/*
+	numeric if all values are numbers with the same number of values and decimals,
+	written exactly as they are formatted back (no -0, leading zeros or mixed
+	decimals), otherwise stored as text so that reading gives the original text
+	*/
+	for (int i = 0; i < n; i++) {
+		TRIP_PENDING* s = tw->pending + (keys[i] & 0xffff);
+		int64_t values[TRIP_MAX_VALUES];
+		char buf[TRIP_MAX_VALUES * (MAX_NUMBER_DIGITS + 5)];
+		int dec, dig;
+		int c = parseNumbers(tw->text + s->text, s->len, values, &dec, &dig);
+		if (c < 0 || (count >= 0 && (c != count || dec != decimals))
+			|| formatNumbers(values, c, dec, buf, sizeof(buf)) != s->len || memcmp(buf, tw->text + s->text, s->len)) {
+			count = -1;
+			break;
+		}
+		count = c;
+		decimals = dec;
+		if (dig > digits) digits = dig;
+	}
+	if (digits + decimals > MAX_NUMBER_DIGITS) count = -1;
+
+	memset(col, 0, sizeof(TRIP_COLUMN));
+	col->pid = tw->pending[keys[0] & 0xffff].pid;
+	col->samples = n;
+	uint32_t start = tw->bufLen;
+
+	uint32_t ts = firstTs;
+	for (int i = 0; i < n; i++) {
+		TRIP_PENDING* s = tw->pending + (keys[i] & 0xffff);
+		if (!(p = reserve(tw, 10))) return -1;
+		tw->bufLen = (uint32_t)(putVarint(p, s->ts - ts) - tw->buf);
+		ts = s->ts;
+	}
+
+	if (count > 0) {
+		int64_t last[TRIP_MAX_VALUES] = { 0 };
+		col->type = TRIP_COLUMN_NUMBER;
+		col->count = (uint8_t)count;
+		col->decimals = (uint8_t)decimals;
+		for (int i = 0; i < n; i++) {
+			TRIP_PENDING* s = tw->pending + (keys[i] & 0xffff);
+			int64_t values[TRIP_MAX_VALUES];
+			int dec, dig;
+			parseNumbers(tw->text + s->text, s->len, values, &dec, &dig);
+			if (!(p = reserve(tw, 10 * TRIP_MAX_VALUES))) return -1;
+			for (int j = 0; j < count; j++) {
+				p = putVarint(p, zigzag(values[j] - last[j]));
+				last[j] = values[j];
+			}
+			tw->bufLen = (uint32_t)(p - tw->buf);
+		}
+	}
+	else {
+		col->type = TRIP_COLUMN_TEXT;
+		for (int i = 0; i < n; i++) {
+			TRIP_PENDING* s = tw->pending + (keys[i] & 0xffff);
+			if (!(p = reserve(tw, 10 + s->len))) return -1;
+			p = putVarint(p, s->len);
+			memcpy(p, tw->text + s->text, s->len);
+			tw->bufLen = (uint32_t)(p + s->len - tw->buf);
+		}
+	}
+	col->size = tw->bufLen - start;
+	return 0;
+}
+
+static int encodeBlock(TRIP_WRITER* tw)
+{
+	int n = tw->pendingCount;
+	int colCount = 0;
+	int ret = 0;
+	uint32_t* keys = malloc(n * sizeof(uint32_t));
+	if (!keys) return -1;
+
+	// group samples by PID, keeping their order within a PID
+	for (int i = 0; i < n; i++) {
+		keys[i] = ((uint32_t)tw->pending[i].pid << 16) | i;
+	}
+	qsort(keys, n, sizeof(uint32_t), compareKeys);
+	for (int i = 0; i < n; i++) {
+		if (i == 0 || (keys[i] >> 16) != (keys[i - 1] >> 16)) colCount++;
+	}
+
+	// column directory is filled in as columns are encoded
+	uint32_t dirSize = colCount * sizeof(TRIP_COLUMN);
+	tw->bufLen = 0;
+	if (!reserve(tw, sizeof(TRIP_BLOCK) + dirSize)) {
+		free(keys);
+		return -1;
+	}
+	tw->bufLen = sizeof(TRIP_BLOCK) + dirSize;
+	TRIP_BLOCK block = { TRIP_BLOCK_MAGIC, TRIP_BLOCK_DATA, (uint16_t)colCount, 0,
+		tw->pending[0].ts, tw->pending[n - 1].ts, (uint32_t)n };
+	for (int i = 0, c = 0; i < n && !ret; c++) {
+		TRIP_COLUMN col;
+		int j = i + 1;
+		while (j < n && (keys[j] >> 16) == (keys[i] >> 16)) j++;
+		ret = encodeColumn(tw, keys + i, j - i, &col, block.firstTs);
+		memcpy(tw->buf + sizeof(TRIP_BLOCK) + c * sizeof(TRIP_COLUMN), &col, sizeof(TRIP_COLUMN));
+		i = j;
+	}
+	block.size = tw->bufLen - sizeof(TRIP_BLOCK);
+	memcpy(tw->buf, &block, sizeof(TRIP_BLOCK));
+	free(keys);
+	return ret;
+}
+
+int tripFlush(TRIP_WRITER* tw)
+{
+	int ret = -1;
+	if (!tw->pendingCount) return 0;
+	if ((tw->size || !prepareFile(tw)) && !encodeBlock(tw)
+		&& !grow((void**)&tw->index, &tw->indexSize, tw->blockCount + 1, sizeof(TRIP_INDEX_ENTRY))) {
+		// a block is written as a whole, so readers of a trip in progress see complete blocks
+		if (fwrite(tw->buf, 1, tw->bufLen, tw->fp) == tw->bufLen && !fflush(tw->fp)) {
+			TRIP_INDEX_ENTRY* e = tw->index + tw->blockCount++;
+			e->offset = tw->size;
+			e->firstTs = tw->pending[0].ts;
+			e->lastTs = tw->pending[tw->pendingCount - 1].ts;
+			e->samples = tw->pendingCount;
+			tw->size += tw->bufLen;
+			tw->written++;
+			ret = 0;
+		}
+	}
+	// samples are dropped on failure rather than piling up
+	if (ret) tw->error = 1;
+	tw->pendingCount = 0;
+	tw->textLen = 0;
+	return ret;
+}
+
+/* writes out the pending block once its first sample has been buffered for the given seconds */
+int tripFlushAged(TRIP_WRITER* tw, int seconds)
+{
+	if (!tw->pendingCount || (uint32_t)time(NULL) - tw->pendingSince < (uint32_t)seconds) return 0;
+	return tripFlush(tw);
+}
+
+static int addSample(TRIP_WRITER* tw, uint16_t pid, const char* value, int len)
+{
+	if (tw->pendingCount) {
+		TRIP_PENDING* first = tw->pending;
+		TRIP_PENDING* last = tw->pending + tw->pendingCount - 1;
+		if (tw->pendingCount >= TRIP_BLOCK_SAMPLES || tw->ts < last->ts || tw->ts - first->ts >= TRIP_BLOCK_SPAN) {
+			if (tripFlush(tw)) return -1;
+		}
+	}
+	if (!tw->pendingCount) tw->pendingSince = (uint32_t)time(NULL);
+	int textSize = (int)tw->textSize;
+	if (grow((void**)&tw->pending, &tw->pendingSize, tw->pendingCount + 1, sizeof(TRIP_PENDING))
+		|| grow((void**)&tw->text, &textSize, (int)tw->textLen + len, 1)) {
+		return -1;
+	}
+	tw->textSize = textSize;
+	TRIP_PENDING* s = tw->pending + tw->pendingCount++;
+	s->ts = tw->ts;
+	s->pid = pid;
+	s->len = (uint16_t)len;
+	s->text = tw->textLen;
+	memcpy(tw->text + tw->textLen, value, len);
+	tw->textLen += len;
+	return 0;
+}
+
+int tripParseLine(const char* line, uint32_t* ts, TRIP_LINE_CALLBACK callback, void* arg)
+{
+	/*
+	line format:
+	0:<timestamp>,<pid>:<data>,<pid>:<data>...
+	samples without a timestamp take the last one
+	*/
+	int count = 0;
+	const char* p = line;
+	while (*p) {
+		const char* s = p;
+		const char* end = strchr(p, ',');
+		if (!end) end = p + strlen(p);
+		p = *end ? end + 1 : end;
+
+		uint32_t pid = 0;
+		int n;
+		for (n = 0; n < 4 && s < end; n++, s++) {
+			char c = *s;
+			if (c >= '0' && c <= '9') pid = (pid << 4) | (c - '0');
+			else if (c >= 'A' && c <= 'F') pid = (pid << 4) | (c - 'A' + 10);
+			else if (c >= 'a' && c <= 'f') pid = (pid << 4) | (c - 'a' + 10);
+			else break;
+		}
+		if (n == 0 || s == end || (*s != ':' && *s != '=')) continue;
+		const char* value = s + 1;
+		int len = (int)(end - value);
+		if (pid == 0) {
+			*ts = (uint32_t)strtoul(value, 0, 10);
+			continue;
+		}
+		if (len > TRIP_MAX_TEXT_LEN) len = TRIP_MAX_TEXT_LEN;
+		if (callback(arg, *ts, (uint16_t)pid, value, len)) return -1;
+		count++;
+	}
+	return count;
+}
+
+static int appendSample(void* arg, uint32_t ts, uint16_t pid, const char* value, int len)
+{
+	return addSample((TRIP_WRITER*)arg, pid, value, len);
+}
+
+int tripAppend(TRIP_WRITER* tw, const char* line)
+{
+	return tripParseLine(line, &tw->ts, appendSample, tw);
+}
+
+/* returns 0 when every sample appended since tripCreate is in the file and the index has been written */
+int tripClose(TRIP_WRITER* tw)
+{
+	if (!tw) return 0;
+	int ret = tripFlush(tw);
+	if (tw->written) {
+		// index of all data blocks, found through the trailer at the end of file
+		TRIP_BLOCK block = { TRIP_BLOCK_MAGIC, TRIP_BLOCK_INDEX, 0,
+			tw->blockCount * sizeof(TRIP_INDEX_ENTRY) + sizeof(TRIP_INDEX_TRAILER), 0, 0, 0 };
+		TRIP_INDEX_TRAILER trailer = { tw->size, TRIP_INDEX_MAGIC };
+		for (int i = 0; i < tw->blockCount; i++) {
+			TRIP_INDEX_ENTRY* e = tw->index + i;
+			if (i == 0 || e->firstTs < block.firstTs) block.firstTs = e->firstTs;
+			if (e->lastTs > block.lastTs) block.lastTs = e->lastTs;
+			block.samples += e->samples;
+		}
+		if (fwrite(&block, sizeof(block), 1, tw->fp) != 1
+			|| fwrite(tw->index, sizeof(TRIP_INDEX_ENTRY), tw->blockCount, tw->fp) != (size_t)tw->blockCount
+			|| fwrite(&trailer, sizeof(trailer), 1, tw->fp) != 1) {
+			ret = -1;
+		}
+	}
+	if (fclose(tw->fp)) ret = -1;
+	if (tw->error) ret = -1;
+	free(tw->pending);
+	free(tw->text);
+	free(tw->index);
+	free(tw->buf);
+	free(tw);
+	return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// reading
+//////////////////////////////////////////////////////////////////////////
+
+static int readIndex(FILE* fp, uint32_t size, TRIP_INDEX_ENTRY** pindex, int* pcount)
+{
+	TRIP_FILE_HEADER fh;
+	TRIP_INDEX_TRAILER trailer;
+	TRIP_BLOCK block;
+	TRIP_INDEX_ENTRY* index = 0;
+	int count = 0;
+	int indexSize = 0;
+
+	if (size < sizeof(fh) || fseek(fp, 0, SEEK_SET) || fread(&fh, sizeof(fh), 1, fp) != 1
+		|| fh.magic != TRIP_FILE_MAGIC || fh.version != TRIP_FILE_VERSION) {
+		return -1;
+	}
+
+	// index block written when the trip file was closed
+	if (size >= sizeof(fh) + sizeof(block) + sizeof(trailer)
+		&& !fseek(fp, size - sizeof(trailer), SEEK_SET) && fread(&trailer, sizeof(trailer), 1, fp) == 1
+		&& trailer.magic == TRIP_INDEX_MAGIC && trailer.offset >= sizeof(fh)
+		&& trailer.offset <= size - sizeof(block) - sizeof(trailer)
+		&& !fseek(fp, trailer.offset, SEEK_SET) && fread(&block, sizeof(block), 1, fp) == 1
+		&& block.magic == TRIP_BLOCK_MAGIC && block.type == TRIP_BLOCK_INDEX
+		&& block.size == size - trailer.offset - sizeof(block)
+		&& (block.size - sizeof(trailer)) % sizeof(TRIP_INDEX_ENTRY) == 0) {
+		count = (int)((block.size - sizeof(trailer)) / sizeof(TRIP_INDEX_ENTRY));
+		index = malloc(count * sizeof(TRIP_INDEX_ENTRY) + 1);
+		if (index && (int)fread(index, sizeof(TRIP_INDEX_ENTRY), count, fp) == count) {
+			*pindex = index;
+			*pcount = count;
+			return count;
+		}
+		free(index);
+		index = 0;
+		count = 0;
+	}
+
+	// no index, walk through block headers
+	uint32_t offset = sizeof(fh);
+	while (size >= sizeof(block) && offset <= size - sizeof(block)) {
+		if (fseek(fp, offset, SEEK_SET) || fread(&block, sizeof(block), 1, fp) != 1
+			|| block.magic != TRIP_BLOCK_MAGIC || block.size > size - offset - sizeof(block)) {
+			// incomplete block being written
+			break;
+		}
+		if (block.type == TRIP_BLOCK_DATA) {
+			if (grow((void**)&index, &indexSize, count + 1, sizeof(TRIP_INDEX_ENTRY))) {
+				free(index);
+				return -1;
+			}
+			TRIP_INDEX_ENTRY* e = index + count++;
+			e->offset = offset;
+			e->firstTs = block.firstTs;
+			e->lastTs = block.lastTs;
+			e->samples = block.samples;
+		}
+		offset += sizeof(block) + block.size;
+	}
+	*pindex = index;
+	*pcount = count;
+	return count;
+}
+
+int tripOpen(TRIP_READER* tr, const char* path)
+{
+	memset(tr, 0, sizeof(TRIP_READER));
+	tr->fp = fopen(path, "rb");
+	if (!tr->fp) return -1;
+	fseek(tr->fp, 0, SEEK_END);
+	long size = ftell(tr->fp);
+	if (size <= 0 || readIndex(tr->fp, (uint32_t)size, &tr->index, &tr->blockCount) < 0) {
+		fclose(tr->fp);
+		tr->fp = 0;
+		return -1;
+	}
+	return tr->blockCount;
+}
+
+void tripRelease(TRIP_READER* tr)
+{
+	if (tr->fp) fclose(tr->fp);
+	free(tr->index);
+	free(tr->buf);
+	free(tr->samples);
+	memset(tr, 0, sizeof(TRIP_READER));
+}
+
+static int decodeColumn(const TRIP_COLUMN* col, const uint8_t* p, uint32_t firstTs, TRIP_SAMPLE* out)
+{
+	const uint8_t* end = p + col->size;
+	int64_t last[TRIP_MAX_VALUES] = { 0 };
+	uint32_t ts = firstTs;
+	uint64_t v;
+
+	if (col->type == TRIP_COLUMN_NUMBER && (col->count == 0 || col->count > TRIP_MAX_VALUES || col->decimals > TRIP_MAX_DECIMALS)) {
+		return -1;
+	}
+	for (uint32_t i = 0; i < col->samples; i++) {
+		if (!(p = getVarint(p, end, &v))) return -1;
+		ts += (uint32_t)v;
+		out[i].ts = ts;
+		out[i].pid = col->pid;
+	}
+	for (uint32_t i = 0; i < col->samples; i++) {
+		TRIP_SAMPLE* s = out + i;
+		if (col->type == TRIP_COLUMN_NUMBER) {
+			s->count = col->count;
+			s->decimals = col->decimals;
+			for (int j = 0; j < col->count; j++) {
+				if (!(p = getVarint(p, end, &v))) return -1;
+				last[j] += unzigzag(v);
+				s->values[j] = last[j];
+			}
+			s->text = 0;
+			s->len = 0;
+		}
+		else {
+			if (!(p = getVarint(p, end, &v)) || v > (uint64_t)(end - p)) return -1;
+			s->count = 0;
+			s->decimals = 0;
+			s->text = (const char*)p;
+			s->len = (int)v;
+			p += v;
+		}
+	}
+	return (int)col->samples;
+}
+
+/* reads a data block into tr->samples in time order, all PIDs or only pid, returns sample count */
+static int readBlock(TRIP_READER* tr, const TRIP_INDEX_ENTRY* e, uint16_t pid)
+{
+	TRIP_BLOCK block;
+	if (fseek(tr->fp, e->offset, SEEK_SET) || fread(&block, sizeof(block), 1, tr->fp) != 1
+		|| block.magic != TRIP_BLOCK_MAGIC || block.type != TRIP_BLOCK_DATA || block.size > MAX_BLOCK_SIZE
+		|| block.columns * sizeof(TRIP_COLUMN) > block.size) {
+		return -1;
+	}
+	int bufSize = (int)tr->bufSize;
+	int sampleSize = (int)tr->sampleSize;
+	// decoded columns go to the second half of samples before merged into the first
+	if (grow((void**)&tr->buf, &bufSize, block.size, 1)
+		|| grow((void**)&tr->samples, &sampleSize, block.samples * 2, sizeof(TRIP_SAMPLE))) {
+		return -1;
+	}
+	tr->bufSize = bufSize;
+	tr->sampleSize = sampleSize;
+
+	uint32_t dirSize = block.columns * sizeof(TRIP_COLUMN);
+	if (fread(tr->buf, 1, dirSize, tr->fp) != dirSize) return -1;
+	TRIP_COLUMN* cols = (TRIP_COLUMN*)tr->buf;
+	uint8_t* data = tr->buf + dirSize;
+	uint32_t dataSize = block.size - dirSize;
+	uint32_t total = 0, offset = 0;
+	for (int i = 0; i < block.columns; i++) {
+		total += cols[i].samples;
+		offset += cols[i].size;
+	}
+	if (total != block.samples || offset != dataSize) return -1;
+
+	if (pid) {
+		// seek to the only column wanted
+		offset = 0;
+		for (int i = 0; i < block.columns; i++) {
+			if (cols[i].pid == pid) {
+				if (fseek(tr->fp, offset, SEEK_CUR) || fread(data, 1, cols[i].size, tr->fp) != cols[i].size) return -1;
+				return decodeColumn(cols + i, data, block.firstTs, tr->samples);
+			}
+			offset += cols[i].size;
+		}
+		return 0;
+	}
+
+	if (fread(data, 1, dataSize, tr->fp) != dataSize) return -1;
+	TRIP_SAMPLE* decoded = tr->samples + block.samples;
+	uint32_t pos[64];
+	uint32_t* cursors = block.columns <= 32 ? pos : malloc(block.columns * 2 * sizeof(uint32_t));
+	if (!cursors) return -1;
+	uint32_t* ends = cursors + block.columns;
+	int ret = (int)block.samples;
+	total = 0;
+	offset = 0;
+	for (int i = 0; i < block.columns; i++) {
+		if (decodeColumn(cols + i, data + offset, block.firstTs, decoded + total) < 0) {
+			ret = -1;
+			break;
+		}
+		cursors[i] = total;
+		total += cols[i].samples;
+		ends[i] = total;
+		offset += cols[i].size;
+	}
+	// merge columns by timestamp
+	for (uint32_t n = 0; ret > 0 && n < block.samples; n++) {
+		int c = -1;
+		for (int i = 0; i < block.columns; i++) {
+			if (cursors[i] < ends[i] && (c < 0 || decoded[cursors[i]].ts < decoded[cursors[c]].ts)) c = i;
+		}
+		tr->samples[n] = decoded[cursors[c]++];
+	}
+	if (cursors != pos) free(cursors);
+	return ret;
+}
+
+int tripRead(TRIP_READER* tr, uint32_t begin, uint32_t end, uint16_t pid, TRIP_SAMPLE_CALLBACK callback, void* arg)
+{
+	int count = 0;
+	for (int i = 0; i < tr->blockCount; i++) {
+		const TRIP_INDEX_ENTRY* e = tr->index + i;
+		// the index tells which blocks have data in range
+		if (e->lastTs < begin || (end && e->firstTs > end)) continue;
+		int n = readBlock(tr, e, pid);
+		if (n < 0) return count ? count : -1;
+		for (int j = 0; j < n; j++) {
+			const TRIP_SAMPLE* s = tr->samples + j;
+			if (s->ts < begin) continue;
+			if (end && s->ts > end) break;
+			count++;
+			if (callback(arg, s)) return count;
+		}
+	}
+	return count;
+}
+
+/* reads one data block (0 to blockCount - 1) in time order, returns samples passed to the callback or -1 */
+int tripReadBlock(TRIP_READER* tr, int block, uint16_t pid, TRIP_SAMPLE_CALLBACK callback, void* arg)
+{
+	if (block < 0 || block >= tr->blockCount) return -1;
+	int n = readBlock(tr, tr->index + block, pid);
+	for (int j = 0; j < n; j++) {
+		if (callback(arg, tr->samples + j)) return j + 1;
+	}
+	return n;
+}
+
+float tripValue(const TRIP_SAMPLE* sample, int n)
+{
+	if (sample->count == 0) {
+		char buf[32];
+		int len = sample->len < (int)sizeof(buf) - 1 ? sample->len : (int)sizeof(buf) - 1;
+		memcpy(buf, sample->text, len);
+		buf[len] = 0;
+		// as atof() on text data files, values separated by ';'
+		char* p = buf;
+		for (int i = 0; i < n && p; i++) {
+			if ((p = strchr(p, ';'))) p++;
+		}
+		return p ? (float)atof(p) : 0;
+	}
+	if (n >= sample->count) return 0;
+	return (float)((double)sample->values[n] / pow10s[sample->decimals]);
+}
+
+int tripFormatValue(const TRIP_SAMPLE* sample, char* buf, int size)
+{
+	int len = 0;
+	if (size <= 0) return 0;
+	if (sample->count == 0) {
+		len = sample->len < size - 1 ? sample->len : size - 1;
+		memcpy(buf, sample->text, len);
+		buf[len] = 0;
+		return len;
+	}
+	return formatNumbers(sample->values, sample->count, sample->decimals, buf, size);
+}
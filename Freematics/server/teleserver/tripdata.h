@@ -0,0 +1,171 @@
+/******************************************************************************
+* Freematics Hub Server - Binary trip data files
+* Developed by Stanley Huang <stanley@freematics.com.au>
+* Distributed under GPL v3.0 license
+* Visit https://freematics.com/hub for more information
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+/*
+Trip data file layout (little endian, append only)
+
+TRIP_FILE_HEADER
+block 1, block 2, ... each a TRIP_BLOCK followed by size bytes:
+  data block: columns x TRIP_COLUMN, then the data of each column in that order
+    timestamps: varint delta to the previous one (the first to the block's firstTs)
+    numeric values: zigzag varint delta per value to the previous sample, scaled
+      to integers by 10^decimals
+    text values: varint length and bytes
+  index block: blocks x TRIP_INDEX_ENTRY of every data block in the file so far,
+    ended by a TRIP_INDEX_TRAILER, written when a trip file is closed
+
+Timestamps never go backwards within a data block. Readers find the index
+through the trailer at the end of the file and fall back to walking block
+headers when there is none (trip being written or not closed properly).
+*/
+
+#ifndef _TRIPDATA_H_
+#define _TRIPDATA_H_
+
+#define TRIP_FILE_MAGIC 0x50525446 /* FTRP */
+#define TRIP_BLOCK_MAGIC 0x4B4C4254 /* TBLK */
+#define TRIP_INDEX_MAGIC 0x58444954 /* TIDX */
+#define TRIP_FILE_VERSION 1
+
+#define TRIP_BLOCK_DATA 1
+#define TRIP_BLOCK_INDEX 2
+
+#define TRIP_COLUMN_NUMBER 1
+#define TRIP_COLUMN_TEXT 2
+
+#define TRIP_BLOCK_SAMPLES 1024 /* samples per data block */
+#define TRIP_BLOCK_SPAN 60000 /* ms of data per data block */
+#define TRIP_MAX_VALUES 3 /* values per sample (e.g. x;y;z) in a numeric column */
+#define TRIP_MAX_DECIMALS 9
+#define TRIP_MAX_TEXT_LEN 1024
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+} TRIP_FILE_HEADER;
+
+typedef struct {
+	uint32_t magic;
+	uint16_t type;
+	uint16_t columns;
+	uint32_t size; /* bytes following the block header */
+	uint32_t firstTs;
+	uint32_t lastTs;
+	uint32_t samples;
+} TRIP_BLOCK;
+
+typedef struct {
+	uint16_t pid;
+	uint8_t type;
+	uint8_t count; /* values per sample */
+	uint8_t decimals;
+	uint8_t reserved[3];
+	uint32_t samples;
+	uint32_t size; /* bytes of column data */
+} TRIP_COLUMN;
+
+typedef struct {
+	uint32_t offset; /* file offset of the data block */
+	uint32_t firstTs;
+	uint32_t lastTs;
+	uint32_t samples;
+} TRIP_INDEX_ENTRY;
+
+typedef struct {
+	uint32_t offset; /* file offset of the index block */
+	uint32_t magic;
+} TRIP_INDEX_TRAILER;
+
+/* sample buffered for the current data block, value is in the text pool */
+typedef struct {
+	uint32_t ts;
+	uint16_t pid;
+	uint16_t len;
+	uint32_t text;
+} TRIP_PENDING;
+
+typedef struct _TRIP_WRITER {
+	FILE* fp;
+	uint32_t size; /* file size, 0 until the file has been examined */
+	uint32_t ts; /* last timestamp seen */
+	int written; /* data blocks written since opened */
+	int error; /* a block could not be written, its samples were dropped */
+	TRIP_PENDING* pending;
+	int pendingCount;
+	int pendingSize;
+	uint32_t pendingSince; /* time() when the first pending sample was buffered */
+	char* text;
+	uint32_t textLen;
+	uint32_t textSize;
+	TRIP_INDEX_ENTRY* index;
+	int blockCount;
+	int indexSize;
+	uint8_t* buf;
+	uint32_t bufLen;
+	uint32_t bufSize;
+} TRIP_WRITER;
+
+/* decoded sample, text values are only valid in the callback */
+typedef struct {
+	uint32_t ts;
+	uint16_t pid;
+	uint8_t count; /* values, 0 for a text value */
+	uint8_t decimals;
+	int64_t values[TRIP_MAX_VALUES];
+	const char* text;
+	int len;
+} TRIP_SAMPLE;
+
+typedef struct {
+	FILE* fp;
+	TRIP_INDEX_ENTRY* index;
+	int blockCount;
+	uint8_t* buf;
+	uint32_t bufSize;
+	TRIP_SAMPLE* samples;
+	uint32_t sampleSize;
+} TRIP_READER;
+
+/* returns non-zero to stop reading */
+typedef int (*TRIP_SAMPLE_CALLBACK)(void* arg, const TRIP_SAMPLE* sample);
+
+/* sample of a text data line, returns non-zero to stop parsing */
+typedef int (*TRIP_LINE_CALLBACK)(void* arg, uint32_t ts, uint16_t pid, const char* value, int len);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+TRIP_WRITER* tripCreate(const char* path);
+int tripParseLine(const char* line, uint32_t* ts, TRIP_LINE_CALLBACK callback, void* arg);
+int tripAppend(TRIP_WRITER* tw, const char* line);
+int tripFlush(TRIP_WRITER* tw);
+int tripFlushAged(TRIP_WRITER* tw, int seconds);
+int tripClose(TRIP_WRITER* tw);
+
+int tripOpen(TRIP_READER* tr, const char* path);
+int tripRead(TRIP_READER* tr, uint32_t begin, uint32_t end, uint16_t pid, TRIP_SAMPLE_CALLBACK callback, void* arg);
+int tripReadBlock(TRIP_READER* tr, int block, uint16_t pid, TRIP_SAMPLE_CALLBACK callback, void* arg);
+void tripRelease(TRIP_READER* tr);
+
+float tripValue(const TRIP_SAMPLE* sample, int n);
+int tripFormatValue(const TRIP_SAMPLE* sample, char* buf, int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,14 +23,10 @@
 #include "teleserver.h"
 
 CHANNEL_DATA* assignChannel(const char* id);
-FILE* createDataFile(CHANNEL_DATA* pld);
+struct _TRIP_WRITER* createDataFile(CHANNEL_DATA* pld);
 
 extern char serverKey[];
 
-//////////////////////////////////////////////////////////////////////////
-// callback from the web server whenever it recevies UDP data
-//////////////////////////////////////////////////////////////////////////
-
 int verifyChecksum(char* data)
 {
 	uint8_t sum = 0;
@@ -55,171 +51,188 @@ int addChecksump(char* data)
 	return (int)(s - data);
 }
 
-int incomingUDPCallback(void* _hp)
-{
-	HttpParam* hp = (HttpParam*)_hp;
-	struct sockaddr_in cliaddr;
-	socklen_t socklen = sizeof(cliaddr);
-	char buf[4096];
-	int recv;
-	char* hostaddr;
-
-	if ((recv = recvfrom(hp->udpSocket, buf, sizeof(buf) - 1, 0, (struct sockaddr *)&cliaddr, &socklen)) <= 0)
-		return -1;
-
+//////////////////////////////////////////////////////////////////////////
+// splits up a UDP datagram (null-terminated, modified while parsed)
+// only touches the packet, so ingest workers can run it in parallel
+// returns 0 on success, -1 on checksum mismatch, -2 on invalid header
+//////////////////////////////////////////////////////////////////////////
 
+int parseDatagram(char* buf, int len, UDP_PACKET* pkt, PAYLOAD_SAMPLE* samples, int maxSamples)
+{
 	/*
 	Data format:
 	<ID>#<timestamp>:<pid>=<data>[$<checksum>]
 	*/
 
-	buf[recv] = 0;
-	hostaddr = inet_ntoa(cliaddr.sin_addr);
-	fprintf(stderr, "%u bytes from %s | ", recv, hostaddr);
+	memset(pkt, 0, sizeof(UDP_PACKET));
+	pkt->header = buf;
+	pkt->len = len;
+	pkt->samples = samples;
+	pkt->sampleCount = -1;
 
 	// validate checksum
 	if (!verifyChecksum(buf)) {
-		fprintf(stderr, "UDP data checksum mismatch\n%s\n", buf);
 		return -1;
 	}
 
-	CHANNEL_DATA* pld = 0;
-	char *msg = 0;
-	char *data;
-	char* devid = 0;
-
 	// validate header
-	data = strchr(buf, '#');
+	char *data = strchr(buf, '#');
 	if (!data) {
 		// invalid header
-		fprintf(stderr, "Invalid data received - %s\n", buf);
-		return -1;
+		return -2;
 	}
 
-	// parse feed ID or device ID
+	// feed ID or device ID
 	*data = 0;
 	if ((int)(data - buf) > 4) {
-		devid = buf;
-		pld = findChannelByDeviceID(buf);
-		if (pld) {
-			devid = buf;
-		}
-	}
-	else {
-		int id = hex2uint16(buf);
-		if (id) pld = findChannelByID(id);
+		pkt->devid = buf;
 	}
 	data++; // now points to the start of data chunks
-
-	uint64_t serverTick = GetTickCount64();
-	uint32_t deviceTick = 0;
-	uint32_t token = 0;
-	uint16_t eventID = 0;
-	uint16_t devflags = 0;
-	int rssi = 0;
+	pkt->data = data;
 
 	if (strstr(data, "EV=")) {
-		char* vin = 0;
-		char* key = 0;
-		char *s = strtok(data, ",");
+		char *save = 0;
+		char *s = strtok_r(data, ",", &save);
 		do {
 			if (!strncmp(s, "EV=", 3)) {
-				eventID = atoi(s + 3);
+				pkt->eventID = atoi(s + 3);
 			}
 			else if (!strncmp(s, "TS=", 3)) {
-				deviceTick = atol(s + 3);
+				pkt->deviceTick = atol(s + 3);
 			}
 			else if (!strncmp(s, "TK=", 3)) {
-				token = atol(s + 3);
+				pkt->token = atol(s + 3);
 			}
 			else if (!strncmp(s, "MSG=", 4)) {
-				msg = s + 4;
+				pkt->msg = s + 4;
 			}
 			else if (!strncmp(s, "ID=", 3)) {
-				devid = s + 3;
+				pkt->devid = s + 3;
 			}
 			else if (!strncmp(s, "VIN=", 4)) {
-				vin = s + 4;
+				pkt->vin = s + 4;
 			}
 			else if (!strncmp(s, "DF=", 3)) {
-				devflags = atoi(s + 3);
+				pkt->devflags = atoi(s + 3);
 			}
 			else if (!strncmp(s, "SSI=", 4)) {
-				rssi = atoi(s + 4);
+				pkt->rssi = atoi(s + 4);
 			}
 			else if (!strncmp(s, "SK=", 3)) {
-				key = s + 3;
+				pkt->key = s + 3;
 			}
-		} while ((s = strtok(0, ",")));
+		} while ((s = strtok_r(0, ",", &save)));
+	}
+	else if (samples) {
+		pkt->sampleCount = parsePayload(data, samples, maxSamples, &pkt->ts);
+	}
+	return 0;
+}
 
-		//fprintf(stderr, "Channel ID:%u Event ID:%u\n", id, eventID);
-		if (eventID == EVENT_LOGIN) {
-			if (!devid) devid = vin;
-			pld = assignChannel(devid);
-			if (!pld) {
-				fprintf(getLogFile(), "No more channel");
-				return 0;
-			}
+//////////////////////////////////////////////////////////////////////////
+// processes a parsed UDP datagram against its channel
+// the response is written to reply and its length returned (0 for no response)
+//////////////////////////////////////////////////////////////////////////
 
-			if (vin && checkVIN(vin)) {
-				strcpy(pld->vin, vin);
-			}
-			pld->rssi = rssi;
-			pld->devflags = devflags;
-			// TODO: also check timed out device
-			if (*serverKey) {
-				// match server key
-				if (key && !strcmp(serverKey, key)) {
-					memcpy(&pld->udpPeer, &cliaddr, sizeof(cliaddr));
-				}
-				else {
-					return -2;
-				}
-			}
-			else {
-				// always accept
-				memcpy(&pld->udpPeer, &cliaddr, sizeof(cliaddr));
-			}
-			if (!(pld->flags & FLAG_RUNNING) || serverTick - pld->serverDataTick > SESSION_GAP) {
-				deviceLogin(pld);
-				pld->serverDataTick = serverTick;
-				pld->sessionStartTick = serverTick;
+int applyDatagram(UDP_PACKET* pkt, int result, struct sockaddr_in* peer, char* reply, int replySize)
+{
+	char* hostaddr = inet_ntoa(peer->sin_addr);
+	fprintf(stderr, "%u bytes from %s | ", pkt->len, hostaddr);
+
+	if (result == -1) {
+		fprintf(stderr, "UDP data checksum mismatch\n%s\n", pkt->header);
+		return -1;
+	}
+	else if (result) {
+		fprintf(stderr, "Invalid data received - %s\n", pkt->header);
+		return -1;
+	}
+
+	CHANNEL_DATA* pld = 0;
+	uint64_t serverTick = GetTickCount64();
+	uint16_t eventID = pkt->eventID;
+	char *msg = pkt->msg;
+	char *data = pkt->data;
+	char *devid = pkt->devid;
+
+	if ((int)strlen(pkt->header) > 4) {
+		pld = findChannelByDeviceID(pkt->header);
+	}
+	else {
+		int id = hex2uint16(pkt->header);
+		if (id) pld = findChannelByID(id);
+	}
+
+	//fprintf(stderr, "Channel ID:%u Event ID:%u\n", id, eventID);
+	if (eventID == EVENT_LOGIN) {
+		char* vin = pkt->vin;
+		if (!devid) devid = vin;
+		pld = assignChannel(devid);
+		if (!pld) {
+			fprintf(getLogFile(), "No more channel");
+			return 0;
+		}
+
+		if (vin && checkVIN(vin)) {
+			strcpy(pld->vin, vin);
+		}
+		pld->rssi = pkt->rssi;
+		pld->devflags = pkt->devflags;
+		// TODO: also check timed out device
+		if (*serverKey) {
+			// match server key
+			if (pkt->key && !strcmp(serverKey, pkt->key)) {
+				memcpy(&pld->udpPeer, peer, sizeof(struct sockaddr_in));
 			}
 			else {
-				printf("DEVICE RE-LOGIN, ID:%s\n", pld->devid);
+				return -2;
 			}
-			pld->deviceTick = deviceTick;
-			// clear cache
-			pld->cacheReadPos = 0;
-			pld->cacheWritePos = 0;
-			// clear instance data cache
-			memset(pld->data, 0, sizeof(pld->data));
 		}
+		else {
+			// always accept
+			memcpy(&pld->udpPeer, peer, sizeof(struct sockaddr_in));
+		}
+		if (!(pld->flags & FLAG_RUNNING) || serverTick - pld->serverDataTick > SESSION_GAP) {
+			deviceLogin(pld);
+			pld->serverDataTick = serverTick;
+			pld->sessionStartTick = serverTick;
+		}
+		else {
+			printf("DEVICE RE-LOGIN, ID:%s\n", pld->devid);
+		}
+		pld->deviceTick = pkt->deviceTick;
+		// clear cache
+		pld->cacheReadPos = 0;
+		pld->cacheWritePos = 0;
+		// clear instance data cache
+		memset(pld->data, 0, sizeof(pld->data));
 	}
 	if (!pld) {
-		fprintf(stderr, "INVALID CHANNEL - %s\n", buf);
+		fprintf(stderr, "INVALID CHANNEL - %s\n", pkt->header);
 		return -1;
 	}
 
-	pld->dataReceived += recv;
+	pld->dataReceived += pkt->len;
 
 	// check if authorized peer
 #if 0
-	if (memcmp(&cliaddr, &pld->udpPeer, sizeof(cliaddr))) {
+	if (memcmp(peer, &pld->udpPeer, sizeof(struct sockaddr_in))) {
 		// unauthorized
 		fprintf(stderr, "Unauthorized peer\n");
 		return -1;
 	}
 #endif
 
-	if (eventID == 0 || eventID == EVENT_PING) {
+	if (eventID == 0 && pkt->sampleCount >= 0) {
+		applyPayload(data, pkt->samples, pkt->sampleCount, pkt->ts, pld, eventID);
+	} else if (eventID == 0 || eventID == EVENT_PING) {
 		processPayload(data, pld, eventID);
 	} else if (eventID == EVENT_ACK) {
 		// pending command executed
 		if (msg) {
 			for (int i = 0; i < MAX_PENDING_COMMANDS; i++) {
 				COMMAND_BLOCK *cmd = pld->cmd + i;
-				if (cmd->token && cmd->token == token) {
+				if (cmd->token && cmd->token == pkt->token) {
 					cmd->flags |= CMD_FLAG_RESPONDED;
 					cmd->elapsed = (uint16_t)(pld->serverDataTick - cmd->tick);
 					// store received message
@@ -255,7 +268,7 @@ int incomingUDPCallback(void* _hp)
 		}
 	}
 	// generate response
-	int len = sprintf(buf, "%X#EV=%u,RX=%u,TX=%u", pld->id, eventID, pld->recvCount, ++pld->txCount);
+	snprintf(reply, replySize - 4, "%X#EV=%u,RX=%u,TX=%u", pld->id, eventID, pld->recvCount, ++pld->txCount);
 	switch (eventID) {
 	case EVENT_LOGOUT:
 		deviceLogout(pld);
@@ -270,14 +283,23 @@ int incomingUDPCallback(void* _hp)
 		fprintf(stderr, "DEVICE RECONNECTED, ID:%s\n", pld->devid);
 		break;
 	}
-	// send UDP response
-	len = addChecksump(buf);
-	if (sendto(hp->udpSocket, buf, len, 0, (struct sockaddr *)&cliaddr, socklen) == len)
-		fprintf(stderr, "Reply sent:%s\n", buf);
-	else
-		fprintf(stderr, "Reply unsent\n");
+	// UDP response, sent by the caller
+	int len = addChecksump(reply);
+	fprintf(stderr, "Reply:%s\n", reply);
+	return len;
+}
 
-	return 0;
+//////////////////////////////////////////////////////////////////////////
+// callback from the web server for each received UDP datagram when the
+// ingest pipeline is not running
+//////////////////////////////////////////////////////////////////////////
+
+int incomingUDPDatagram(void* _hp, char* buf, int recv, struct sockaddr_in* peer, char* reply, int replySize)
+{
+	UDP_PACKET pkt;
+	PAYLOAD_SAMPLE samples[MAX_PAYLOAD_SAMPLES(UDP_DATAGRAM_SIZE)];
+	int result = parseDatagram(buf, recv, &pkt, samples, MAX_PAYLOAD_SAMPLES(UDP_DATAGRAM_SIZE));
+	return applyDatagram(&pkt, result, peer, reply, replySize);
 }
 
 uint32_t issueCommand(HttpParam* hp, CHANNEL_DATA *pld, const char* cmd, uint32_t token)
@@ -0,0 +1,78 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Contador global de alocações para os benchmarks: substitui operator new/delete
+// (simples, de vetor, nothrow, com tamanho e alinhadas) por versões sobre
+// malloc/free que incrementam g_allocs a cada alocação.
+// Definições não inline: incluir em um único .cpp por programa.
+//
+// new e delete ficam fora de linha (noinline): se o GCC os expandisse no ponto de
+// chamada, veria malloc() casado com operator delete (ou operator new com free())
+// e acusaria -Wmismatched-new-delete, embora o par seja o mesmo.
+
+#if defined(__GNUC__)
+#define ALLOC_COUNTER_NOINLINE __attribute__((noinline))
+#else
+#define ALLOC_COUNTER_NOINLINE
+#endif
+
+static size_t g_allocs = 0;
+
+static void* counted_alloc(std::size_t size) {
+    ++g_allocs;
+    return std::malloc(size ? size : 1);
+}
+
+static void* counted_alloc_aligned(std::size_t size, std::align_val_t al) {
+    ++g_allocs;
+    std::size_t align = static_cast<std::size_t>(al);
+    if (align < sizeof(void*)) align = sizeof(void*);
+    // aligned_alloc exige tamanho múltiplo do alinhamento
+    std::size_t rounded = (size + align - 1) / align * align;
+    return std::aligned_alloc(align, rounded ? rounded : align);
+}
+
+ALLOC_COUNTER_NOINLINE void* operator new(std::size_t size) {
+    if (void* p = counted_alloc(size)) return p;
+    throw std::bad_alloc();
+}
+ALLOC_COUNTER_NOINLINE void* operator new[](std::size_t size) {
+    if (void* p = counted_alloc(size)) return p;
+    throw std::bad_alloc();
+}
+ALLOC_COUNTER_NOINLINE void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+ALLOC_COUNTER_NOINLINE void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+
+ALLOC_COUNTER_NOINLINE void* operator new(std::size_t size, std::align_val_t al) {
+    if (void* p = counted_alloc_aligned(size, al)) return p;
+    throw std::bad_alloc();
+}
+ALLOC_COUNTER_NOINLINE void* operator new[](std::size_t size, std::align_val_t al) {
+    if (void* p = counted_alloc_aligned(size, al)) return p;
+    throw std::bad_alloc();
+}
+ALLOC_COUNTER_NOINLINE void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return counted_alloc_aligned(size, al);
+}
+ALLOC_COUNTER_NOINLINE void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return counted_alloc_aligned(size, al);
+}
+
+ALLOC_COUNTER_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+ALLOC_COUNTER_NOINLINE void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+#endif // ALLOC_COUNTER_H
@@ -0,0 +1,192 @@
+#ifndef ANOMALY_INJECTOR_H
+#define ANOMALY_INJECTOR_H
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Gerador determinístico (splitmix64): mesma sequência em qualquer plataforma, ao
+// contrário das distribuições da biblioteca padrão
+class SplitMix64 {
+public:
+    explicit SplitMix64(uint64_t seed = 1) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniforme em [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    uint64_t state_;
+};
+
+// Tipos de anomalia; o valor é o rótulo gravado (0 = normal)
+enum AnomalyType : uint8_t { ANOMALY_NONE = 0, ANOMALY_SPIKE = 1, ANOMALY_DRIFT = 2, ANOMALY_STUCK = 3, ANOMALY_DROPOUT = 4 };
+
+// Taxas por (amostra, feature) de início de cada tipo; magnitudes em desvios-padrão
+// do sinal limpo, estimados online (Welford)
+struct AnomalyConfig {
+    double spike_rate = 0.0;
+    double drift_rate = 0.0;
+    double stuck_rate = 0.0;
+    double dropout_rate = 0.0;
+
+    double spike_magnitude = 6.0;   // pico de +-spike_magnitude desvios
+    double drift_slope = 0.2;       // deriva cresce drift_slope desvios por amostra
+    int min_duration = 5;           // duração (amostras) de deriva, travamento e perda
+    int max_duration = 50;
+    double dropout_value = 0.0;     // valor lido durante a perda do sensor
+    std::vector<uint8_t> feature_mask;  // feature i recebe anomalias se feature_mask[i] != 0; vazio = todas
+    int warmup = 10;                // amostras iniciais sem anomalia (estatística do sinal)
+    uint64_t seed = 1;
+};
+
+// Injeção em streaming: apply() recebe a linha limpa, altera-a no lugar e grava o tipo
+// de anomalia ativo em cada feature. Estado O(n_features), sem alocação por linha.
+// Uma feature tem no máximo uma anomalia ativa por vez.
+class AnomalyInjector {
+public:
+    AnomalyInjector(int n_features, const AnomalyConfig& config)
+        : config_(config), rng_(config.seed), n_features_(n_features), features_(n_features) {}
+
+    int n_features() const { return n_features_; }
+    uint64_t rows() const { return rows_; }
+
+    // x: linha limpa (n_features valores), sai com as anomalias; labels: tipo por feature.
+    // Retorna a máscara das features anômalas (bit i = feature i, só as 32 primeiras).
+    uint32_t apply(double* x, uint8_t* labels) {
+        uint32_t mask = 0;
+        ++rows_;
+        for (int i = 0; i < n_features_; ++i) {
+            Feature& f = features_[i];
+            double clean = x[i];
+            update_stats(f, clean);
+
+            if (f.type == ANOMALY_NONE && rows_ > (uint64_t)config_.warmup &&
+                injectable(i)) {
+                start(f, clean);
+            }
+
+            labels[i] = f.type;
+            if (f.type == ANOMALY_NONE) continue;
+
+            double sd = stddev(f);
+            switch (f.type) {
+            case ANOMALY_SPIKE:   x[i] = clean + f.sign * config_.spike_magnitude * sd; break;
+            case ANOMALY_DRIFT:   f.offset += f.sign * config_.drift_slope * sd; x[i] = clean + f.offset; break;
+            case ANOMALY_STUCK:   x[i] = f.held; break;
+            case ANOMALY_DROPOUT: x[i] = config_.dropout_value; break;
+            default: break;
+            }
+            if (i < 32) mask |= 1u << i;
+            if (--f.remaining <= 0) f.type = ANOMALY_NONE;
+        }
+        return mask;
+    }
+
+private:
+    bool injectable(int i) const {
+        const std::vector<uint8_t>& m = config_.feature_mask;
+        return m.empty() || ((size_t)i < m.size() && m[i]);
+    }
+
+    struct Feature {
+        uint8_t type = ANOMALY_NONE;
+        int remaining = 0;
+        double sign = 1.0;
+        double offset = 0.0;
+        double held = 0.0;
+        // estatística do sinal limpo
+        double n = 0.0, mean = 0.0, m2 = 0.0;
+    };
+
+    static void update_stats(Feature& f, double v) {
+        f.n += 1.0;
+        double d = v - f.mean;
+        f.mean += d / f.n;
+        f.m2 += d * (v - f.mean);
+    }
+
+    // Desvio-padrão do sinal limpo; 1.0 enquanto o sinal for constante
+    static double stddev(const Feature& f) {
+        double sd = f.n > 1.0 ? std::sqrt(f.m2 / (f.n - 1.0)) : 0.0;
+        return sd > 0.0 ? sd : 1.0;
+    }
+
+    int duration() {
+        int span = config_.max_duration - config_.min_duration + 1;
+        return config_.min_duration + (span > 1 ? int(rng_.uniform() * span) : 0);
+    }
+
+    // Sorteia o início de uma anomalia; taxas somadas como probabilidades disjuntas
+    void start(Feature& f, double clean) {
+        double u = rng_.uniform();
+        double acc = config_.spike_rate;
+        if (u < acc) { begin(f, ANOMALY_SPIKE, 1); return; }
+        acc += config_.drift_rate;
+        if (u < acc) { begin(f, ANOMALY_DRIFT, duration()); return; }
+        acc += config_.stuck_rate;
+        if (u < acc) { begin(f, ANOMALY_STUCK, duration()); f.held = clean; return; }
+        acc += config_.dropout_rate;
+        if (u < acc) { begin(f, ANOMALY_DROPOUT, duration()); return; }
+    }
+
+    void begin(Feature& f, AnomalyType type, int length) {
+        f.type = type;
+        f.remaining = length > 0 ? length : 1;
+        f.sign = rng_.uniform() < 0.5 ? -1.0 : 1.0;
+        f.offset = 0.0;
+    }
+
+    AnomalyConfig config_;
+    SplitMix64 rng_;
+    int n_features_;
+    uint64_t rows_ = 0;
+    std::vector<Feature> features_;
+};
+
+// Fonte sintética de n sinais correlacionados, determinística: uma variável latente
+// (passeio aleatório suavizado, como a velocidade) modula senóides com ganho, fase e
+// ruído próprios por feature
+class SyntheticStream {
+public:
+    SyntheticStream(int n_features, uint64_t seed = 1)
+        : rng_(seed ^ 0x5DEECE66Dull), n_features_(n_features), gain_(n_features), phase_(n_features),
+          period_(n_features), noise_(n_features) {
+        for (int i = 0; i < n_features; ++i) {
+            gain_[i] = 0.5 + rng_.uniform();
+            phase_[i] = 6.283185307179586 * rng_.uniform();
+            period_[i] = 50.0 + 450.0 * rng_.uniform();
+            noise_[i] = 0.01 + 0.04 * rng_.uniform();
+        }
+    }
+
+    // Escreve a próxima linha (n_features valores)
+    void next(double* x) {
+        velocity_ = 0.98 * velocity_ + 0.02 * (rng_.uniform() - 0.5);
+        latent_ += velocity_;
+        if (latent_ < 0.0) { latent_ = 0.0; velocity_ = -velocity_; }
+        if (latent_ > 1.0) { latent_ = 1.0; velocity_ = -velocity_; }
+        for (int i = 0; i < n_features_; ++i) {
+            double wave = std::sin(6.283185307179586 * t_ / period_[i] + phase_[i]);
+            x[i] = gain_[i] * latent_ + 0.1 * wave + noise_[i] * (rng_.uniform() - 0.5);
+        }
+        t_ += 1.0;
+    }
+
+private:
+    SplitMix64 rng_;
+    int n_features_;
+    double t_ = 0.0;
+    double latent_ = 0.5;
+    double velocity_ = 0.0;
+    std::vector<double> gain_, phase_, period_, noise_;
+};
+
+#endif // ANOMALY_INJECTOR_H
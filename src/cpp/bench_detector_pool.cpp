@@ -0,0 +1,171 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "detector_pool.h"
+#include "mstedarls.h"
+#include "mptedarls.h"
+
+// Para compilar:
+// g++ -std=c++17 -O2 -pthread bench_detector_pool.cpp detector_pool.cpp mstedarls.cpp -o bench_detector_pool
+// Uso: ./bench_detector_pool [--mpt] [veiculos_por_thread] [passos]
+//
+// Replay de frota: cada veículo percorre uma das viagens de data/exp_*.csv
+// (speed, rpm, tp, load, timing) a partir de um deslocamento próprio, e os registros
+// chegam intercalados por instante de tempo, como no teleserver.
+
+static const int N_FEATURES = 5;
+
+// Lê as 5 primeiras colunas de cada linha
+std::vector<double> load_trip(const std::string& filename, size_t& n_rows) {
+    std::ifstream file(filename);
+    if (!file.is_open()) throw std::runtime_error("Erro ao abrir arquivo: " + filename);
+
+    std::vector<double> data;
+    std::string line;
+    std::getline(file, line); // Ignora cabeçalho
+
+    n_rows = 0;
+    while (std::getline(file, line)) {
+        std::istringstream ss(line);
+        std::string token;
+        int col = 0;
+        while (col < N_FEATURES && std::getline(ss, token, ',')) {
+            try {
+                data.push_back(std::stod(token));
+            } catch (...) {
+                data.push_back(0.0);
+            }
+            ++col;
+        }
+        if (col == 0) continue;
+        for (; col < N_FEATURES; ++col) data.push_back(0.0);
+        ++n_rows;
+    }
+    return data;
+}
+
+struct Trip {
+    std::vector<double> data;
+    size_t n_rows;
+};
+
+// Monta o feed intercalado: para cada passo t, um registro de cada veículo
+std::vector<FleetRecord> build_feed(const std::vector<Trip>& trips, size_t n_vehicles, size_t steps) {
+    std::vector<FleetRecord> feed;
+    feed.reserve(n_vehicles * steps);
+    for (size_t t = 0; t < steps; ++t) {
+        for (size_t v = 0; v < n_vehicles; ++v) {
+            const Trip& trip = trips[v % trips.size()];
+            size_t row = (v * 37 + t) % trip.n_rows;
+            feed.push_back({(uint32_t)v, &trip.data[row * N_FEATURES]});
+        }
+    }
+    return feed;
+}
+
+MPTEDARLS make_mpt_prototype() {
+    return MPTEDARLS(5.592, N_FEATURES, 0.9249, 0.1, std::vector<double>(N_FEATURES, 0.0),
+                     true, 0, 5, false, 6.0, 1e-6, true, true,
+                     {-100.0, 100.0}, {-100.0, 100.0}, 10.0, false);
+}
+
+template <typename Arena>
+double replay(DetectorPool<Arena>& pool, const std::vector<FleetRecord>& feed, size_t batch,
+              std::vector<double>& out, std::vector<uint32_t>& masks) {
+    out.assign(feed.size() * N_FEATURES, 0.0);
+    masks.assign(feed.size(), 0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < feed.size(); r += batch) {
+        size_t n = std::min(batch, feed.size() - r);
+        pool.process(&feed[r], n, &out[r * N_FEATURES], &masks[r]);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+int main(int argc, char** argv) {
+    bool use_mpt = false;
+    int argi = 1;
+    if (argc > argi && std::strcmp(argv[argi], "--mpt") == 0) {
+        use_mpt = true;
+        ++argi;
+    }
+    size_t per_thread = argc > argi ? std::atoi(argv[argi]) : 64;
+    size_t steps = argc > argi + 1 ? std::atoi(argv[argi + 1]) : 2000;
+
+    std::vector<Trip> trips(2);
+    try {
+        trips[0].data = load_trip("../../data/exp_fastback.csv", trips[0].n_rows);
+        trips[1].data = load_trip("../../data/exp_polo.csv", trips[1].n_rows);
+    } catch (const std::exception& e) {
+        std::cerr << "Erro: " << e.what() << std::endl;
+        return 1;
+    }
+
+    int max_threads = (int)std::thread::hardware_concurrency();
+    if (max_threads <= 0) max_threads = 1;
+
+    std::vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    std::cout << (use_mpt ? "MPTEDARLS" : "MSTEDARLS") << ": " << per_thread
+              << " veículos por thread, " << steps << " passos\n";
+
+    double base_rate = 0.0;
+    for (int threads : thread_counts) {
+        size_t n_vehicles = per_thread * threads;
+        std::vector<FleetRecord> feed = build_feed(trips, n_vehicles, steps);
+        size_t batch = n_vehicles * 16;  // 16 instantes de tempo por chamada
+
+        std::vector<double> out;
+        std::vector<uint32_t> masks;
+        double secs;
+        if (use_mpt) {
+            DetectorPool<ModelSet<MPTEDARLS>> pool(
+                ModelSet<MPTEDARLS>(n_vehicles, N_FEATURES, make_mpt_prototype()), threads);
+            secs = replay(pool, feed, batch, out, masks);
+        } else {
+            DetectorPool<MSTEDARLSArena> pool(
+                MSTEDARLSArena(n_vehicles, N_FEATURES, 8.414, 0.7, 1000.0, 1.0, true), threads);
+            secs = replay(pool, feed, batch, out, masks);
+        }
+
+        // confere contra instâncias independentes processadas em sequência
+        size_t check = std::min<size_t>(n_vehicles, 4);
+        for (size_t v = 0; v < check; ++v) {
+            MSTEDARLS mst(8.414, 0.7, 1000.0, 1.0, N_FEATURES, true);
+            MPTEDARLS mpt = make_mpt_prototype();
+            double y[N_FEATURES];
+            uint32_t mask = 0;
+            for (size_t t = 0; t < steps; ++t) {
+                size_t r = t * n_vehicles + v;
+                if (use_mpt) {
+                    auto res = mpt.run(std::vector<double>(feed[r].x, feed[r].x + N_FEATURES));
+                    for (int i = 0; i < N_FEATURES; ++i) y[i] = res.x_filtered[i];
+                    mask = res.outlier_flag ? 1u : 0u;
+                } else {
+                    mst.update(feed[r].x, y, mask);
+                }
+                if (std::memcmp(y, &out[r * N_FEATURES], sizeof(y)) != 0 || mask != masks[r]) {
+                    std::cerr << "Erro: saída divergente no veículo " << v << ", passo " << t << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        double rate = feed.size() / secs;
+        if (threads == 1) base_rate = rate;
+        std::printf("threads %3d  veículos %6zu  %12.0f registros/s  speedup %5.2f\n",
+                    threads, n_vehicles, rate, base_rate > 0.0 ? rate / base_rate : 0.0);
+    }
+    return 0;
+}
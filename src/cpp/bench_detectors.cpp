@@ -0,0 +1,327 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <new>
+#include "mstedarls_fixed.h"
+#include "mptedarls.h"
+#include "alloc_counter.h"  // g_allocs: operator new instrumentado
+
+// Para compilar:
+// g++ -std=c++17 -O2 bench_detectors.cpp -o bench_detectors
+// Uso: ./bench_detectors [--json arquivo.json] [--filter texto] [--min-time segundos]
+//
+// Microbenchmarks dos detectores, no formato JSON do Google Benchmark
+// ("context" + lista "benchmarks"), para comparar execuções e achar regressões.
+// Cada caso mede:
+//   - latência por amostra (p50/p99), com um relógio em volta de cada update()/run()
+//   - vazão (amostras/s) num laço sem relógio por amostra
+//   - alocações de heap por amostra (operator new global instrumentado)
+// Casos: {MSTEDARLS, MPTEDARLS global, MPTEDARLS por dimensão} x n = 2..64
+//        x {double, float} x {dados das viagens, sintético}.
+// MSTEDARLS com n = 64 roda como dois blocos MSTEDARLSFixed<32> (máscara de 32 bits).
+
+// ---------------- Entradas ----------------
+
+// Colunas speed, rpm, tp, load, timing das viagens, normalizadas em [0, 1]
+std::vector<std::vector<double>> load_trips() {
+    const char* files[] = { "../../data/dados_sem_outliers_fastback.csv",
+                            "../../data/dados_sem_outliers_polo.csv" };
+    std::vector<std::vector<double>> rows;
+    for (const char* filename : files) {
+        std::ifstream file(filename);
+        if (!file.is_open()) throw std::runtime_error(std::string("Erro ao abrir arquivo: ") + filename);
+        std::string line;
+        std::getline(file, line); // Ignora cabeçalho
+        while (std::getline(file, line)) {
+            std::vector<double> row;
+            std::istringstream ss(line);
+            std::string token;
+            while (row.size() < 5 && std::getline(ss, token, ',')) {
+                try {
+                    row.push_back(std::stod(token));
+                } catch (...) {
+                    row.push_back(0.0);
+                }
+            }
+            if (row.empty()) continue;
+            row.resize(5, 0.0);
+            rows.push_back(row);
+        }
+    }
+
+    for (int f = 0; f < 5; ++f) {
+        double lo = rows[0][f], hi = rows[0][f];
+        for (const auto& r : rows) {
+            lo = std::min(lo, r[f]);
+            hi = std::max(hi, r[f]);
+        }
+        double range = hi > lo ? hi - lo : 1.0;
+        for (auto& r : rows) r[f] = (r[f] - lo) / range;
+    }
+    return rows;
+}
+
+// Matriz n_rows x n: a feature f repete a coluna f % 5 das viagens com atraso de 7*(f/5) linhas
+std::vector<double> replay_stream(const std::vector<std::vector<double>>& trips, int n, size_t n_rows) {
+    std::vector<double> x(n_rows * n);
+    for (size_t r = 0; r < n_rows; ++r)
+        for (int f = 0; f < n; ++f)
+            x[r * n + f] = trips[(r + 7 * (f / 5)) % trips.size()][f % 5];
+    return x;
+}
+
+// Senóides com ruído e picos esparsos (LCG determinístico)
+std::vector<double> synthetic_stream(int n, size_t n_rows) {
+    std::vector<double> x(n_rows * n);
+    uint32_t seed = 12345;
+    auto rnd = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / double(1u << 24);
+    };
+    for (size_t r = 0; r < n_rows; ++r) {
+        for (int f = 0; f < n; ++f) {
+            double v = 0.5 + 0.3 * std::sin(0.01 * r * (1 + f % 7) + f) + 0.02 * (rnd() - 0.5);
+            if (rnd() < 0.005) v += 2.0;
+            x[r * n + f] = v;
+        }
+    }
+    return x;
+}
+
+// ---------------- Modelos ----------------
+
+// MSTEDARLSFixed com N escolhido em tempo de execução (n <= 32, ou 64 em dois blocos)
+template <typename T>
+struct MSTRunner {
+    virtual ~MSTRunner() {}
+    virtual void step(const T* in, T* out) = 0;
+};
+
+template <std::size_t N, typename T>
+struct MSTFixedRunner : MSTRunner<T> {
+    MSTEDARLSFixed<N, T> model{T(8.414), T(0.7), T(1000.0), T(1.0), true};
+    uint32_t mask = 0;
+    void step(const T* in, T* out) override { model.update(in, out, mask); }
+};
+
+template <typename T>
+struct MST64Runner : MSTRunner<T> {
+    MSTFixedRunner<32, T> lo, hi;
+    void step(const T* in, T* out) override {
+        lo.step(in, out);
+        hi.step(in + 32, out + 32);
+    }
+};
+
+template <typename T>
+MSTRunner<T>* make_mst(int n) {
+    switch (n) {
+        case 2:  return new MSTFixedRunner<2, T>();
+        case 4:  return new MSTFixedRunner<4, T>();
+        case 5:  return new MSTFixedRunner<5, T>();
+        case 8:  return new MSTFixedRunner<8, T>();
+        case 16: return new MSTFixedRunner<16, T>();
+        case 32: return new MSTFixedRunner<32, T>();
+        case 64: return new MST64Runner<T>();
+    }
+    return nullptr;
+}
+
+template <typename T>
+MPTEDARLSBasic<T> make_mpt(int n, bool per_dim) {
+    return MPTEDARLSBasic<T>(5.592, n, 0.9249, 0.1, std::vector<double>(n, 0.0),
+                             true, 0, 5, per_dim, 6.0, 1e-6, true, true,
+                             {-100.0, 100.0}, {-100.0, 100.0}, 10.0, false);
+}
+
+// ---------------- Medição ----------------
+
+struct CaseResult {
+    std::string name;
+    size_t iterations;
+    double p50_ns, p99_ns, mean_ns;
+    double samples_per_sec;
+    double allocs_per_sample;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+// step(r) processa a linha r; reset() recria o modelo.
+// Repete o fluxo até acumular min_time segundos em cada fase.
+template <typename Reset, typename Step>
+CaseResult measure(const std::string& name, size_t n_rows, double min_time, Reset reset, Step step) {
+    CaseResult res;
+    res.name = name;
+
+    // fase 1: latência por amostra
+    std::vector<double> lat;
+    lat.reserve(n_rows);
+    double elapsed = 0.0;
+    do {
+        reset();
+        for (size_t r = 0; r < n_rows; ++r) {
+            auto t0 = Clock::now();
+            step(r);
+            auto t1 = Clock::now();
+            double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+            lat.push_back(ns);
+            elapsed += ns * 1e-9;
+        }
+    } while (elapsed < min_time);
+
+    std::sort(lat.begin(), lat.end());
+    res.p50_ns = lat[lat.size() / 2];
+    res.p99_ns = lat[std::min(lat.size() - 1, lat.size() * 99 / 100)];
+
+    // fase 2: vazão e alocações, sem relógio por amostra
+    size_t samples = 0;
+    size_t allocs = 0;
+    double secs = 0.0;
+    do {
+        reset();  // construção fora da contagem
+        size_t before = g_allocs;
+        auto t0 = Clock::now();
+        for (size_t r = 0; r < n_rows; ++r) step(r);
+        auto t1 = Clock::now();
+        allocs += g_allocs - before;
+        secs += std::chrono::duration<double>(t1 - t0).count();
+        samples += n_rows;
+    } while (secs < min_time);
+
+    res.iterations = samples;
+    res.mean_ns = secs * 1e9 / samples;
+    res.samples_per_sec = samples / secs;
+    res.allocs_per_sample = double(allocs) / samples;
+    return res;
+}
+
+template <typename T>
+void run_type(const char* type_name, const std::vector<std::vector<double>>& trips,
+              const std::string& filter, double min_time, std::vector<CaseResult>& results) {
+    const int dims[] = { 2, 4, 5, 8, 16, 32, 64 };
+    const char* sources[] = { "replay", "synthetic" };
+
+    for (int n : dims) {
+        // fluxos menores para n grande: o custo do MPTEDARLS cresce com n³
+        size_t n_rows = n <= 16 ? 1073 : (n <= 32 ? 400 : 150);
+
+        for (const char* source : sources) {
+            std::vector<double> xd = std::strcmp(source, "replay") == 0
+                ? replay_stream(trips, n, n_rows) : synthetic_stream(n, n_rows);
+            std::vector<T> x(xd.begin(), xd.end());
+            std::vector<T> out(n), pred(n);
+
+            std::string suffix = std::string("/") + type_name + "/n:" + std::to_string(n) + "/" + source;
+
+            std::string name = "MSTEDARLS" + suffix;
+            if (name.find(filter) != std::string::npos) {
+                MSTRunner<T>* mst = nullptr;
+                results.push_back(measure(name, n_rows, min_time,
+                    [&]() { delete mst; mst = make_mst<T>(n); },
+                    [&](size_t r) { mst->step(&x[r * n], out.data()); }));
+                delete mst;
+            }
+
+            for (int per_dim = 0; per_dim < 2; ++per_dim) {
+                name = std::string(per_dim ? "MPTEDARLS_per_dim" : "MPTEDARLS_global") + suffix;
+                if (name.find(filter) == std::string::npos) continue;
+                MPTEDARLSBasic<T> mpt = make_mpt<T>(n, per_dim);
+                results.push_back(measure(name, n_rows, min_time,
+                    [&]() { mpt = make_mpt<T>(n, per_dim); },
+                    [&](size_t r) { mpt.run(&x[r * n], pred.data(), out.data()); }));
+            }
+        }
+    }
+}
+
+void write_json(std::ostream& out, const std::vector<CaseResult>& results) {
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"executable\": \"bench_detectors\",\n"
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\"\n"
+#else
+        << "    \"library_build_type\": \"debug\"\n"
+#endif
+        << "  },\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const CaseResult& r = results[i];
+        char buf[512];
+        std::snprintf(buf, sizeof(buf),
+            "    {\n"
+            "      \"name\": \"%s\",\n"
+            "      \"run_type\": \"iteration\",\n"
+            "      \"iterations\": %zu,\n"
+            "      \"real_time\": %.3f,\n"
+            "      \"cpu_time\": %.3f,\n"
+            "      \"time_unit\": \"ns\",\n"
+            "      \"p50_ns\": %.3f,\n"
+            "      \"p99_ns\": %.3f,\n"
+            "      \"items_per_second\": %.1f,\n"
+            "      \"allocs_per_item\": %.4f\n"
+            "    }%s\n",
+            r.name.c_str(), r.iterations, r.mean_ns, r.mean_ns, r.p50_ns, r.p99_ns,
+            r.samples_per_sec, r.allocs_per_sample, i + 1 < results.size() ? "," : "");
+        out << buf;
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    std::string json_file;
+    std::string filter;
+    double min_time = 0.05;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_file = argv[++i];
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+        else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) min_time = std::atof(argv[++i]);
+        else {
+            std::cerr << "Uso: " << argv[0] << " [--json arquivo.json] [--filter texto] [--min-time segundos]\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::vector<double>> trips;
+    try {
+        trips = load_trips();
+    } catch (const std::exception& e) {
+        std::cerr << "Erro: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<CaseResult> results;
+    run_type<double>("double", trips, filter, min_time, results);
+    run_type<float>("float", trips, filter, min_time, results);
+
+    std::fprintf(stderr, "%-44s %10s %10s %10s %14s %10s\n",
+                 "caso", "média ns", "p50 ns", "p99 ns", "amostras/s", "alocs");
+    for (const auto& r : results) {
+        std::fprintf(stderr, "%-44s %10.1f %10.1f %10.1f %14.0f %10.2f\n",
+                     r.name.c_str(), r.mean_ns, r.p50_ns, r.p99_ns, r.samples_per_sec, r.allocs_per_sample);
+    }
+
+    if (json_file.empty()) {
+        write_json(std::cout, results);
+    } else {
+        std::ofstream out(json_file);
+        if (!out.is_open()) {
+            std::cerr << "Erro ao criar: " << json_file << std::endl;
+            return 1;
+        }
+        write_json(out, results);
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "mstedarls.h"
+#include "mstedarls_fixed.h"
+#include "alloc_counter.h"  // g_allocs: operator new instrumentado
+
+// Para compilar:
+// g++ -std=c++17 -O2 bench_mstedarls.cpp mstedarls.cpp -o bench_mstedarls
+// Com -march=native: acrescentar -ffp-contract=off (lote idêntico bit a bit ao update())
+// Uso: ./bench_mstedarls [arquivo.csv] [repeticoes]
+
+static const int N_FEATURES = 5;
+
+std::vector<double> load_csv_flat(const std::string& filename, size_t& n_rows) {
+    std::ifstream file(filename);
+    if (!file.is_open()) throw std::runtime_error("Erro ao abrir arquivo: " + filename);
+
+    std::vector<double> data;
+    std::string line;
+    std::getline(file, line); // Ignora cabeçalho
+
+    n_rows = 0;
+    while (std::getline(file, line)) {
+        std::istringstream ss(line);
+        std::string token;
+        int col = 0;
+        while (std::getline(ss, token, ',') && col < N_FEATURES) {
+            try {
+                data.push_back(std::stod(token));
+            } catch (...) {
+                data.push_back(0.0);
+            }
+            ++col;
+        }
+        if (col == 0) continue;
+        if (col != N_FEATURES) throw std::runtime_error("Linha com número de colunas inválido");
+        ++n_rows;
+    }
+    return data;
+}
+
+struct BenchResult {
+    double ns_per_sample;
+    double allocs_per_sample;
+    double checksum;
+};
+
+template <typename F>
+BenchResult run_bench(size_t n_samples, F&& body) {
+    size_t allocs_before = g_allocs;
+    auto t0 = std::chrono::steady_clock::now();
+    double checksum = body();
+    auto t1 = std::chrono::steady_clock::now();
+    size_t allocs = g_allocs - allocs_before;
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return {ns / n_samples, double(allocs) / n_samples, checksum};
+}
+
+void print_result(const char* name, const BenchResult& r) {
+    std::printf("%-32s %10.1f ns/amostra %8.2f alocs/amostra  (checksum %.6f)\n",
+                name, r.ns_per_sample, r.allocs_per_sample, r.checksum);
+}
+
+int main(int argc, char** argv) {
+    std::string input_file = argc > 1 ? argv[1] : "../../data/dados_sem_outliers_fastback.csv";
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    size_t n_rows = 0;
+    std::vector<double> data;
+    try {
+        data = load_csv_flat(input_file, n_rows);
+    } catch (const std::exception& e) {
+        std::cerr << "Erro: " << e.what() << std::endl;
+        return 1;
+    }
+    if (n_rows == 0) {
+        std::cerr << "Arquivo CSV vazio ou inválido." << std::endl;
+        return 1;
+    }
+
+    size_t n_samples = n_rows * repeats;
+    std::cout << input_file << ": " << n_rows << " linhas x " << repeats << " repetições\n";
+
+    // Antes: API baseada em std::vector (cópia da entrada + vector<bool> + pair por amostra)
+    BenchResult before = run_bench(n_samples, [&]() {
+        double checksum = 0.0;
+        for (int r = 0; r < repeats; ++r) {
+            MSTEDARLS model(8.414, 0.7, 1000.0, 1.0, N_FEATURES, true);
+            for (size_t i = 0; i < n_rows; ++i) {
+                std::vector<double> sample(&data[i * N_FEATURES], &data[i * N_FEATURES] + N_FEATURES);
+                auto [corrected, is_outlier] = model.update(sample);
+                checksum += corrected[0] + is_outlier[0];
+            }
+        }
+        return checksum;
+    });
+
+    // Depois: sobrecarga sem alocação da classe dinâmica
+    BenchResult dynamic_ptr = run_bench(n_samples, [&]() {
+        double checksum = 0.0;
+        double out[N_FEATURES];
+        uint32_t mask = 0;
+        for (int r = 0; r < repeats; ++r) {
+            MSTEDARLS model(8.414, 0.7, 1000.0, 1.0, N_FEATURES, true);
+            for (size_t i = 0; i < n_rows; ++i) {
+                model.update(&data[i * N_FEATURES], out, mask);
+                checksum += out[0] + (mask & 1u);
+            }
+        }
+        return checksum;
+    });
+
+    // Depois: template de dimensão fixa
+    BenchResult fixed = run_bench(n_samples, [&]() {
+        double checksum = 0.0;
+        double out[N_FEATURES];
+        uint32_t mask = 0;
+        for (int r = 0; r < repeats; ++r) {
+            MSTEDARLSFixed<N_FEATURES, double> model(8.414, 0.7, 1000.0, 1.0, true);
+            for (size_t i = 0; i < n_rows; ++i) {
+                model.update(&data[i * N_FEATURES], out, mask);
+                checksum += out[0] + (mask & 1u);
+            }
+        }
+        return checksum;
+    });
+
+    // Lote colunar: dados transpostos uma única vez (fora da medição)
+    std::vector<std::vector<double>> cols(N_FEATURES, std::vector<double>(n_rows));
+    std::vector<std::vector<double>> out_cols(N_FEATURES, std::vector<double>(n_rows));
+    std::vector<uint32_t> masks(n_rows);
+    const double* in_ptrs[N_FEATURES];
+    double* out_ptrs[N_FEATURES];
+    for (int f = 0; f < N_FEATURES; ++f) {
+        for (size_t i = 0; i < n_rows; ++i) cols[f][i] = data[i * N_FEATURES + f];
+        in_ptrs[f] = cols[f].data();
+        out_ptrs[f] = out_cols[f].data();
+    }
+
+    BenchResult batch = run_bench(n_samples, [&]() {
+        double checksum = 0.0;
+        for (int r = 0; r < repeats; ++r) {
+            MSTEDARLS model(8.414, 0.7, 1000.0, 1.0, N_FEATURES, true);
+            model.process_batch(in_ptrs, n_rows, out_ptrs, masks.data());
+            for (size_t i = 0; i < n_rows; ++i)
+                checksum += out_cols[0][i] + (masks[i] & 1u);
+        }
+        return checksum;
+    });
+
+    print_result("MSTEDARLS::update(vector)", before);
+    print_result("MSTEDARLS::update(ptr)", dynamic_ptr);
+    print_result("MSTEDARLSFixed<5,double>", fixed);
+    print_result("MSTEDARLS::process_batch", batch);
+
+    if (before.checksum != dynamic_ptr.checksum || before.checksum != fixed.checksum ||
+        before.checksum != batch.checksum) {
+        std::cerr << "Erro: saídas divergentes entre as implementações." << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "mstedarls_fixed.h"
+#include "tedarls_numeric.h"
+#include "mptedarls.h"
+
+// Para compilar:
+// g++ -std=c++17 -O2 compare_numeric.cpp -o compare_numeric
+// Uso: ./compare_numeric [--no-inject] [arquivo.csv ...]
+//
+// Roda MSTEDARLSFixed<5, T> e MPTEDARLSBasic<T> com T = double, float e q16_16 sobre os
+// dados normalizados (min-max) e compara com a referência em double: precisão/recall
+// das flags de outlier, maior desvio da saída e tempo por amostra. O MPTEDARLS roda
+// também com o RLS em raiz quadrada (RlsBackend::SquareRoot) em double e float. Por
+// padrão injeta picos determinísticos para que haja outliers a detectar.
+
+static const int N_FEATURES = 5;
+
+std::vector<std::vector<double>> load_csv(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) throw std::runtime_error("Erro ao abrir arquivo: " + filename);
+
+    std::vector<std::vector<double>> data;
+    std::string line;
+    std::getline(file, line); // Ignora cabeçalho
+
+    while (std::getline(file, line)) {
+        std::vector<double> row;
+        std::istringstream ss(line);
+        std::string token;
+        while ((int)row.size() < N_FEATURES && std::getline(ss, token, ',')) {
+            try {
+                row.push_back(std::stod(token));
+            } catch (...) {
+                row.push_back(0.0);
+            }
+        }
+        if (row.empty()) continue;
+        row.resize(N_FEATURES, 0.0);
+        data.push_back(row);
+    }
+    return data;
+}
+
+// Normalização min-max por coluna; picos injetados ficam fora de [0, 1]
+void normalize(std::vector<std::vector<double>>& data, bool inject) {
+    for (int f = 0; f < N_FEATURES; ++f) {
+        double lo = data[0][f], hi = data[0][f];
+        for (const auto& row : data) {
+            lo = std::min(lo, row[f]);
+            hi = std::max(hi, row[f]);
+        }
+        double range = hi > lo ? hi - lo : 1.0;
+        for (auto& row : data) row[f] = (row[f] - lo) / range;
+    }
+
+    if (inject) {
+        for (size_t i = 50; i < data.size(); i += 37) {
+            data[i][i % N_FEATURES] += (i % 2 ? 3.0 : -2.5);
+        }
+    }
+}
+
+// Saída de uma execução convertida para double
+struct RunOutput {
+    std::vector<uint32_t> flags;   // MST: máscara por feature; MPT: flag global
+    std::vector<double> out;       // n_rows x N_FEATURES
+    double ns_per_sample;
+};
+
+template <typename T>
+RunOutput run_mst(const std::vector<std::vector<double>>& data, int repeats) {
+    RunOutput r;
+    r.flags.resize(data.size());
+    r.out.resize(data.size() * N_FEATURES);
+
+    // conversão para T fora da medição
+    std::vector<T> in(data.size() * N_FEATURES);
+    for (size_t i = 0; i < data.size(); ++i)
+        for (int f = 0; f < N_FEATURES; ++f) in[i * N_FEATURES + f] = T(data[i][f]);
+    std::vector<T> out(in.size());
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < repeats; ++rep) {
+        MSTEDARLSFixed<N_FEATURES, T> model(T(8.414), T(0.7), T(1000.0), T(1.0), true);
+        for (size_t i = 0; i < data.size(); ++i) {
+            model.update(&in[i * N_FEATURES], &out[i * N_FEATURES], r.flags[i]);
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    r.ns_per_sample = std::chrono::duration<double, std::nano>(t1 - t0).count() / (data.size() * repeats);
+
+    for (size_t i = 0; i < out.size(); ++i) r.out[i] = tedarls_to_double(out[i]);
+    return r;
+}
+
+template <typename T>
+RunOutput run_mpt(const std::vector<std::vector<double>>& data, int repeats,
+                  RlsBackend backend = RlsBackend::Covariance) {
+    RunOutput r;
+    r.flags.resize(data.size());
+    r.out.resize(data.size() * N_FEATURES);
+
+    std::vector<std::vector<T>> in(data.size(), std::vector<T>(N_FEATURES));
+    for (size_t i = 0; i < data.size(); ++i)
+        for (int f = 0; f < N_FEATURES; ++f) in[i][f] = T(data[i][f]);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < repeats; ++rep) {
+        MPTEDARLSBasic<T> model(5.592, N_FEATURES, 0.9249, 0.1, std::vector<double>(N_FEATURES, 0.0),
+                                true, 0, 5, false, 6.0, 1e-6, true, true,
+                                {-100.0, 100.0}, {-100.0, 100.0}, 10.0, false);
+        model.setRlsBackend(backend);
+        for (size_t i = 0; i < data.size(); ++i) {
+            auto res = model.run(in[i]);
+            r.flags[i] = res.outlier_flag ? 1u : 0u;
+            if (rep == repeats - 1) {
+                for (int f = 0; f < N_FEATURES; ++f)
+                    r.out[i * N_FEATURES + f] = tedarls_to_double(res.x_filtered[f]);
+            }
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    r.ns_per_sample = std::chrono::duration<double, std::nano>(t1 - t0).count() / (data.size() * repeats);
+    return r;
+}
+
+// Compara as flags bit a bit com a referência (verdadeiro = flag em double)
+void report(const char* name, const RunOutput& ref, const RunOutput& r) {
+    size_t tp = 0, fp = 0, fn = 0;
+    for (size_t i = 0; i < ref.flags.size(); ++i) {
+        for (int b = 0; b < N_FEATURES; ++b) {
+            bool want = (ref.flags[i] >> b) & 1u;
+            bool got = (r.flags[i] >> b) & 1u;
+            if (want && got) ++tp;
+            else if (got) ++fp;
+            else if (want) ++fn;
+        }
+    }
+    double max_diff = 0.0;
+    for (size_t i = 0; i < ref.out.size(); ++i) {
+        max_diff = std::max(max_diff, std::fabs(ref.out[i] - r.out[i]));
+    }
+    double precision = tp + fp ? double(tp) / (tp + fp) : 1.0;
+    double recall = tp + fn ? double(tp) / (tp + fn) : 1.0;
+
+    std::printf("  %-22s %9.1f ns/amostra  flags %4zu  precisão %.4f  recall %.4f  desvio máx %.3e\n",
+                name, r.ns_per_sample, tp + fp, precision, recall, max_diff);
+}
+
+int main(int argc, char** argv) {
+    bool inject = true;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--no-inject") == 0) inject = false;
+        else files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        files.push_back("../../data/dados_sem_outliers_fastback.csv");
+        files.push_back("../../data/dados_sem_outliers_polo.csv");
+    }
+
+    const int repeats = 50;
+    for (const auto& file : files) {
+        std::vector<std::vector<double>> data;
+        try {
+            data = load_csv(file);
+        } catch (const std::exception& e) {
+            std::cerr << "Erro: " << e.what() << std::endl;
+            return 1;
+        }
+        if (data.empty()) {
+            std::cerr << "Arquivo CSV vazio ou inválido: " << file << std::endl;
+            return 1;
+        }
+        normalize(data, inject);
+
+        std::cout << file << " (" << data.size() << " linhas" << (inject ? ", com picos injetados" : "") << ")\n";
+
+        RunOutput mst_ref = run_mst<double>(data, repeats);
+        report("MSTEDARLS<double>", mst_ref, mst_ref);
+        report("MSTEDARLS<float>", mst_ref, run_mst<float>(data, repeats));
+        report("MSTEDARLS<q16_16>", mst_ref, run_mst<q16_16>(data, repeats));
+
+        RunOutput mpt_ref = run_mpt<double>(data, repeats);
+        report("MPTEDARLS<double>", mpt_ref, mpt_ref);
+        report("MPTEDARLS<float>", mpt_ref, run_mpt<float>(data, repeats));
+        report("MPTEDARLS<q16_16>", mpt_ref, run_mpt<q16_16>(data, repeats));
+        report("MPTEDARLS<double> sqrt", mpt_ref, run_mpt<double>(data, repeats, RlsBackend::SquareRoot));
+        report("MPTEDARLS<float> sqrt", mpt_ref, run_mpt<float>(data, repeats, RlsBackend::SquareRoot));
+    }
+    return 0;
+}
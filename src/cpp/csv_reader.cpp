@@ -0,0 +1,102 @@
+#include "csv_reader.h"
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void CsvReader::open(const std::string& filename) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Erro ao abrir arquivo: " + filename);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Erro ao abrir arquivo: " + filename);
+    }
+    size_ = st.st_size;
+
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            throw std::runtime_error("Erro ao mapear arquivo: " + filename);
+        }
+        madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(p);
+    }
+    ::close(fd);  // o mapeamento continua válido
+
+    pos_ = data_;
+    end_ = data_ + size_;
+
+    // Leitura do cabeçalho
+    if (pos_ < end_) {
+        const char* eol = static_cast<const char*>(std::memchr(pos_, '\n', end_ - pos_));
+        const char* line_end = eol ? eol : end_;
+        const char* field = pos_;
+        for (const char* c = pos_; ; ++c) {
+            if (c == line_end || *c == ',') {
+                const char* fe = c;
+                if (fe > field && fe[-1] == '\r') --fe;
+                if (c != line_end || fe > field) header_.emplace_back(field, fe);  // como getline: sem campo vazio final
+                if (c == line_end) break;
+                field = c + 1;
+            }
+        }
+        pos_ = eol ? eol + 1 : end_;
+        line_ = 1;
+    }
+    row_.assign(header_.size(), 0.0);
+}
+
+void CsvReader::close() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+    data_ = pos_ = end_ = nullptr;
+    size_ = 0;
+    line_ = 0;
+    header_.clear();
+    row_.clear();
+}
+
+bool CsvReader::next() {
+    const size_t n_cols = header_.size();
+
+    while (pos_ < end_) {
+        const char* eol = static_cast<const char*>(std::memchr(pos_, '\n', end_ - pos_));
+        const char* line_end = eol ? eol : end_;
+        const char* p = pos_;
+        pos_ = eol ? eol + 1 : end_;
+        ++line_;
+
+        if (p == line_end || (line_end - p == 1 && *p == '\r')) continue;  // linha vazia
+
+        size_t col = 0;
+        while (col < n_cols) {
+            const char* comma = static_cast<const char*>(std::memchr(p, ',', line_end - p));
+            const char* field_end = comma ? comma : line_end;
+
+            // como std::stod: ignora espaços iniciais e '+'; só o prefixo numérico vale
+            const char* s = p;
+            while (s < field_end && (*s == ' ' || *s == '\t')) ++s;
+            if (s < field_end && *s == '+') ++s;
+            double value = 0.0;
+            if (std::from_chars(s, field_end, value).ec != std::errc()) value = 0.0;
+            row_[col++] = value;
+
+            if (!comma) break;
+            p = comma + 1;
+        }
+        if (col < n_cols) {
+            throw std::runtime_error("Linha " + std::to_string(line_) + ": " + std::to_string(col) +
+                                     " campos, esperados " + std::to_string(n_cols));
+        }
+        return true;
+    }
+    return false;
+}
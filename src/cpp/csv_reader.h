@@ -0,0 +1,51 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Leitor de CSV numérico em streaming sobre o arquivo mapeado em memória (mmap).
+// Cada next() converte a próxima linha com std::from_chars direto para um buffer
+// reaproveitado, sem cópias de linha nem std::string por campo: o uso de memória
+// não depende do tamanho do arquivo.
+//
+// Mesmas regras dos drivers antigos (getline + stod): a 1ª linha é o cabeçalho,
+// linhas vazias (ou só com '\r') são ignoradas, campos vazios ou inválidos viram
+// 0.0 e colunas além do cabeçalho são descartadas. Linha com menos campos que o
+// cabeçalho é erro (std::runtime_error), como nos drivers antigos, em que o modelo
+// a rejeitava.
+class CsvReader {
+public:
+    CsvReader() {}
+    explicit CsvReader(const std::string& filename) { open(filename); }
+    ~CsvReader() { close(); }
+
+    CsvReader(const CsvReader&) = delete;
+    CsvReader& operator=(const CsvReader&) = delete;
+
+    // Lança std::runtime_error se o arquivo não puder ser aberto/mapeado
+    void open(const std::string& filename);
+    void close();
+
+    const std::vector<std::string>& header() const { return header_; }
+    size_t columns() const { return header_.size(); }
+
+    // Avança para a próxima linha de dados; false no fim do arquivo.
+    // Lança std::runtime_error se a linha tiver menos campos que o cabeçalho.
+    bool next();
+    // Valores da linha atual (columns() doubles), válidos até o próximo next()
+    const double* row() const { return row_.data(); }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    const char* pos_ = nullptr;
+    const char* end_ = nullptr;
+    size_t line_ = 0;  // número (base 1) da última linha lida
+
+    std::vector<std::string> header_;
+    std::vector<double> row_;
+};
+
+#endif // CSV_READER_H
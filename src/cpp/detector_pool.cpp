@@ -0,0 +1,117 @@
+#include "detector_pool.h"
+#include "mstedarls_fixed.h"
+
+// ---------------- ThreadPool ----------------
+
+ThreadPool::ThreadPool(int n_threads) {
+    if (n_threads <= 0) n_threads = (int)std::thread::hardware_concurrency();
+    if (n_threads <= 0) n_threads = 1;
+    n_threads_ = n_threads;
+
+    // a thread chamadora também trabalha em run(), então cria n_threads - 1 auxiliares
+    for (int t = 1; t < n_threads_; ++t) {
+        workers_.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+void ThreadPool::drain() {
+    size_t task;
+    while ((task = next_task_.fetch_add(1, std::memory_order_relaxed)) < n_tasks_) {
+        (*fn_)(task);
+    }
+}
+
+void ThreadPool::worker_loop() {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+
+        drain();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0) done_cv_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run(size_t n_tasks, const std::function<void(size_t)>& fn) {
+    if (n_tasks == 0) return;
+
+    if (workers_.empty() || n_tasks == 1) {
+        for (size_t t = 0; t < n_tasks; ++t) fn(t);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn_ = &fn;
+        n_tasks_ = n_tasks;
+        next_task_.store(0, std::memory_order_relaxed);
+        busy_ = (int)workers_.size();
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    drain();
+
+    // espera as auxiliares terminarem antes de liberar fn
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&] { return busy_ == 0; });
+    fn_ = nullptr;
+}
+
+// ---------------- MSTEDARLSArena ----------------
+
+MSTEDARLSArena::MSTEDARLSArena(size_t n_vehicles, int n_features, double threshold,
+                               double rls_mu, double rls_delta, double w_init,
+                               bool correct_outlier)
+    : threshold_(threshold), rls_mu_(rls_mu), correct_outlier_(correct_outlier),
+      n_features_(n_features)
+{
+    if (n_features < 1 || n_features > 32) {
+        throw std::invalid_argument("MSTEDARLSArena: n_features deve estar em [1, 32]");
+    }
+    size_t total = n_vehicles * n_features;
+    n_.assign(n_vehicles, 0.0);
+    mean_.assign(total, 0.0);
+    var_.assign(total, 0.0);
+    w_.assign(total, w_init);
+    P_.assign(total, rls_delta);
+}
+
+void MSTEDARLSArena::update(size_t v, const double* x_in, double* x_out, uint32_t& outlier_mask) {
+    double n = (n_[v] += 1.0);
+    size_t base = v * n_features_;
+    double* mean = &mean_[base];
+    double* var = &var_[base];
+    double* w = &w_[base];
+    double* P = &P_[base];
+    uint32_t mask = 0;
+
+    for (int i = 0; i < n_features_; ++i) {
+        double x = x_in[i];
+        if (mstedarls_teda(x, n, mean[i], var[i], threshold_)) {
+            mask |= (uint32_t(1) << i);
+            if (correct_outlier_) x = w[i];
+        }
+        mstedarls_rls(x, w[i], P[i], rls_mu_);
+        x_out[i] = x;
+    }
+
+    outlier_mask = mask;
+}
@@ -0,0 +1,174 @@
+#ifndef DETECTOR_POOL_H
+#define DETECTOR_POOL_H
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+// Registro de um feed de frota: amostra x (n_features valores) do veículo vehicle_id.
+// vehicle_id deve ser denso, em [0, n_vehicles). Os registros de um veículo são
+// processados na ordem em que aparecem no feed.
+struct FleetRecord {
+    uint32_t vehicle_id;
+    const double* x;
+};
+
+// Pool de threads persistente. run(n_tasks, fn) executa fn(task) para todas as tarefas:
+// cada thread pega a próxima tarefa livre num contador atômico, de modo que as threads
+// que terminam antes roubam o trabalho restante das mais lentas.
+class ThreadPool {
+public:
+    explicit ThreadPool(int n_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return n_threads_; }
+    void run(size_t n_tasks, const std::function<void(size_t)>& fn);
+
+private:
+    void worker_loop();
+    void drain();
+
+    int n_threads_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    uint64_t generation_ = 0;
+    int busy_ = 0;
+    bool stop_ = false;
+
+    const std::function<void(size_t)>* fn_ = nullptr;
+    size_t n_tasks_ = 0;
+    std::atomic<size_t> next_task_{0};
+};
+
+// Estado MSTEDARLS de todos os veículos numa arena contígua: mean/var/w/P ficam em
+// vetores n_vehicles x n_features (row-major) e o contador n em um vetor por veículo.
+// update(v, ...) produz exatamente a mesma saída que MSTEDARLS::update() do veículo v.
+class MSTEDARLSArena {
+public:
+    MSTEDARLSArena(size_t n_vehicles, int n_features, double threshold = 4.0,
+                   double rls_mu = 1.0, double rls_delta = 1000.0,
+                   double w_init = 0.0, bool correct_outlier = false);
+
+    size_t n_vehicles() const { return n_.size(); }
+    int n_features() const { return n_features_; }
+
+    void update(size_t v, const double* x_in, double* x_out, uint32_t& outlier_mask);
+
+private:
+    double threshold_;
+    double rls_mu_;
+    bool correct_outlier_;
+    int n_features_;
+
+    std::vector<double> n_;     // por veículo
+    std::vector<double> mean_;  // n_vehicles x n_features
+    std::vector<double> var_;
+    std::vector<double> w_;
+    std::vector<double> P_;
+};
+
+// Instâncias independentes de um modelo com run() no estilo do MPTEDARLS, copiadas de
+// um protótipo já configurado. Não é uma arena: só os objetos ficam lado a lado no
+// vetor, cada instância continua com os próprios buffers no heap (W, P, média, ...).
+// Estado contíguo por veículo só existe para o MSTEDARLS (MSTEDARLSArena).
+// Bit 0 da máscara = flag global de outlier.
+template <typename Model>
+class ModelSet {
+public:
+    ModelSet(size_t n_vehicles, int n_features, const Model& prototype)
+        : n_features_(n_features), models_(n_vehicles, prototype),
+          y_buf_(n_vehicles * n_features, 0.0) {}
+
+    size_t n_vehicles() const { return models_.size(); }
+    int n_features() const { return n_features_; }
+    Model& model(size_t v) { return models_[v]; }
+
+    void update(size_t v, const double* x_in, double* x_out, uint32_t& outlier_mask) {
+        int flag = models_[v].run(x_in, &y_buf_[v * n_features_], x_out);
+        outlier_mask = flag ? 1u : 0u;
+    }
+
+private:
+    int n_features_;
+    std::vector<Model> models_;
+    std::vector<double> y_buf_;  // predições por veículo (descartadas)
+};
+
+// Distribui registros intercalados de vários veículos entre as threads do pool.
+// Os veículos são agrupados em shards (vehicle_id % n_shards); cada shard é uma tarefa
+// processada por uma única thread, na ordem de chegada, o que preserva a ordem por
+// veículo. A saída do registro r vai para out[r * n_features] e masks[r].
+template <typename Arena>
+class DetectorPool {
+public:
+    DetectorPool(Arena arena, int n_threads = 0, size_t shards_per_thread = 8)
+        : arena_(std::move(arena)), pool_(n_threads)
+    {
+        size_t n_vehicles = arena_.n_vehicles();
+        n_shards_ = pool_.size() * shards_per_thread;
+        if (n_shards_ > n_vehicles) n_shards_ = n_vehicles;
+        if (n_shards_ == 0) n_shards_ = 1;
+        shard_begin_.assign(n_shards_ + 1, 0);
+    }
+
+    Arena& arena() { return arena_; }
+    int n_threads() const { return pool_.size(); }
+    size_t n_shards() const { return n_shards_; }
+
+    void process(const FleetRecord* records, size_t n_records,
+                 double* out, uint32_t* masks = nullptr)
+    {
+        const size_t n_vehicles = arena_.n_vehicles();
+        const int nf = arena_.n_features();
+
+        // particiona os índices por shard (ordenação por contagem, estável)
+        std::fill(shard_begin_.begin(), shard_begin_.end(), 0);
+        for (size_t r = 0; r < n_records; ++r) {
+            uint32_t v = records[r].vehicle_id;
+            if (v >= n_vehicles) throw std::out_of_range("DetectorPool: vehicle_id fora da faixa");
+            ++shard_begin_[v % n_shards_ + 1];
+        }
+        for (size_t s = 0; s < n_shards_; ++s) shard_begin_[s + 1] += shard_begin_[s];
+
+        order_.resize(n_records);
+        cursor_.assign(shard_begin_.begin(), shard_begin_.end() - 1);
+        for (size_t r = 0; r < n_records; ++r) {
+            order_[cursor_[records[r].vehicle_id % n_shards_]++] = r;
+        }
+
+        pool_.run(n_shards_, [&](size_t s) {
+            uint32_t mask = 0;
+            for (size_t j = shard_begin_[s]; j < shard_begin_[s + 1]; ++j) {
+                size_t r = order_[j];
+                arena_.update(records[r].vehicle_id, records[r].x, out + r * nf, mask);
+                if (masks) masks[r] = mask;
+            }
+        });
+    }
+
+private:
+    Arena arena_;
+    ThreadPool pool_;
+    size_t n_shards_;
+
+    // buffers de particionamento, reaproveitados entre chamadas
+    std::vector<size_t> shard_begin_;
+    std::vector<size_t> cursor_;
+    std::vector<size_t> order_;
+};
+
+#endif // DETECTOR_POOL_H
@@ -0,0 +1,184 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include "anomaly_injector.h"
+#include "csv_reader.h"
+#include "result_writer.h"
+
+// Para compilar: cmake -S . -B build && cmake --build build --target inject
+// Uso: ./inject [opções] -o saida.csv entrada.csv
+//      ./inject [opções] -o saida.csv --synthetic N_LINHAS --dims D
+//
+// Injeta anomalias (picos, derivas, travamentos e perdas de sinal) com semente fixa num
+// CSV limpo ou num fluxo sintético, em streaming, e grava no mesmo passo o gabarito:
+//   <col>...         sinal com anomalias
+//   label_<col>...   tipo da anomalia (0 normal, 1 pico, 2 deriva, 3 travamento, 4 perda)
+//   clean_<col>...   sinal limpo
+// É o formato lido por tedarls --metrics e por sweep. Saída .bin usa o formato colunar
+// de ResultWriter.
+
+static const char* USAGE =
+    "Uso: inject [opções] -o saida.csv|saida.bin [entrada.csv]\n"
+    "\n"
+    "Fonte (uma das duas):\n"
+    "  entrada.csv             CSV limpo\n"
+    "  --synthetic N --dims D  N linhas de D sinais sintéticos (nomes x0, x1, ...)\n"
+    "\n"
+    "  --columns a,b,...       colunas do CSV usadas (padrão: todas)\n"
+    "  --inject a,b,...        colunas que recebem anomalias (padrão: todas)\n"
+    "  --spike-rate R          início de pico por amostra e feature (padrão: 0.005)\n"
+    "  --drift-rate R          início de deriva (padrão: 0)\n"
+    "  --stuck-rate R          início de travamento (padrão: 0)\n"
+    "  --dropout-rate R        início de perda de sinal (padrão: 0)\n"
+    "  --spike-mag K           pico de +-K desvios-padrão (padrão: 6)\n"
+    "  --drift-slope K         deriva de K desvios-padrão por amostra (padrão: 0.2)\n"
+    "  --min-len N --max-len N duração de deriva/travamento/perda (padrão: 5..50)\n"
+    "  --dropout-value V       valor lido na perda de sinal (padrão: 0)\n"
+    "  --warmup N              amostras iniciais sem anomalia (padrão: 10)\n"
+    "  --seed S                semente (padrão: 1)\n";
+
+static double parse_double(const std::string& s, const std::string& opt) {
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    if (s.empty() || *end != '\0') throw std::invalid_argument("Valor inválido para " + opt + ": " + s);
+    return v;
+}
+
+static std::vector<std::string> split(const std::string& s) {
+    std::vector<std::string> out;
+    std::istringstream ss(s);
+    std::string token;
+    while (std::getline(ss, token, ',')) out.push_back(token);
+    return out;
+}
+
+int main(int argc, char** argv) {
+    AnomalyConfig config;
+    config.spike_rate = 0.005;
+    std::string input, output;
+    std::vector<std::string> columns, inject_columns;
+    size_t synthetic_rows = 0;
+    int dims = 0;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Falta valor para " + a);
+                return argv[++i];
+            };
+
+            if (a == "-h" || a == "--help") { std::cout << USAGE; return 0; }
+            else if (a == "-o") output = value();
+            else if (a == "--synthetic") synthetic_rows = (size_t)parse_double(value(), a);
+            else if (a == "--dims") dims = (int)parse_double(value(), a);
+            else if (a == "--columns") columns = split(value());
+            else if (a == "--inject") inject_columns = split(value());
+            else if (a == "--spike-rate") config.spike_rate = parse_double(value(), a);
+            else if (a == "--drift-rate") config.drift_rate = parse_double(value(), a);
+            else if (a == "--stuck-rate") config.stuck_rate = parse_double(value(), a);
+            else if (a == "--dropout-rate") config.dropout_rate = parse_double(value(), a);
+            else if (a == "--spike-mag") config.spike_magnitude = parse_double(value(), a);
+            else if (a == "--drift-slope") config.drift_slope = parse_double(value(), a);
+            else if (a == "--min-len") config.min_duration = (int)parse_double(value(), a);
+            else if (a == "--max-len") config.max_duration = (int)parse_double(value(), a);
+            else if (a == "--dropout-value") config.dropout_value = parse_double(value(), a);
+            else if (a == "--warmup") config.warmup = (int)parse_double(value(), a);
+            else if (a == "--seed") config.seed = (uint64_t)parse_double(value(), a);
+            else if (a.size() > 1 && a[0] == '-') throw std::invalid_argument("Opção desconhecida: " + a);
+            else input = a;
+        }
+        if (output.empty()) throw std::invalid_argument("Falta o arquivo de saída (-o).");
+        if (input.empty() == (synthetic_rows == 0)) throw std::invalid_argument("Use um CSV de entrada ou --synthetic.");
+        if (synthetic_rows > 0 && dims <= 0) throw std::invalid_argument("--synthetic exige --dims D > 0.");
+        if (config.min_duration < 1 || config.max_duration < config.min_duration)
+            throw std::invalid_argument("Durações inválidas (--min-len/--max-len).");
+    } catch (const std::exception& e) {
+        std::cerr << "Erro: " << e.what() << "\n\n" << USAGE;
+        return 1;
+    }
+
+    try {
+        CsvReader reader;
+        std::vector<std::string> names;
+        std::vector<int> cols;
+        if (!input.empty()) {
+            reader.open(input);
+            const std::vector<std::string>& header = reader.header();
+            if (columns.empty()) columns = header;
+            for (const auto& name : columns) {
+                int c = -1;
+                for (size_t i = 0; i < header.size(); ++i) if (header[i] == name) c = (int)i;
+                if (c < 0) throw std::runtime_error("Coluna " + name + " não encontrada em " + input);
+                cols.push_back(c);
+            }
+            names = columns;
+        } else {
+            for (int i = 0; i < dims; ++i) names.push_back("x" + std::to_string(i));
+        }
+        int n = (int)names.size();
+        if (n == 0) throw std::runtime_error("Nenhuma coluna de entrada.");
+
+        if (!inject_columns.empty()) {
+            config.feature_mask.assign(n, 0);
+            for (const auto& name : inject_columns) {
+                int c = -1;
+                for (int i = 0; i < n; ++i) if (names[i] == name) c = i;
+                if (c < 0) throw std::runtime_error("Coluna para injeção inválida: " + name);
+                config.feature_mask[c] = 1;
+            }
+        }
+
+        // sinal com anomalias (precisão de 10 dígitos), rótulos e sinal limpo
+        std::vector<ResultColumn> out_columns(3 * n);
+        for (int i = 0; i < n; ++i) {
+            out_columns[i].name = names[i];
+            out_columns[i].precision = 10;
+            out_columns[n + i].name = "label_" + names[i];
+            out_columns[n + i].type = ResultColumn::FLAG;
+            out_columns[2 * n + i].name = "clean_" + names[i];
+            out_columns[2 * n + i].precision = 10;
+        }
+        ResultWriter out(output, out_columns, ResultWriter::format_for(output));
+
+        AnomalyInjector injector(n, config);
+        SyntheticStream synthetic(n, config.seed);
+        std::vector<double> row(3 * n);
+        std::vector<uint8_t> labels(n);
+        size_t n_rows = 0, n_anomalies = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (;;) {
+            double* clean = &row[2 * n];
+            if (synthetic_rows > 0) {
+                if (n_rows == synthetic_rows) break;
+                synthetic.next(clean);
+            } else {
+                if (!reader.next()) break;
+                for (int i = 0; i < n; ++i) clean[i] = reader.row()[cols[i]];
+            }
+
+            for (int i = 0; i < n; ++i) row[i] = clean[i];
+            injector.apply(row.data(), labels.data());
+            for (int i = 0; i < n; ++i) {
+                row[n + i] = labels[i];
+                n_anomalies += labels[i] != ANOMALY_NONE;
+            }
+            out.append(row.data());
+            ++n_rows;
+        }
+        out.close();
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << n_rows << " linhas x " << n << " features, " << n_anomalies
+                  << " amostras anômalas -> " << output << " (" << seconds << " s)\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Erro: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,85 +1,44 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
-#include <iomanip>
 #include <cmath>
 #include <stdexcept>
-#include "mptedarls_cpp.cpp"
-
-// Para compilar: g++ -std=c++17 -o main_mptedarls main_mptedarls.cpp mptedarls_cpp.cpp
-
-std::vector<std::vector<double>> load_csv(const std::string& filename) {
-    std::ifstream file(filename);
-    std::vector<std::vector<double>> data;
-    std::string line;
-
-    if (!file.is_open()) throw std::runtime_error("Erro ao abrir arquivo: " + filename);
-    std::getline(file, line); // Ignora cabeçalho
-
-    while (std::getline(file, line)) {
-        std::vector<double> row;
-        std::istringstream ss(line);
-        std::string token;
-        while (std::getline(ss, token, ',')) {
-            try {
-                row.push_back(std::stod(token));
-            } catch (...) {
-                row.push_back(0.0);
-            }
-        }
-        if (!row.empty()) data.push_back(row);
+#include "mptedarls.h"
+#include "csv_reader.h"
+#include "result_writer.h"
+
+// Para compilar: g++ -std=c++17 -pthread -o main_mptedarls main_mptedarls.cpp csv_reader.cpp result_writer.cpp
+// Uso: ./main_mptedarls [entrada.csv] [saida.csv|saida.bin] [diff.csv|diff.bin]
+//
+// O CSV é lido em streaming (CsvReader) e cada linha vai direto para o modelo e para
+// os gravadores de saída (ResultWriter, com formatação em threads próprias): a memória
+// usada não depende do tamanho do arquivo. Saídas terminadas em .bin usam o formato
+// colunar binário.
+
+static std::vector<ResultColumn> make_columns(const std::vector<std::string>& names, bool fixed, int precision) {
+    std::vector<ResultColumn> columns(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        columns[i].name = names[i];
+        columns[i].fixed = fixed;
+        columns[i].precision = precision;
     }
-    return data;
+    return columns;
 }
 
-void salvar_csv(const std::string& filename,
-    const std::vector<std::vector<double>>& dados,
-    const std::vector<std::vector<double>>& y_preds) {
-
-    std::ofstream out(filename);
-    if (!out.is_open()) throw std::runtime_error("Erro ao criar: " + filename);
-    out << std::fixed << std::setprecision(16);
-
-    // Cabeçalho
-    out << "speed,rpm,tp,load,timing,"
-        << "y_speed,y_rpm,y_tp,y_load,y_timing\n";
+int main(int argc, char** argv) {
+    std::string input_file = argc > 1 ? argv[1] : "../../data/dados_sem_outliers_fastback.csv";
+    std::string output_file = argc > 2 ? argv[2] : "../../data/output_fastback_sem_outlier.csv";
+    std::string diff_file = argc > 3 ? argv[3] : "../../data/diff_fastback_sem_outlier.csv";
 
-    for (size_t i = 0; i < dados.size(); ++i) {
-        for (size_t j = 0; j < dados[i].size(); ++j)
-            out << dados[i][j] << (j + 1 < dados[i].size() ? "," : ",");
-
-        for (size_t j = 0; j < y_preds[i].size(); ++j)
-            out << y_preds[i][j] << (j + 1 < y_preds[i].size() ? "," : "");
-
-        out << "\n";
-    }
-}
-
-int main() {
     try {
-        auto X_original = load_csv("../../data/dados_sem_outliers_fastback.csv");
-
-        if (X_original.empty()) {
-            std::cerr << "Erro: arquivo de entrada vazio." << std::endl;
-            return 1;
-        }
-
-        int n_features = X_original[0].size();
-        int n_amostras = X_original.size();
+        CsvReader reader(input_file);
+        int n_features = reader.columns();
 
         // Normalização Min-Max
         std::vector<double> min_vals = { 0. ,  0. ,  0. , 0. , -36. };
         std::vector<double> max_vals = { 216.83813265, 6267.89629447,  265.92001187,  280.9220282,   127.99778524 };
-        std::vector<std::vector<double>> X_norm;
-
-        for (const auto& row : X_original) {
-            std::vector<double> norm_row(row.size());
-            for (size_t i = 0; i < row.size(); ++i) {
-                norm_row[i] = (row[i] - min_vals[i]) / (max_vals[i] - min_vals[i]);
-            }
-            X_norm.push_back(norm_row);
+        if (n_features != (int)min_vals.size()) {
+            throw std::runtime_error("Esperadas 5 colunas (speed, rpm, tp, load, timing).");
         }
 
         // Modelo com hiperparâmetros ajustados
@@ -103,40 +62,48 @@ int main() {
             false                       // verbose
         );
 
-        std::vector<std::vector<double>> X_corr, y_preds;
-
-        for (const auto& x : X_norm) {
-            auto result = model.run(x);
-            X_corr.push_back(result.x_filtered);
-            y_preds.push_back(result.y_pred);
-        }
-
-        // Desscalar
-        for (auto& row : X_corr) {
-            for (size_t i = 0; i < row.size(); ++i)
-                row[i] = row[i] * (max_vals[i] - min_vals[i]) + min_vals[i];
-        }
-
-        for (auto& row : y_preds) {
-            for (size_t i = 0; i < row.size(); ++i)
-                row[i] = row[i] * (max_vals[i] - min_vals[i]) + min_vals[i];
+        // Saída com 16 casas fixas; diferença para análise de erro posterior (ex: MAE)
+        // no formato padrão do ostream
+        ResultWriter out(output_file,
+                         make_columns({"speed", "rpm", "tp", "load", "timing",
+                                       "y_speed", "y_rpm", "y_tp", "y_load", "y_timing"}, true, 16),
+                         ResultWriter::format_for(output_file));
+        ResultWriter out_diff(diff_file,
+                              make_columns({"speed_diff", "rpm_diff", "tp_diff", "load_diff", "timing_diff"}, false, 6),
+                              ResultWriter::format_for(diff_file));
+
+        std::vector<double> x(n_features), y_pred(n_features), x_filtered(n_features);
+        std::vector<double> out_row(2 * n_features), diff_row(n_features);
+        size_t n_amostras = 0;
+        while (reader.next()) {
+            const double* row = reader.row();
+            for (int i = 0; i < n_features; ++i)
+                x[i] = (row[i] - min_vals[i]) / (max_vals[i] - min_vals[i]);
+
+            model.run(x.data(), y_pred.data(), x_filtered.data());
+
+            // Desscalar e gravar
+            for (int i = 0; i < n_features; ++i) {
+                double range = max_vals[i] - min_vals[i];
+                double x_corr = x_filtered[i] * range + min_vals[i];
+                out_row[i] = x_corr;
+                out_row[n_features + i] = y_pred[i] * range + min_vals[i];
+                diff_row[i] = std::abs(x_corr - row[i]);
+            }
+            out.append(out_row.data());
+            out_diff.append(diff_row.data());
+            ++n_amostras;
         }
 
-        salvar_csv("../../data/output_fastback_sem_outlier.csv", X_corr, y_preds);
-        std::cout << "Arquivo output_fastback_sem_outlier.csv salvo com sucesso.\n";
+        out.close();
+        out_diff.close();
 
-        // Diferença para análise de erro posterior (ex: MAE)
-        std::ofstream fout_diff("../../data/diff_fastback_sem_outlier.csv");
-        fout_diff << "speed_diff,rpm_diff,tp_diff,load_diff,timing_diff\n";
-        for (int i = 0; i < n_amostras; ++i) {
-            for (int d = 0; d < n_features; ++d) {
-                double diff = std::abs(X_corr[i][d] - X_original[i][d]);
-                fout_diff << diff;
-                if (d + 1 < n_features) fout_diff << ",";
-            }
-            fout_diff << "\n";
+        if (n_amostras == 0) {
+            std::cerr << "Erro: arquivo de entrada vazio." << std::endl;
+            return 1;
         }
-        std::cout << "Arquivo ../../data/diff_fastback_sem_outlier.csv salvo com sucesso.\n";
+        std::cout << "Arquivo " << output_file << " salvo com sucesso.\n";
+        std::cout << "Arquivo " << diff_file << " salvo com sucesso.\n";
 
     } catch (const std::exception& e) {
         std::cerr << "Erro: " << e.what() << std::endl;
@@ -144,4 +111,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
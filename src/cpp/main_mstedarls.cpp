@@ -1,61 +1,46 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
+#include <memory>
 #include "mstedarls.h"
+#include "csv_reader.h"
+#include "result_writer.h"
 
 // Para compilar:
-// g++ -std=c++17 main_mstedarls.cpp mstedarls.cpp -o mstedarls_wo
-
-int main() {
-    std::string input_file = "../../data/dados_sem_outliers_morsinaldo.csv";
-    std::string output_file = "../../data/output_morsinaldo_mstedarls.csv";
-    std::ifstream file(input_file);
-
-    if (!file.is_open()) {
-        std::cerr << "Erro ao abrir o arquivo: " << input_file << std::endl;
+// g++ -std=c++17 -pthread main_mstedarls.cpp mstedarls.cpp csv_reader.cpp result_writer.cpp -o mstedarls_wo
+// Com -march=native, -ffp-contract=off mantém o lote (escalar, comparação sem divisão)
+// idêntico bit a bit ao update() linha a linha:
+// g++ -std=c++17 -O3 -march=native -ffp-contract=off -pthread main_mstedarls.cpp mstedarls.cpp csv_reader.cpp result_writer.cpp -o mstedarls_wo
+// Uso: ./mstedarls_wo [entrada.csv] [saida.csv|saida.bin]
+// Saída terminada em .bin é gravada no formato colunar binário de ResultWriter.
+
+// Linhas por bloco: o CSV é lido em streaming e processado bloco a bloco, com memória
+// constante independente do tamanho do arquivo
+static const size_t CHUNK_ROWS = 4096;
+
+int main(int argc, char** argv) {
+    std::string input_file = argc > 1 ? argv[1] : "../../data/dados_sem_outliers_morsinaldo.csv";
+    std::string output_file = argc > 2 ? argv[2] : "../../data/output_morsinaldo_mstedarls.csv";
+
+    CsvReader reader;
+    try {
+        reader.open(input_file);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
         return 1;
     }
+    const std::vector<std::string>& column_names = reader.header();
 
-    std::vector<std::vector<double>> data;
-    std::vector<std::string> column_names;
-    std::string line;
-
-    // Leitura do cabeçalho
-    if (std::getline(file, line)) {
-        std::istringstream header_stream(line);
-        std::string col;
-        while (std::getline(header_stream, col, ',')) {
-            column_names.push_back(col);
-        }
-    }
-
-    // Leitura dos dados
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string token;
-        std::vector<double> values;
-
-        while (std::getline(iss, token, ',')) {
-            try {
-                values.push_back(std::stod(token));
-            } catch (...) {
-                values.push_back(0.0);
-            }
-        }
-
-        if (!values.empty()) data.push_back(values);
-    }
-
-    file.close();
-
-    if (data.empty()) {
+    if (column_names.empty()) {
         std::cerr << "Arquivo CSV vazio ou inválido." << std::endl;
         return 1;
     }
 
-    int n_features = data[0].size();
+    int n_features = column_names.size();
+    if (n_features > 32) {
+        std::cerr << "Máximo de 32 features (máscara de outliers)." << std::endl;
+        return 1;
+    }
 
     // Instanciador ajustado com os hiperparâmetros do trim-sweep-10
     MSTEDARLS mstedarls(
@@ -67,37 +52,77 @@ int main() {
         true      // correct_outlier
     );
 
-    // Criar o arquivo de saída
-    std::ofstream out_file(output_file);
-    if (!out_file.is_open()) {
-        std::cerr << "Erro ao criar arquivo de saída: " << output_file << std::endl;
-        return 1;
+    // Colunas de saída: valores corrigidos (formato padrão do ostream) e flags de outlier
+    std::vector<ResultColumn> out_columns;
+    for (const auto& col : column_names) {
+        ResultColumn c;
+        c.name = col + "_corrected";
+        out_columns.push_back(c);
     }
-
-    // Cabeçalho
     for (const auto& col : column_names) {
-        out_file << col << "_corrected,";
+        ResultColumn c;
+        c.name = "outlier_" + col;
+        c.type = ResultColumn::FLAG;
+        out_columns.push_back(c);
+    }
+
+    // A formatação e a escrita rodam numa thread própria, em paralelo ao processamento
+    std::unique_ptr<ResultWriter> writer;
+    try {
+        writer.reset(new ResultWriter(output_file, out_columns, ResultWriter::format_for(output_file)));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
-    for (size_t i = 0; i < column_names.size(); ++i) {
-        out_file << "outlier_" << column_names[i];
-        if (i != column_names.size() - 1) out_file << ",";
+
+    // Blocos colunares reaproveitados (feature-major) para o processamento em lote
+    std::vector<std::vector<double>> columns(n_features, std::vector<double>(CHUNK_ROWS));
+    std::vector<std::vector<double>> corrected(n_features, std::vector<double>(CHUNK_ROWS));
+    std::vector<uint32_t> masks(CHUNK_ROWS);
+    std::vector<const double*> in_ptrs(n_features);
+    std::vector<double*> out_ptrs(n_features);
+    for (int i = 0; i < n_features; ++i) {
+        in_ptrs[i] = columns[i].data();
+        out_ptrs[i] = corrected[i].data();
     }
-    out_file << "\n";
 
-    // Processamento
-    for (const auto& sample : data) {
-        auto [corrected, is_outlier] = mstedarls.update(sample);
+    std::vector<double> out_row(2 * n_features);
+    size_t n_rows = 0;
+    bool more = true;
+    while (more) {
+        size_t chunk = 0;
+        while (chunk < CHUNK_ROWS && (more = reader.next())) {
+            const double* row = reader.row();
+            for (int i = 0; i < n_features; ++i) columns[i][chunk] = row[i];
+            ++chunk;
+        }
+        if (chunk == 0) break;
+
+        // process_batch continua do estado atual: mesma saída do update() linha a linha
+        mstedarls.process_batch(in_ptrs.data(), chunk, out_ptrs.data(), masks.data());
 
-        for (double val : corrected)
-            out_file << val << ",";
-        for (size_t i = 0; i < is_outlier.size(); ++i) {
-            out_file << (is_outlier[i] ? "1" : "0");
-            if (i != is_outlier.size() - 1) out_file << ",";
+        for (size_t r = 0; r < chunk; ++r) {
+            for (int i = 0; i < n_features; ++i) {
+                out_row[i] = corrected[i][r];
+                out_row[n_features + i] = (masks[r] >> i) & 1u;
+            }
+            writer->append(out_row.data());
         }
-        out_file << "\n";
+        n_rows += chunk;
+    }
+
+    try {
+        writer->close();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (n_rows == 0) {
+        std::cerr << "Arquivo CSV vazio ou inválido." << std::endl;
+        return 1;
     }
 
-    out_file.close();
     std::cout << "Arquivo processado e salvo em: " << output_file << std::endl;
     return 0;
 }
\ No newline at end of file
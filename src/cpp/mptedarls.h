@@ -0,0 +1,838 @@
+#ifndef MPTEDARLS_H
+#define MPTEDARLS_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include <type_traits>
+#include "mptedarls_history.h"
+#include "mptedarls_trace.h"
+#include "tedarls_numeric.h"
+#include "tedarls_checkpoint.h"
+#include "teda_window.h"
+
+// Motor do RLS: Covariance guarda cada P_i explicitamente (padrão, referência);
+// SquareRoot guarda um fator S_i com P_i = S_i·S_iᵀ e aplica a atualização de Potter,
+// de modo que P_i continua simétrica e definida positiva por construção, inclusive
+// em float.
+enum class RlsBackend : uint8_t { Covariance = 0, SquareRoot = 1 };
+
+// MPTEDARLS: TEDA global ou por dimensão + n modelos RLS "leave-one-out".
+// Implementação única, só de cabeçalho, usada pelas ferramentas do host, pelos
+// benchmarks e pelo firmware (alvo CMake 'mptedarls').
+// Numérico: T = double (referência), float ou q16_16 (ver tedarls_numeric.h).
+// MPTEDARLS é o alias para double.
+template <typename T = double>
+class MPTEDARLSBasic {
+public:
+
+    // Resultado de run()
+    struct RunResult {
+        int outlier_flag;
+        std::vector<T> y_pred;
+        std::vector<T> x_filtered;
+    };
+
+    // Construtor: parâmetros originais do Python com valores default
+    MPTEDARLSBasic(
+        double threshold = 6.0,
+        int rls_n = 2,
+        double rls_mu = 0.9999,
+        double rls_delta = 0.1,
+        const std::vector<double>& w_init = {},
+        bool correct_outlier = true,
+        int window_size = 0,
+        int window_outlier_limit = 15,
+        bool use_per_dim_teda = false,
+        double ecc_div = 4.0,
+        double epsilon = 1e-6,
+        bool clip_output = true,
+        bool clip_weights = true,
+        std::pair<double, double> output_clip_range = {-100.0, 100.0},
+        std::pair<double, double> weight_clip_range = {-100.0, 100.0},
+        double max_dw = 5.0,
+        bool verbose = false)
+        : threshold(threshold),
+          rls_n(rls_n),
+          rls_mu(rls_mu),
+          rls_delta(rls_delta),
+          correct_outlier(correct_outlier),
+          window_size(window_size),
+          window_outlier_limit(window_outlier_limit),
+          use_per_dim_teda(use_per_dim_teda),
+          ecc_div(ecc_div),
+          epsilon(epsilon),
+          clip_output(clip_output),
+          clip_weights(clip_weights),
+          output_clip_range(output_clip_range),
+          weight_clip_range(weight_clip_range),
+          max_dw(max_dw),
+          verbose(verbose),
+          k(1),
+          consecutive_outliers(0),
+          history(rls_n)
+    {
+        // salvaguarda: epsilon representável no tipo numérico (ver tedarls_numeric.h)
+        this->epsilon = std::max(this->epsilon, tedarls_numeric<T>::min_epsilon());
+
+        mean.assign(rls_n, 0.0);
+        var.assign(rls_n, 0.0);
+
+        // buffers de trabalho, alocados uma única vez
+        int n = rls_n;
+        delta_buf.assign(n, 0.0);
+        y_raw.assign(n, 0.0);
+        PX_buf.assign(n * n, 0.0);
+        XP_buf.assign(n * n, 0.0);
+        G_buf.assign(n * n, 0.0);
+        dw_buf.assign(n, 0.0);
+        x_in_buf.assign(n, 0.0);
+        dim_mask.assign(n, 0);
+
+        initRLSEstimates(w_init);
+
+        // window_size > 0: TEDA sobre as últimas window_size amostras
+        if (window_size > 0) {
+            setTedaWindow(TedaWindow::Sliding, window_size);
+        }
+    }
+
+    /**
+     * Janela da estatística do TEDA (padrão: cumulativa, ver teda_window.h).
+     * Exponential: param = lambda em (0, 1), memória efetiva 1/(1 - lambda).
+     * Sliding: param = W >= 2 amostras (buffer circular de W x rls_n).
+     * Reinicia o TEDA; o RLS é mantido.
+     */
+    void setTedaWindow(TedaWindow mode, double param = 0.0) {
+        if (mode == TedaWindow::Exponential && !(param > 0.0 && param < 1.0)) {
+            throw std::invalid_argument("Fator de esquecimento deve estar em (0, 1).");
+        }
+        if (mode == TedaWindow::Sliding && !(param >= 2.0)) {
+            throw std::invalid_argument("Janela deslizante precisa de pelo menos 2 amostras.");
+        }
+
+        teda_window = mode;
+        forget = T(mode == TedaWindow::Exponential ? 1.0 - param : 0.0);
+        window_size = mode == TedaWindow::Sliding ? (int)param : 0;
+        window_buf.assign((size_t)window_size * rls_n, 0.0);
+        resetTeda();
+    }
+
+    TedaWindow getTedaWindow() const { return teda_window; }
+
+    // Inicializa W e P de acordo com w_init
+    void initRLSEstimates(const std::vector<double>& w_init) {
+        int n = rls_n;
+
+        // --- coeficientes RLS: linha i de W (n x n) com a diagonal zerada ---
+        W.assign(n * n, 0.0);
+        if (!w_init.empty() && (int)w_init.size() == n) {
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    if (j != i) W[i * n + j] = T(w_init[i]);
+                }
+            }
+        }
+
+        // --- matrizes P_i = (1/rls_delta) * I, com linha e coluna i zeradas ---
+        resetCovariance();
+    }
+
+    /// Redefine o estado do TEDA (média, variância e contador k)
+    void resetTeda() {
+        k = 1;
+        // média e variância zeradas em todas as dimensões
+        mean.assign(rls_n, 0.0);
+        var .assign(rls_n, 0.0);
+        // zera o contador de outliers consecutivos
+        consecutive_outliers = 0;
+        // esvazia a janela deslizante
+        window_head = 0;
+        window_count = 0;
+    }
+
+    /**
+     * Redefine o estado do RLS.
+     * @param W_init Vetores de coeficientes iniciais (um vetor de rls_n-1 pesos por dimensão,
+     *               na ordem das demais dimensões)
+     */
+    void resetRLS(const std::vector<std::vector<double>>& W_init) {
+        // Substitui W pelos coeficientes fornecidos
+        int n = rls_n;
+        for (int i = 0; i < n && i < (int)W_init.size(); ++i) {
+            for (int j = 0, col = 0; j < n - 1 && j < (int)W_init[i].size(); ++j, ++col) {
+                if (col == i) ++col;
+                W[i * n + col] = T(W_init[i][j]);
+            }
+        }
+
+        // Reconstrói P como (1/rls_delta) * I para cada dimensão
+        resetCovariance();
+    }
+
+    /// Reinicia apenas as covariâncias, mantendo os pesos atuais
+    void resetCovariance() {
+        int n = rls_n;
+        using std::sqrt;
+        // no motor SquareRoot, P guarda o fator S_i = sqrt(1/rls_delta)·I
+        T diag = T(1.0) / rls_delta;
+        if (rls_backend == RlsBackend::SquareRoot) diag = sqrt(diag);
+        P.assign(n * n * n, 0.0);
+        for (int i = 0; i < n; ++i) {
+            T* Pi = &P[i * n * n];
+            for (int j = 0; j < n; ++j) {
+                if (j != i) Pi[j * n + j] = diag;
+            }
+        }
+    }
+
+    /**
+     * Troca o motor do RLS preservando o estado: P_i é fatorada (Cholesky) ao passar
+     * para SquareRoot e reconstruída ao voltar. trace_max (só SquareRoot) limita o
+     * traço de P_i: acima dele o esquecimento é suspenso, o que evita o crescimento
+     * sem limite de P nas direções sem excitação; 0 = 1000 vezes o traço inicial
+     * (rls_n-1)/rls_delta.
+     */
+    void setRlsBackend(RlsBackend backend, double trace_max = 0.0) {
+        const int n = rls_n;
+        rls_trace_max = T(trace_max > 0.0 ? trace_max : 1000.0 * (n - 1) / tedarls_to_double(rls_delta));
+        if (backend == rls_backend) return;
+
+        for (int i = 0; i < n; ++i) {
+            T* Pi = &P[i * n * n];
+            if (backend == RlsBackend::SquareRoot) {
+                choleskyInPlace(Pi);
+            } else {
+                rootToCovariance(Pi, PX_buf.data());
+            }
+        }
+        rls_backend = backend;
+    }
+
+    RlsBackend getRlsBackend() const { return rls_backend; }
+
+    /// Covariância P_i (rls_n x rls_n, row-major) em double, nos dois motores
+    void getCovariance(int i, double* out) const {
+        const int n = rls_n;
+        const T* Pi = &P[i * n * n];
+        for (int r = 0; r < n; ++r) {
+            for (int c = 0; c < n; ++c) {
+                out[r * n + c] = tedarls_to_double(covarianceAt(Pi, r, c));
+            }
+        }
+    }
+
+    bool tedaOutlierGlobal(const std::vector<T>& x) {
+        return tedaOutlierGlobal(x.data());
+    }
+
+    bool tedaOutlierGlobal(const T* x) {
+        // 1) Calcula delta em relação à média anterior
+        std::vector<T>& delta = delta_buf;
+        for (int i = 0; i < rls_n; ++i) {
+            delta[i] = x[i] - mean[i];
+        }
+
+        // 2) Distância ao quadrado
+        T dist_sq = std::inner_product(delta.begin(), delta.end(), delta.begin(), T(0.0));
+
+        // 3) Atualiza média e variância global; kk = número (efetivo) de amostras.
+        //    Com janela, sigma2 é a variância total amostral da janela; o modo
+        //    cumulativo mantém o acumulador original
+        T kk, sigma2;
+        if (teda_window == TedaWindow::Exponential) {
+            // var[0]: variância total com esquecimento
+            T alpha = teda_exp_alpha(T(k), forget);
+            for (int i = 0; i < rls_n; ++i) {
+                mean[i] += alpha * delta[i];
+            }
+            var[0] = (T(1.0) - alpha) * (var[0] + alpha * dist_sq);
+            kk = T(1.0) / alpha;
+            sigma2 = (alpha < T(1.0) ? teda_exp_sigma2(var[0], alpha) : T(1e-8));
+        } else if (teda_window == TedaWindow::Sliding) {
+            // var[i]: M2 da dimensão i na janela; variância total = soma
+            windowPush(x);
+            kk = T(window_count);
+            T m2 = std::accumulate(var.begin(), var.end(), T(0.0));
+            sigma2 = (window_count > 1 ? m2 / T(window_count - 1) : T(1e-8));
+        } else {
+            for (int i = 0; i < rls_n; ++i) {
+                mean[i] += delta[i] / T(k);
+            }
+            // variância global em var[0]
+            if (k > 1) {
+                var[0] += dist_sq / T(k - 1);
+            }
+            kk = T(k);
+            sigma2 = (k > 1 ? var[0] / T(k - 1) : T(1e-8));
+        }
+
+        // 4) Calcula 'ecc_norm' e compara com limiar
+        T ecc      = (T(1.0) / kk) + dist_sq / (kk * std::max(sigma2, epsilon));
+        T ecc_norm = ecc / ecc_div;
+        T thresh   = (threshold * threshold + T(1.0)) / (T(2.0) * kk);
+
+        return ecc_norm > thresh;
+    }
+
+    /**
+     * Layout "leave-one-out" compartilhado: o modelo i usa a linha i de W (n x n) e a
+     * matriz P_i (n x n), com a dimensão i mascarada (W[i][i] = 0, linha e coluna i de
+     * P_i zeradas). Assim os n modelos trabalham sobre o mesmo x completo: as n
+     * predições são um único produto matriz–vetor W·x, e os n vetores P_i·x formam um
+     * único produto (n² x n)·x sobre P contíguo. A máscara se mantém sozinha: g_i[i],
+     * dw_i[i], (x_ᵀP_i)[i] são sempre zero.
+     */
+
+    /// y_raw ← W·x (predições sem clipping)
+    void rlsPredictRaw(const T* x) {
+        int n = rls_n;
+        for (int i = 0; i < n; ++i) {
+            const T* Wi = &W[i * n];
+            y_raw[i] = std::inner_product(Wi, Wi + n, x, T(0.0));
+        }
+    }
+
+    /// Predições de todos os modelos em y (rls_n valores), com clipping de saída
+    void rlsPredictAll(const T* x, T* y) {
+        rlsPredictRaw(x);
+
+        for (int i = 0; i < rls_n; ++i) {
+            T yi = y_raw[i];
+
+            // clipping de saída, se requerido
+            if (clip_output) {
+                yi = std::max(output_clip_range.first,
+                              std::min(yi, output_clip_range.second));
+            }
+            y[i] = yi;
+        }
+    }
+
+    /// Versão C++ de _rls_predict_all(self, x)
+    std::vector<T> rlsPredictAll(const std::vector<T>& x) {
+        std::vector<T> y(rls_n);
+        rlsPredictAll(x.data(), y.data());
+        return y;
+    }
+
+    /// Versão C++ de _rls_update_all(self, d, x)
+    void rlsUpdateAll(const std::vector<T>& d, const std::vector<T>& x) {
+        rlsPredictRaw(x.data());
+        rlsUpdateFromRaw(d.data(), x.data());
+    }
+
+private:
+    /**
+     * Atualização dos n modelos, reaproveitando y_raw = W·x já calculado para este x.
+     * P_i é atualizado in-place pela atualização de posto 1
+     *   P_i ← (1/rls_mu)·[P_i – g_i·(P_iᵀ x)ᵀ],
+     * equivalente a (1/rls_mu)·[P_i – (g_i ⊗ x)·P_i] sem matriz temporária.
+     */
+    void rlsUpdateFromRaw(const T* d, const T* x) {
+        if (rls_backend == RlsBackend::SquareRoot) {
+            rlsUpdateSqrt(d, x);
+            return;
+        }
+
+        const int n = rls_n;
+        const int nn = n * n;
+        const T* xv = x;
+        T* PX = PX_buf.data();
+        T* XP = XP_buf.data();
+        T* G  = G_buf.data();
+        T* dw = dw_buf.data();
+
+        // PX[i] = P_i·x para todos os modelos: P visto como matriz (n² x n)
+        for (int row = 0; row < nn; ++row) {
+            const T* Pr = &P[row * n];
+            T sum = T(0.0);
+            for (int c = 0; c < n; ++c) {
+                sum += Pr[c] * xv[c];
+            }
+            PX[row] = sum;
+        }
+
+        // XP[i] = xᵀ·P_i (percorre P por linhas, acesso contíguo)
+        std::fill(XP, XP + nn, T(0.0));
+        for (int i = 0; i < n; ++i) {
+            const T* Pi = &P[i * nn];
+            T* XPi = XP + i * n;
+            for (int m = 0; m < n; ++m) {
+                const T* Pm = Pi + m * n;
+                T xm = xv[m];
+                for (int c = 0; c < n; ++c) {
+                    XPi[c] += xm * Pm[c];
+                }
+            }
+        }
+
+        // ganhos g_i = P_i·x / max(rls_mu + xᵀP_i x, epsilon)
+        for (int i = 0; i < n; ++i) {
+            const T* PXi = PX + i * n;
+            T denom = rls_mu + std::inner_product(xv, xv + n, PXi, T(0.0));
+            denom = std::max(denom, epsilon);
+            T* Gi = G + i * n;
+            for (int j = 0; j < n; ++j) {
+                Gi[j] = PXi[j] / denom;
+            }
+        }
+
+        const T inv_mu = T(1.0) / rls_mu;
+        for (int i = 0; i < n; ++i) {
+            const T* Gi = G + i * n;
+            const T* XPi = XP + i * n;
+            T* Wi = &W[i * n];
+            T* Pi = &P[i * nn];
+
+            // erro de predição e atualização incremental dos pesos
+            T ei = d[i] - y_raw[i];
+            for (int j = 0; j < n; ++j) {
+                dw[j] = Gi[j] * ei;
+            }
+
+            // atualização de posto 1 in-place
+            for (int r = 0; r < n; ++r) {
+                T* Pr = Pi + r * n;
+                T gr = Gi[r];
+                for (int c = 0; c < n; ++c) {
+                    Pr[c] = inv_mu * (Pr[c] - gr * XPi[c]);
+                }
+            }
+
+            applyWeightStep(Wi, dw);
+        }
+    }
+
+    /**
+     * Motor SquareRoot (Potter, com esquecimento): com f = S_iᵀx e α = rls_mu + fᵀf,
+     *   g_i = S_i f / α,   S_i ← (S_i − β·(S_i f)·fᵀ) / sqrt(rls_mu),   β = 1/(α + sqrt(rls_mu·α)),
+     * que reproduz P_i ← (P_i − P_i x xᵀ P_i / α) / rls_mu sem formar P_i. α ≥ rls_mu > 0,
+     * então não há divisão protegida por epsilon; a máscara (linha/coluna i de S_i
+     * nulas) se mantém sozinha.
+     */
+    void rlsUpdateSqrt(const T* d, const T* x) {
+        using std::sqrt;
+        const int n = rls_n;
+        const int nn = n * n;
+        T* f  = XP_buf.data();
+        T* Sf = PX_buf.data();
+        T* dw = dw_buf.data();
+        const T sqrt_mu = sqrt(rls_mu);
+        const T inv_sqrt_mu = T(1.0) / sqrt_mu;
+
+        for (int i = 0; i < n; ++i) {
+            T* Si = &P[i * nn];
+
+            // f = S_iᵀ·x (percorre S_i por linhas)
+            std::fill(f, f + n, T(0.0));
+            for (int r = 0; r < n; ++r) {
+                const T* Sr = Si + r * n;
+                T xr = x[r];
+                for (int c = 0; c < n; ++c) f[c] += xr * Sr[c];
+            }
+            T alpha = rls_mu + std::inner_product(f, f + n, f, T(0.0));
+
+            // S_i·f = P_i·x
+            for (int r = 0; r < n; ++r) {
+                Sf[r] = std::inner_product(Si + r * n, Si + (r + 1) * n, f, T(0.0));
+            }
+
+            T ei = d[i] - y_raw[i];
+            T gain = ei / alpha;
+            for (int j = 0; j < n; ++j) dw[j] = Sf[j] * gain;
+
+            // S_i ← S_i − β·(S_i f)·fᵀ; esquecimento só enquanto traço(P_i)/rls_mu ≤ trace_max
+            T beta = T(1.0) / (alpha + sqrt_mu * sqrt(alpha));
+            T trace = T(0.0);
+            for (int r = 0; r < n; ++r) {
+                T* Sr = Si + r * n;
+                T br = beta * Sf[r];
+                for (int c = 0; c < n; ++c) {
+                    Sr[c] -= br * f[c];
+                    trace += Sr[c] * Sr[c];
+                }
+            }
+            if (trace <= rls_trace_max * rls_mu) {
+                for (int j = 0; j < nn; ++j) Si[j] *= inv_sqrt_mu;
+            }
+
+            applyWeightStep(&W[i * n], dw);
+        }
+    }
+
+    /// Limita ‖dw‖ a max_dw e aplica nos pesos W_i (com clipping, se ativo)
+    void applyWeightStep(T* Wi, T* dw) {
+        const int n = rls_n;
+        using std::sqrt;
+        T dw_norm = sqrt(std::inner_product(dw, dw + n, dw, T(0.0)));
+        if (dw_norm > max_dw) {
+            T scale = max_dw / dw_norm;
+            for (int j = 0; j < n; ++j) dw[j] *= scale;
+        }
+
+        for (int j = 0; j < n; ++j) {
+            Wi[j] += dw[j];
+            if (clip_weights) {
+                Wi[j] = std::max(weight_clip_range.first,
+                                 std::min(Wi[j], weight_clip_range.second));
+            }
+        }
+    }
+
+    /// Elemento (r, c) de P_i a partir do que está guardado (P_i ou S_i)
+    T covarianceAt(const T* Pi, int r, int c) const {
+        const int n = rls_n;
+        if (rls_backend == RlsBackend::Covariance) return Pi[r * n + c];
+        return std::inner_product(Pi + r * n, Pi + (r + 1) * n, Pi + c * n, T(0.0));
+    }
+
+    /// A ← L com A = L·Lᵀ (L triangular inferior). Pivôs não positivos (dimensão
+    /// mascarada ou perda de definição positiva) zeram a coluna correspondente.
+    void choleskyInPlace(T* A) {
+        using std::sqrt;
+        const int n = rls_n;
+        for (int j = 0; j < n; ++j) {
+            T pivot = A[j * n + j];
+            for (int m = 0; m < j; ++m) pivot -= A[j * n + m] * A[j * n + m];
+            T ljj = pivot > T(0.0) ? sqrt(pivot) : T(0.0);
+            A[j * n + j] = ljj;
+            for (int r = j + 1; r < n; ++r) {
+                T v = A[r * n + j];
+                for (int m = 0; m < j; ++m) v -= A[r * n + m] * A[j * n + m];
+                A[r * n + j] = ljj > T(0.0) ? v / ljj : T(0.0);
+            }
+            for (int c = j + 1; c < n; ++c) A[j * n + c] = T(0.0);
+        }
+    }
+
+    /// A ← A·Aᵀ in-place; tmp com rls_n² posições
+    void rootToCovariance(T* A, T* tmp) {
+        const int n = rls_n;
+        for (int r = 0; r < n; ++r) {
+            for (int c = 0; c < n; ++c) {
+                tmp[r * n + c] = std::inner_product(A + r * n, A + (r + 1) * n, A + c * n, T(0.0));
+            }
+        }
+        std::copy(tmp, tmp + n * n, A);
+    }
+
+public:
+    std::vector<bool> tedaOutlierPerDim(const std::vector<T>& x) {
+        tedaOutlierPerDim(x.data(), dim_mask.data());
+        return std::vector<bool>(dim_mask.begin(), dim_mask.end());
+    }
+
+    /// Máscara por dimensão em outlier_mask (rls_n valores 0/1); retorna se houve algum
+    bool tedaOutlierPerDim(const T* x, uint8_t* outlier_mask) {
+        std::fill(outlier_mask, outlier_mask + rls_n, uint8_t(0));
+        bool any = false;
+
+        // número (efetivo) de amostras da estatística
+        T alpha = T(0.0), kk = T(k);
+        if (teda_window == TedaWindow::Exponential) {
+            alpha = teda_exp_alpha(T(k), forget);
+            kk = T(1.0) / alpha;
+        } else if (teda_window == TedaWindow::Sliding) {
+            windowPush(x);
+            kk = T(window_count);
+        }
+
+        for (int i = 0; i < rls_n; ++i) {
+            // Atualiza média e var por dimensão
+            T sigma2;
+            if (teda_window == TedaWindow::Exponential) {
+                teda_exp_update(x[i], alpha, mean[i], var[i]);
+                if (kk < T(2.0)) continue;
+                sigma2 = teda_exp_sigma2(var[i], alpha);
+            } else if (teda_window == TedaWindow::Sliding) {
+                if (window_count < 2) continue;
+                sigma2 = var[i] / T(window_count - 1);
+            } else {
+                T delta = x[i] - mean[i];
+                mean[i] += delta / T(k);
+                var[i] += delta * (x[i] - mean[i]);
+
+                // Só detecta outlier se houver amostras suficientes
+                if (k < 2) continue;
+                sigma2 = var[i] / T(k - 1);
+            }
+            if (sigma2 < epsilon) continue;
+
+            // Distância normalizada
+            T d2       = (x[i] - mean[i]) * (x[i] - mean[i]) / sigma2;
+            T ecc      = (T(1.0) / kk) + d2 / kk;
+            T ecc_norm = ecc / ecc_div;
+            T thresh   = (threshold * threshold + T(1.0)) / (T(2.0) * kk);
+
+            if (ecc_norm > thresh) {
+                outlier_mask[i] = 1;
+                any = true;
+            }
+        }
+        return any;
+    }
+
+    RunResult run(const std::vector<T>& x) {
+        if ((int)x.size() != rls_n) {
+            throw std::invalid_argument("Dimensão de entrada incompatível.");
+        }
+
+        RunResult result;
+        result.y_pred.resize(rls_n);
+        result.x_filtered.resize(rls_n);
+        result.outlier_flag = run(x.data(), result.y_pred.data(), result.x_filtered.data());
+        return result;
+    }
+
+    /**
+     * Versão sem alocação de run(): x, y_pred e x_filtered com rls_n valores
+     * (x_filtered pode ser o próprio x). Retorna outlier_flag.
+     */
+    int run(const T* x, T* y_pred, T* x_filtered) {
+        int outlier_flag;
+        uint8_t* mask = dim_mask.data();
+
+        if (k == 1) {
+            // primeira amostra
+            std::copy(x, x + rls_n, mean.begin());
+            var.assign(rls_n, 0.0);
+            if (teda_window == TedaWindow::Sliding) {
+                window_count = 0;
+                windowPush(x);
+            }
+            outlier_flag = 0;
+            rlsPredictAll(x, y_pred);
+            std::copy(x, x + rls_n, x_filtered);
+        } else {
+            // detecção de outlier
+            if (use_per_dim_teda) {
+                outlier_flag = tedaOutlierPerDim(x, mask) ? 1 : 0;
+            } else {
+                outlier_flag = tedaOutlierGlobal(x) ? 1 : 0;
+            }
+            // contador de outliers consecutivos
+            if (outlier_flag) ++consecutive_outliers; else consecutive_outliers = 0;
+            // reset se exceder
+            if (window_outlier_limit > 0 && consecutive_outliers >= window_outlier_limit) {
+                if (verbose) std::cout << "Reset automático em k=" << k << " por excesso de outliers consecutivos\n";
+                resetTeda();
+                resetCovariance();
+                consecutive_outliers = 0;
+            }
+            // predição e correção
+            rlsPredictAll(x, y_pred);
+            // x é lido pela atualização do RLS: com x_filtered == x, a entrada vai para x_in
+            const T* x_in = x;
+            if (x_filtered == x) {
+                std::copy(x, x + rls_n, x_in_buf.begin());
+                x_in = x_in_buf.data();
+            }
+            if (outlier_flag && correct_outlier && use_per_dim_teda) {
+                for (int i = 0; i < rls_n; ++i) {
+                    x_filtered[i] = mask[i] ? y_pred[i] : x_in[i];
+                }
+            } else {
+                const T* src = (outlier_flag && correct_outlier) ? y_pred : x_in;
+                std::copy(src, src + rls_n, x_filtered);
+            }
+            // atualização RLS (W·x já calculado em rlsPredictAll)
+            rlsUpdateFromRaw(x_filtered, x_in);
+            x = x_in;
+        }
+        // histórico conforme a política configurada (padrão: nenhum)
+        if (history.policy() != HistoryPolicy::None) {
+            history.record(k, outlier_flag, asDouble(y_pred, 0), asDouble(x_filtered, 1));
+        }
+
+        ++k;
+
+        // trace de depuração (só existe com -DMPTEDARLS_TRACE)
+        MPTEDARLS_TRACE_RECORD(trace, k, rls_n, asDouble(x, 0), asDouble(mean.data(), 1), tedarls_to_double(var[0]),
+                               outlier_flag, asDouble(y_pred, 2), asDouble(x_filtered, 3));
+
+        return outlier_flag;
+    }
+
+    /// Retenção do histórico: nenhuma (padrão), últimas N amostras ou callback
+    void setHistoryNone() { history.setNone(); }
+    void setHistoryRing(size_t capacity) { history.setRing(capacity); }
+    void setHistorySink(HistorySink sink, void* ctx = nullptr) { history.setSink(sink, ctx); }
+
+    /// Visão somente leitura do histórico retido (modo Ring)
+    const MPTEDARLSHistory& getHistory() const { return history; }
+
+    /**
+     * Checkpoint binário do estado aprendido ("MPTD", ver tedarls_checkpoint.h):
+     * k, outliers consecutivos, média/variância do TEDA, W e P. As posições mascaradas
+     * (diagonal de W, linha/coluna i de P_i) são sempre zero e não são gravadas:
+     * para rls_n = 5 em double são 900 bytes. O snapshot guarda sempre P_i, qualquer
+     * que seja o motor do RLS. As amostras da janela deslizante não são
+     * gravadas: nesse modo o TEDA recomeça vazio após deserialize().
+     */
+    size_t serializedSize() const {
+        size_t n = rls_n;
+        size_t values = 2 * n + n * (n - 1) + n * (n - 1) * (n - 1);
+        return TEDARLS_CKPT_HEADER + 2 * sizeof(int32_t) + values * sizeof(T) + TEDARLS_CKPT_TRAILER;
+    }
+
+    /// Escreve serializedSize() bytes em buf e retorna esse tamanho
+    size_t serialize(uint8_t* buf) const {
+        const int n = rls_n;
+        CheckpointWriter w(buf);
+        w.begin("MPTD", tedarls_type_tag<T>::value, uint16_t(n));
+        w.put(int32_t(k));
+        w.put(int32_t(consecutive_outliers));
+        for (int i = 0; i < n; ++i) w.put(mean[i]);
+        for (int i = 0; i < n; ++i) w.put(var[i]);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                if (j != i) w.put(W[i * n + j]);
+            }
+        }
+        for (int i = 0; i < n; ++i) {
+            const T* Pi = &P[i * n * n];
+            for (int r = 0; r < n; ++r) {
+                for (int c = 0; c < n; ++c) {
+                    if (r != i && c != i) w.put(covarianceAt(Pi, r, c));
+                }
+            }
+        }
+        return w.finish();
+    }
+
+    /// Restaura o estado; retorna false (sem alterar o modelo) se o snapshot for inválido
+    bool deserialize(const uint8_t* buf, size_t len) {
+        const int n = rls_n;
+        CheckpointReader r(buf, len);
+        if (!r.check("MPTD", tedarls_type_tag<T>::value, uint16_t(n), serializedSize())) {
+            return false;
+        }
+
+        k = r.get<int32_t>();
+        consecutive_outliers = r.get<int32_t>();
+        for (int i = 0; i < n; ++i) mean[i] = r.get<T>();
+        for (int i = 0; i < n; ++i) var[i] = r.get<T>();
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                W[i * n + j] = (j != i) ? r.get<T>() : T(0.0);
+            }
+        }
+        for (int i = 0; i < n; ++i) {
+            for (int row = 0; row < n; ++row) {
+                for (int c = 0; c < n; ++c) {
+                    P[(i * n + row) * n + c] = (row != i && c != i) ? r.get<T>() : T(0.0);
+                }
+            }
+            if (rls_backend == RlsBackend::SquareRoot) choleskyInPlace(&P[i * n * n]);
+        }
+        if (teda_window == TedaWindow::Sliding) {
+            resetTeda();
+        }
+        return true;
+    }
+
+#ifdef MPTEDARLS_TRACE
+    /// Destino do trace desta instância (nullptr desliga); não assume a posse
+    void setTrace(MPTEDARLSTrace* t) { trace = t; }
+#endif
+
+private:
+    /// Janela deslizante: substitui a amostra mais antiga (janela cheia) por x e
+    /// atualiza mean e var (M2 por dimensão) com Welford de inclusão/remoção
+    void windowPush(const T* x) {
+        const int n = rls_n;
+        T* slot = &window_buf[(size_t)window_head * n];
+        if (window_count == window_size) {
+            --window_count;
+            for (int i = 0; i < n; ++i) {
+                teda_welford_remove(slot[i], T(window_count), mean[i], var[i]);
+            }
+        }
+        ++window_count;
+        for (int i = 0; i < n; ++i) {
+            slot[i] = x[i];
+            teda_welford_add(x[i], T(window_count), mean[i], var[i]);
+        }
+        window_head = (window_head + 1) % window_size;
+    }
+
+    /// Vetor de rls_n valores como double* para histórico/trace; fora de double converte
+    /// no buffer 'slot'
+    const double* asDouble(const T* v, int slot) {
+        if constexpr (std::is_same<T, double>::value) {
+            return v;
+        } else {
+            std::vector<double>& out = conv_buf[slot];
+            out.resize(rls_n);
+            for (int i = 0; i < rls_n; ++i) out[i] = tedarls_to_double(v[i]);
+            return out.data();
+        }
+    }
+
+    // parâmetros
+    T threshold;
+    int rls_n;
+    T rls_mu;
+    T rls_delta;
+    bool correct_outlier;
+    int window_size;
+    int window_outlier_limit;
+    bool use_per_dim_teda;
+    T ecc_div;
+    T epsilon;
+    bool clip_output;
+    bool clip_weights;
+    std::pair<T,T> output_clip_range;
+    std::pair<T,T> weight_clip_range;
+    T max_dw;
+    bool verbose;
+
+    // estado interno
+    int k = 1;
+    int consecutive_outliers = 0;
+    std::vector<T> mean;
+    std::vector<T> var;
+    std::vector<T> W;   // rls_n x rls_n, row-major, diagonal mascarada
+    std::vector<T> P;   // rls_n matrizes rls_n x rls_n, row-major, contíguas (S_i no SquareRoot)
+    RlsBackend rls_backend = RlsBackend::Covariance;
+    T rls_trace_max = T(0.0);  // só SquareRoot (ver setRlsBackend)
+
+    // janela do TEDA
+    TedaWindow teda_window = TedaWindow::Cumulative;
+    T forget = T(0.0);           // 1 - lambda (Exponential)
+    std::vector<T> window_buf;   // window_size amostras de rls_n valores, circular (Sliding)
+    int window_head = 0;
+    int window_count = 0;
+
+    // buffers de trabalho (evitam alocação por amostra)
+    std::vector<T> delta_buf;
+    std::vector<T> y_raw;    // W·x da última predição
+    std::vector<T> PX_buf;   // P_i·x de todos os modelos
+    std::vector<T> XP_buf;   // xᵀ·P_i de todos os modelos
+    std::vector<T> G_buf;    // ganhos g_i
+    std::vector<T> dw_buf;
+    std::vector<T> x_in_buf;       // cópia de x quando x_filtered == x
+    std::vector<uint8_t> dim_mask; // máscara do TEDA por dimensão
+
+    std::vector<double> conv_buf[4];  // conversões para double (só T != double)
+
+    // histórico
+    MPTEDARLSHistory history;
+
+#ifdef MPTEDARLS_TRACE
+    MPTEDARLSTrace* trace = nullptr;
+#endif
+
+};
+
+typedef MPTEDARLSBasic<double> MPTEDARLS;
+
+#endif // MPTEDARLS_H
@@ -0,0 +1,117 @@
+#ifndef MPTEDARLS_HISTORY_H
+#define MPTEDARLS_HISTORY_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// Política de retenção do histórico (flags, predições e dados filtrados) do MPTEDARLS.
+//   None: nada é guardado (padrão)
+//   Ring: guarda as últimas N amostras em buffer circular de tamanho fixo
+//   Sink: repassa cada amostra a um callback, sem guardar nada
+enum class HistoryPolicy { None, Ring, Sink };
+
+// Callback do modo Sink. y_pred e x_filtered têm n elementos e só valem durante a chamada.
+typedef void (*HistorySink)(void* ctx, long k, int outlier_flag,
+                            const double* y_pred, const double* x_filtered, int n);
+
+class MPTEDARLSHistory {
+public:
+    explicit MPTEDARLSHistory(int n_dims = 0) : n_(n_dims) {}
+
+    void setNone() {
+        policy_ = HistoryPolicy::None;
+        release();
+    }
+
+    // Aloca o buffer uma única vez; capacity == 0 equivale a None
+    void setRing(std::size_t capacity) {
+        release();
+        if (capacity == 0) {
+            policy_ = HistoryPolicy::None;
+            return;
+        }
+        policy_ = HistoryPolicy::Ring;
+        capacity_ = capacity;
+        flags_.assign(capacity, 0);
+        y_pred_.assign(capacity * n_, 0.0);
+        x_filtered_.assign(capacity * n_, 0.0);
+    }
+
+    void setSink(HistorySink sink, void* ctx = nullptr) {
+        release();
+        if (!sink) {
+            policy_ = HistoryPolicy::None;
+            return;
+        }
+        policy_ = HistoryPolicy::Sink;
+        sink_ = sink;
+        sink_ctx_ = ctx;
+    }
+
+    HistoryPolicy policy() const { return policy_; }
+
+    // Registra uma amostra segundo a política atual (sem alocação)
+    void record(long k, int outlier_flag, const double* y_pred, const double* x_filtered) {
+        if (policy_ == HistoryPolicy::None) return;
+        if (policy_ == HistoryPolicy::Sink) {
+            sink_(sink_ctx_, k, outlier_flag, y_pred, x_filtered, n_);
+            return;
+        }
+
+        std::size_t slot = (start_ + count_) % capacity_;
+        if (count_ == capacity_) {
+            start_ = (start_ + 1) % capacity_;  // sobrescreve a mais antiga
+        } else {
+            ++count_;
+        }
+        flags_[slot] = outlier_flag;
+        std::copy(y_pred, y_pred + n_, &y_pred_[slot * n_]);
+        std::copy(x_filtered, x_filtered + n_, &x_filtered_[slot * n_]);
+    }
+
+    void clear() {
+        start_ = 0;
+        count_ = 0;
+    }
+
+    // --- Acesso (apenas no modo Ring). i = 0 é a amostra mais antiga retida ---
+    std::size_t size() const { return count_; }
+    std::size_t capacity() const { return capacity_; }
+    int dims() const { return n_; }
+
+    int outlierFlag(std::size_t i) const { return flags_[slot(i)]; }
+    // Ponteiros para n valores contíguos; válidos até o próximo record()
+    const double* prediction(std::size_t i) const { return &y_pred_[slot(i) * n_]; }
+    const double* filtered(std::size_t i) const { return &x_filtered_[slot(i) * n_]; }
+
+private:
+    std::size_t slot(std::size_t i) const { return (start_ + i) % capacity_; }
+
+    void release() {
+        clear();
+        capacity_ = 0;
+        std::vector<int>().swap(flags_);
+        std::vector<double>().swap(y_pred_);
+        std::vector<double>().swap(x_filtered_);
+        sink_ = nullptr;
+        sink_ctx_ = nullptr;
+    }
+
+    int n_;
+    HistoryPolicy policy_ = HistoryPolicy::None;
+
+    // modo Ring
+    std::size_t capacity_ = 0;
+    std::size_t start_ = 0;
+    std::size_t count_ = 0;
+    std::vector<int> flags_;
+    std::vector<double> y_pred_;      // capacity x n, row-major
+    std::vector<double> x_filtered_;  // capacity x n, row-major
+
+    // modo Sink
+    HistorySink sink_ = nullptr;
+    void* sink_ctx_ = nullptr;
+};
+
+#endif // MPTEDARLS_HISTORY_H
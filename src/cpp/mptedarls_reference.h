@@ -1,3 +1,10 @@
+#ifndef MPTEDARLS_REFERENCE_H
+#define MPTEDARLS_REFERENCE_H
+
+// MPTEDARLS anterior à atualização de posto 1 (P_i em vector<vector>, produto
+// temporário O(n³) por modelo), mantido só como referência para test_rls_update.
+// Igual à implementação original, sem o histórico e sem o log de depuração.
+
 #include <vector>
 #include <map>
 #include <string>
@@ -5,9 +12,9 @@
 #include <numeric>
 #include <stdexcept>
 #include <iostream>
-#include <fstream>
+#include <cmath>
 
-class MPTEDARLS {
+class MPTEDARLSReference {
 public:
 
     // Resultado de run()
@@ -18,7 +25,7 @@ public:
     };
 
     // Construtor: parâmetros originais do Python com valores default
-    MPTEDARLS(
+    MPTEDARLSReference(
         double threshold = 6.0,
         int rls_n = 2,
         double rls_mu = 0.9999,
@@ -315,49 +322,7 @@ public:
             // atualização RLS
             rlsUpdateAll(x_filtered, x);
         }
-        // armazena histórico
-        outlier_flags.push_back(outlier_flag);
-        predictions.push_back(y_pred);
-        filtered_data.push_back(x_filtered);
-        // debug_log opcional (não implementado aqui)
-
         ++k;
-
-        // ========================
-        // DEBUG LOG (linha CSV)
-        // ========================
-        static std::ofstream debug_file("debug_log_cpp.csv");
-        debug_file << std::fixed << std::setprecision(16);
-        if (k == 2) {
-            debug_file << "k";
-            for (int i = 0; i < rls_n; ++i) debug_file << ",x" << i;
-            for (int i = 0; i < rls_n; ++i) debug_file << ",mean" << i;
-            debug_file << ",var_global,outlier_flag";
-            for (int i = 0; i < rls_n; ++i) debug_file << ",y_pred" << i;
-            for (int i = 0; i < rls_n; ++i) debug_file << ",x_corr" << i;
-            debug_file << "\n";
-        }
-
-        // x normalizado
-        debug_file << k;
-        for (int i = 0; i < rls_n; ++i) debug_file << "," << x[i];
-
-        // média atual
-        for (int i = 0; i < rls_n; ++i) debug_file << "," << mean[i];
-
-        // variância global
-        debug_file << "," << var[0];
-
-        // flag de outlier
-        debug_file << "," << outlier_flag;
-
-        // predições
-        for (int i = 0; i < rls_n; ++i) debug_file << "," << y_pred[i];
-
-        // correção aplicada
-        for (int i = 0; i < rls_n; ++i) debug_file << "," << x_filtered[i];
-
-        debug_file << "\n";
         return {outlier_flag, y_pred, x_filtered};
     }
 
@@ -387,10 +352,6 @@ private:
     std::vector<double> var;
     std::vector<std::vector<double>> W;
     std::vector<std::vector<std::vector<double>>> P;
+};
 
-    // histórico
-    std::vector<int>                            outlier_flags;
-    std::vector<std::vector<double>>            predictions;
-    std::vector<std::vector<double>>            filtered_data;
-
-};
\ No newline at end of file
+#endif
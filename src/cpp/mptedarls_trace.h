@@ -0,0 +1,136 @@
+#ifndef MPTEDARLS_TRACE_H
+#define MPTEDARLS_TRACE_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Trace de depuração do MPTEDARLS, por amostra: k, x, média, variância global,
+// flag de outlier, predições e x corrigido.
+//
+// Desligado por padrão: sem MPTEDARLS_TRACE definido a chamada some na compilação
+// e a classe não guarda nenhum ponteiro de trace. Para ligar:
+//   g++ -DMPTEDARLS_TRACE ...
+// e associar um destino por instância com model.setTrace(&trace).
+
+class MPTEDARLSTrace {
+public:
+    virtual ~MPTEDARLSTrace() {}
+    virtual void record(long k, int n, const double* x, const double* mean, double var_global,
+                        int outlier_flag, const double* y_pred, const double* x_filtered) = 0;
+};
+
+// CSV em texto, mesmo layout do antigo debug_log_cpp.csv
+class MPTEDARLSCsvTrace : public MPTEDARLSTrace {
+public:
+    explicit MPTEDARLSCsvTrace(const std::string& filename) : out_(filename) {
+        out_ << std::fixed << std::setprecision(16);
+    }
+
+    bool isOpen() const { return out_.is_open(); }
+
+    void record(long k, int n, const double* x, const double* mean, double var_global,
+                int outlier_flag, const double* y_pred, const double* x_filtered) override {
+        if (!header_written_) {
+            out_ << "k";
+            for (int i = 0; i < n; ++i) out_ << ",x" << i;
+            for (int i = 0; i < n; ++i) out_ << ",mean" << i;
+            out_ << ",var_global,outlier_flag";
+            for (int i = 0; i < n; ++i) out_ << ",y_pred" << i;
+            for (int i = 0; i < n; ++i) out_ << ",x_corr" << i;
+            out_ << "\n";
+            header_written_ = true;
+        }
+
+        out_ << k;
+        for (int i = 0; i < n; ++i) out_ << "," << x[i];
+        for (int i = 0; i < n; ++i) out_ << "," << mean[i];
+        out_ << "," << var_global << "," << outlier_flag;
+        for (int i = 0; i < n; ++i) out_ << "," << y_pred[i];
+        for (int i = 0; i < n; ++i) out_ << "," << x_filtered[i];
+        out_ << "\n";
+    }
+
+private:
+    std::ofstream out_;
+    bool header_written_ = false;
+};
+
+// Buffer circular binário em memória com as últimas 'capacity' amostras.
+// Cada registro ocupa 4n+3 doubles: k, x[n], mean[n], var_global, outlier_flag,
+// y_pred[n], x_filtered[n]. Nenhuma formatação nem alocação por amostra.
+class MPTEDARLSRingTrace : public MPTEDARLSTrace {
+public:
+    MPTEDARLSRingTrace(int n_dims, std::size_t capacity)
+        : n_(n_dims), stride_(4 * n_dims + 3), capacity_(capacity),
+          buf_(capacity * (4 * n_dims + 3), 0.0) {}
+
+    void record(long k, int n, const double* x, const double* mean, double var_global,
+                int outlier_flag, const double* y_pred, const double* x_filtered) override {
+        if (capacity_ == 0 || n != n_) return;
+
+        std::size_t slot = (start_ + count_) % capacity_;
+        if (count_ == capacity_) {
+            start_ = (start_ + 1) % capacity_;  // sobrescreve o registro mais antigo
+        } else {
+            ++count_;
+        }
+
+        double* r = &buf_[slot * stride_];
+        *r++ = double(k);
+        r = std::copy(x, x + n, r);
+        r = std::copy(mean, mean + n, r);
+        *r++ = var_global;
+        *r++ = double(outlier_flag);
+        r = std::copy(y_pred, y_pred + n, r);
+        std::copy(x_filtered, x_filtered + n, r);
+    }
+
+    std::size_t size() const { return count_; }
+    std::size_t stride() const { return stride_; }
+
+    // i = 0 é o registro mais antigo retido
+    const double* entry(std::size_t i) const { return &buf_[((start_ + i) % capacity_) * stride_]; }
+
+    void clear() {
+        start_ = 0;
+        count_ = 0;
+    }
+
+    // Grava os registros (do mais antigo ao mais recente) precedidos por
+    // um cabeçalho: "MPTR", n (int32), número de registros (uint64)
+    bool dump(const std::string& filename) const {
+        std::ofstream out(filename, std::ios::binary);
+        if (!out.is_open()) return false;
+
+        int32_t n = n_;
+        uint64_t count = count_;
+        out.write("MPTR", 4);
+        out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (std::size_t i = 0; i < count_; ++i) {
+            out.write(reinterpret_cast<const char*>(entry(i)), stride_ * sizeof(double));
+        }
+        return out.good();
+    }
+
+private:
+    int n_;
+    std::size_t stride_;
+    std::size_t capacity_;
+    std::size_t start_ = 0;
+    std::size_t count_ = 0;
+    std::vector<double> buf_;
+};
+
+#ifdef MPTEDARLS_TRACE
+#define MPTEDARLS_TRACE_RECORD(trace, ...) do { if (trace) (trace)->record(__VA_ARGS__); } while (0)
+#else
+#define MPTEDARLS_TRACE_RECORD(trace, ...) do { } while (0)
+#endif
+
+#endif // MPTEDARLS_TRACE_H
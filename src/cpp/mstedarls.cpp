@@ -1,9 +1,11 @@
 #include "mstedarls.h"
+#include "mstedarls_fixed.h"
 #include <stdexcept>
+#include <algorithm>
 
 MSTEDARLS::MSTEDARLS(double threshold, double rls_mu, double rls_delta,
                      double w_init, int n_features, bool correct_outlier)
-    : threshold_(threshold), rls_mu_(rls_mu), rls_delta_(rls_delta),
+    : threshold_(threshold), rls_mu_(rls_mu), rls_delta_(rls_delta), w_init_(w_init),
       correct_outlier_(correct_outlier), n_features_(n_features)
 {
     n_ = std::vector<double>(n_features_, 0.0);
@@ -13,37 +15,128 @@ MSTEDARLS::MSTEDARLS(double threshold, double rls_mu, double rls_delta,
     P_ = std::vector<double>(n_features_, rls_delta_);
 }
 
+void MSTEDARLS::set_teda_window(TedaWindow mode, double param) {
+    if (mode == TedaWindow::Exponential && !(param > 0.0 && param < 1.0)) {
+        throw std::invalid_argument("Fator de esquecimento deve estar em (0, 1)");
+    }
+    if (mode == TedaWindow::Sliding && !(param >= 2.0)) {
+        throw std::invalid_argument("Janela deslizante precisa de pelo menos 2 amostras");
+    }
+
+    window_mode_ = mode;
+    forget_ = mode == TedaWindow::Exponential ? 1.0 - param : 0.0;
+    window_len_ = mode == TedaWindow::Sliding ? (size_t)param : 0;
+    window_.assign(window_len_ * n_features_, 0.0);
+    window_head_.assign(window_len_ ? n_features_ : 0, 0);
+
+    std::fill(n_.begin(), n_.end(), 0.0);
+    std::fill(mean_.begin(), mean_.end(), 0.0);
+    std::fill(var_.begin(), var_.end(), 0.0);
+}
+
 bool MSTEDARLS::teda_outlier(double x, int i) {
+    if (window_mode_ == TedaWindow::Cumulative) {
+        n_[i] += 1.0;
+        return mstedarls_teda(x, n_[i], mean_[i], var_[i], threshold_);
+    }
+    if (window_mode_ == TedaWindow::Exponential) {
+        n_[i] += 1.0;
+        return mstedarls_teda_exp(x, n_[i], mean_[i], var_[i], threshold_, forget_);
+    }
+
+    // janela deslizante: sai a amostra mais antiga (janela cheia), entra x;
+    // n_ conta as amostras na janela e var_ guarda M2
+    double* ring = &window_[i * window_len_];
+    size_t& head = window_head_[i];
+    if (n_[i] == (double)window_len_) {
+        n_[i] -= 1.0;
+        teda_welford_remove(ring[head], n_[i], mean_[i], var_[i]);
+    }
+    ring[head] = x;
+    head = (head + 1) % window_len_;
     n_[i] += 1.0;
-    double delta = x - mean_[i];
-    mean_[i] += delta / n_[i];
-    var_[i] += delta * (x - mean_[i]);
+    teda_welford_add(x, n_[i], mean_[i], var_[i]);
 
     if (n_[i] < 2.0) return false;
-
     double sigma2 = var_[i] / (n_[i] - 1.0);
     if (sigma2 == 0.0) return false;
-
     double d2 = (x - mean_[i]) * (x - mean_[i]) / sigma2;
     return d2 > threshold_;
 }
 
+void MSTEDARLS::set_ar_order(int p, double ar_mu) {
+    if (p < 0 || p > 16) {
+        throw std::invalid_argument("Ordem AR deve estar em [0, 16]");
+    }
+    if (ar_mu < 0.0 || ar_mu > 1.0) {
+        throw std::invalid_argument("Fator de esquecimento do AR deve estar em (0, 1]");
+    }
+
+    ar_order_ = p;
+    ar_mu_ = ar_mu > 0.0 ? ar_mu : rls_mu_;
+    ar_w_.assign((size_t)n_features_ * p, 0.0);
+    ar_P_.assign((size_t)n_features_ * p * p, 0.0);
+    ar_lags_.assign((size_t)n_features_ * 2 * p, 0.0);
+    ar_head_.assign(p ? n_features_ : 0, 0);
+    ar_ready_.assign(p ? n_features_ : 0, 0);
+    ar_Pphi_.assign(p, 0.0);
+    for (int i = 0; i < n_features_ && p > 0; ++i) {
+        ar_w_[i * p] = w_init_;
+        for (int j = 0; j < p; ++j) ar_P_[(i * p + j) * p + j] = rls_delta_;
+    }
+}
+
 double MSTEDARLS::rls_predict(int i) {
-    return w_[i];
+    if (ar_order_ == 0) return w_[i];
+
+    // sem histórico ainda (AR ligado no meio do fluxo): usa a predição univariada
+    if (!ar_ready_[i]) return w_[i];
+    const int p = ar_order_;
+    const double* lags = &ar_lags_[i * 2 * p];
+    return mstedarls_ar_predict(&ar_w_[i * p], lags + ar_head_[i], p);
 }
 
 void MSTEDARLS::rls_update(double x, int i) {
-    double phi = 1.0; // entrada univariada
-    double P = P_[i];
-    double w = w_[i];
+    if (ar_order_ == 0) {
+        mstedarls_rls(x, w_[i], P_[i], rls_mu_);
+        return;
+    }
+
+    const int p = ar_order_;
+    double* lags = &ar_lags_[i * 2 * p];
+    if (!ar_ready_[i]) {
+        // primeira amostra: histórico preenchido com ela
+        std::fill(lags, lags + 2 * p, x);
+        ar_ready_[i] = 1;
+        return;
+    }
+    mstedarls_ar_rls(x, &ar_w_[i * p], &ar_P_[i * p * p], lags + ar_head_[i], p,
+                     ar_mu_, rls_delta_ * p, ar_Pphi_.data());
+    mstedarls_ar_push(x, lags, ar_head_[i], p);
+}
+
+bool MSTEDARLS::step(double x, double& x_out, int i) {
+    bool outlier = teda_outlier(x, i);
+
+    if (outlier && correct_outlier_) {
+        x = rls_predict(i);
+    }
+
+    rls_update(x, i);
+    x_out = x;
+    return outlier;
+}
 
-    double k = P * phi / (rls_mu_ + phi * P * phi);
-    double err = x - (phi * w);
-    double w_new = w + k * err;
-    double P_new = (P - k * phi * P) / rls_mu_;
+void MSTEDARLS::update(const double* x_in, double* x_out, uint32_t& outlier_mask) {
+    if (n_features_ > 32) {
+        throw std::runtime_error("Máscara de outliers limitada a 32 features");
+    }
 
-    w_[i] = w_new;
-    P_[i] = P_new;
+    uint32_t mask = 0;
+    for (int i = 0; i < n_features_; ++i) {
+        if (step(x_in[i], x_out[i], i)) mask |= (uint32_t(1) << i);
+    }
+    outlier_mask = mask;
 }
 
 std::pair<std::vector<double>, std::vector<bool>> MSTEDARLS::update(const std::vector<double>& x_vec) {
@@ -51,19 +144,181 @@ std::pair<std::vector<double>, std::vector<bool>> MSTEDARLS::update(const std::v
         throw std::runtime_error("Dimensão da entrada incorreta");
     }
 
-    std::vector<double> x_corrected = x_vec;
+    std::vector<double> x_corrected(n_features_);
     std::vector<bool> is_outlier(n_features_, false);
 
     for (int i = 0; i < n_features_; ++i) {
-        bool outlier = teda_outlier(x_vec[i], i);
-        is_outlier[i] = outlier;
+        is_outlier[i] = step(x_vec[i], x_corrected[i], i);
+    }
+
+    return {x_corrected, is_outlier};
+}
+
+// ---------------------------------------------------------------------------
+// Processamento em lote (SoA): entradas e saídas em colunas, todas as features
+// avançam juntas a cada linha para que as recorrências independentes se
+// sobreponham no pipeline. Em relação ao update() linha a linha:
+//  - n, o ganho k e P do RLS univariado (phi = 1) não dependem da entrada e são
+//    iguais para todas as features: são calculados uma vez por linha e deixam de
+//    ser recalculados quando P atinge o ponto fixo em ponto flutuante;
+//  - o teste d2 > threshold é decidido por multiplicação (dx² (n-1) vs
+//    threshold var) quando a margem relativa é grande; casos ambíguos refazem a
+//    conta exata com as mesmas divisões do caminho escalar.
+// Resta uma divisão dependente por feature (a média), e a saída é idêntica bit
+// a bit. Ao compilar com -march=native use -ffp-contract=off para o compilador
+// não fundir mul+add em nenhum dos caminhos.
+// ---------------------------------------------------------------------------
 
-        if (outlier && correct_outlier_) {
-            x_corrected[i] = rls_predict(i);
+// Margens da comparação sem divisão (muito acima dos ~4 ulp de erro de arredondamento)
+static const double BATCH_CMP_HI = 1.0 + 1e-12;
+static const double BATCH_CMP_LO = 1.0 - 1e-12;
+static const double BATCH_VAR_MIN = 1e-290;
+static const double BATCH_VAR_MAX = 1e290;
+
+void MSTEDARLS::batch_scalar(const double* const cols[], size_t n_rows,
+                             double* const out_cols[], uint32_t* masks) {
+    for (size_t r = 0; r < n_rows; ++r) {
+        uint32_t mask = 0;
+        for (int i = 0; i < n_features_; ++i) {
+            if (step(cols[i][r], out_cols[i][r], i) && masks) mask |= (uint32_t(1) << i);
         }
+        if (masks) masks[r] = mask;
+    }
+}
 
-        rls_update(x_corrected[i], i);
+void MSTEDARLS::process_batch(const double* const cols[], size_t n_rows,
+                              double* const out_cols[], uint32_t* outlier_masks) {
+    if (outlier_masks && n_features_ > 32) {
+        throw std::runtime_error("Máscara de outliers limitada a 32 features");
     }
+    if (n_features_ <= 0) return;
 
-    return {x_corrected, is_outlier};
-}
\ No newline at end of file
+    // a via rápida só cobre o TEDA cumulativo com o RLS univariado
+    if (window_mode_ != TedaWindow::Cumulative || ar_order_ > 0) {
+        batch_scalar(cols, n_rows, out_cols, outlier_masks);
+        return;
+    }
+
+    // n e P são sempre iguais entre features; se não forem, usa o caminho linha a linha
+    for (int i = 1; i < n_features_; ++i) {
+        if (n_[i] != n_[0] || P_[i] != P_[0]) {
+            batch_scalar(cols, n_rows, out_cols, outlier_masks);
+            return;
+        }
+    }
+
+    const int nf = n_features_;
+    const double threshold = threshold_;
+    const bool correct = correct_outlier_;
+    const bool fast_cmp = threshold >= 1e-100 && threshold <= 1e100;
+    double* mean = mean_.data();
+    double* var = var_.data();
+    double* w = w_.data();
+
+    double n = n_[0];
+    double P = P_[0];
+    double k = 0.0;
+    bool P_fixed = false;
+
+    for (size_t r = 0; r < n_rows; ++r) {
+        n += 1.0;
+        const double n_minus_1 = n - 1.0;
+        const bool detect = !(n < 2.0);
+
+        // RLS univariado compartilhado (mesmas operações de mstedarls_rls)
+        if (!P_fixed) {
+            k = P * 1.0 / (rls_mu_ + 1.0 * P * 1.0);
+            double P_new = (P - k * 1.0 * P) / rls_mu_;
+            P_fixed = (P_new == P);
+            P = P_new;
+        }
+
+        uint32_t mask = 0;
+        for (int i = 0; i < nf; ++i) {
+            // TEDA (Welford)
+            double x = cols[i][r];
+            double m = mean[i];
+            double delta = x - m;
+            m += delta / n;
+            double v = var[i] + delta * (x - m);
+            mean[i] = m;
+            var[i] = v;
+
+            double dx = x - m;
+            double dx2 = dx * dx;
+            double lhs = dx2 * n_minus_1;
+            double rhs = v * threshold;
+            bool in_range = v > BATCH_VAR_MIN && v < BATCH_VAR_MAX && dx2 < BATCH_VAR_MAX;
+            bool above = lhs > rhs * BATCH_CMP_HI;
+            bool below = lhs < rhs * BATCH_CMP_LO;
+
+            bool outlier;
+            if (fast_cmp && in_range && (above || below)) {
+                outlier = above;
+            } else {
+                double sigma2 = v / n_minus_1;
+                outlier = sigma2 != 0.0 && dx2 / sigma2 > threshold;
+            }
+            outlier = outlier && detect;
+
+            // correção pela predição do RLS
+            double wi = w[i];
+            if (outlier && correct) x = wi;
+            w[i] = wi + k * (x - wi);
+
+            out_cols[i][r] = x;
+            if (outlier && outlier_masks) mask |= (uint32_t(1) << i);
+        }
+        if (outlier_masks) outlier_masks[r] = mask;
+    }
+
+    for (int i = 0; i < nf; ++i) {
+        n_[i] = n;
+        P_[i] = P;
+    }
+}
+
+size_t MSTEDARLS::serialized_size() const {
+    return TEDARLS_CKPT_HEADER + sizeof(uint8_t) + sizeof(double) + 5 * n_features_ * sizeof(double) +
+           TEDARLS_CKPT_TRAILER;
+}
+
+double MSTEDARLS::window_param() const {
+    if (window_mode_ == TedaWindow::Exponential) return 1.0 - forget_;
+    if (window_mode_ == TedaWindow::Sliding) return (double)window_len_;
+    return 0.0;
+}
+
+size_t MSTEDARLS::serialize(uint8_t* buf) const {
+    CheckpointWriter w(buf);
+    w.begin("MSTD", tedarls_type_tag<double>::value, uint16_t(n_features_));
+    w.put(uint8_t(window_mode_));
+    w.put(window_param());
+    for (int i = 0; i < n_features_; ++i) w.put(n_[i]);
+    for (int i = 0; i < n_features_; ++i) w.put(mean_[i]);
+    for (int i = 0; i < n_features_; ++i) w.put(var_[i]);
+    for (int i = 0; i < n_features_; ++i) w.put(w_[i]);
+    for (int i = 0; i < n_features_; ++i) w.put(P_[i]);
+    return w.finish();
+}
+
+bool MSTEDARLS::deserialize(const uint8_t* buf, size_t len) {
+    CheckpointReader r(buf, len);
+    if (!r.check("MSTD", tedarls_type_tag<double>::value, uint16_t(n_features_), serialized_size())) {
+        return false;
+    }
+    // var_ é M2 (Cumulative/Sliding) ou variância exponencial: só restaura na mesma janela
+    if (r.get<uint8_t>() != uint8_t(window_mode_) || r.get<double>() != window_param()) {
+        return false;
+    }
+
+    for (int i = 0; i < n_features_; ++i) n_[i] = r.get<double>();
+    for (int i = 0; i < n_features_; ++i) mean_[i] = r.get<double>();
+    for (int i = 0; i < n_features_; ++i) var_[i] = r.get<double>();
+    for (int i = 0; i < n_features_; ++i) w_[i] = r.get<double>();
+    for (int i = 0; i < n_features_; ++i) P_[i] = r.get<double>();
+    if (window_mode_ == TedaWindow::Sliding) {
+        set_teda_window(TedaWindow::Sliding, (double)window_len_);
+    }
+    return true;
+}
@@ -3,15 +3,55 @@
 
 #include <vector>
 #include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "teda_window.h"
 
 class MSTEDARLS {
 public:
     MSTEDARLS(double threshold = 4.0, double rls_mu = 1.0, double rls_delta = 1000.0,
               double w_init = 0.0, int n_features = 1, bool correct_outlier = false);
 
+    // Janela da estatística TEDA (padrão: cumulativa); reinicia média e variância, o RLS
+    // é mantido. Exponential: param = lambda em (0, 1). Sliding: param = W amostras.
+    void set_teda_window(TedaWindow mode, double param = 0.0);
+    TedaWindow teda_window() const { return window_mode_; }
+
+    // Preditor da correção: 0 (padrão) = RLS univariado com phi = 1 (média exponencial);
+    // p em [1, 16] = AR(p) por feature sobre as últimas p amostras aceitas, com w_init
+    // como peso inicial do primeiro atraso e fator de esquecimento ar_mu (0 = rls_mu).
+    // Reinicia o preditor; custo O(p²) por feature.
+    void set_ar_order(int p, double ar_mu = 0.0);
+    int ar_order() const { return ar_order_; }
+
     std::pair<std::vector<double>, std::vector<bool>> update(const std::vector<double>& x_vec);
 
+    // Versão sem alocação: x_in/x_out com n_features valores, bit i da máscara = outlier
+    // na feature i (exige n_features <= 32)
+    void update(const double* x_in, double* x_out, uint32_t& outlier_mask);
+
+    // Processamento em lote colunar: cols[i]/out_cols[i] apontam para n_rows valores da
+    // feature i. Continua do estado atual e gera a mesma saída que update() linha a linha.
+    // outlier_masks (opcional, n_rows entradas) exige n_features <= 32.
+    void process_batch(const double* const cols[], size_t n_rows,
+                       double* const out_cols[], uint32_t* outlier_masks = nullptr);
+
+    // Checkpoint binário do estado aprendido ("MSTD", ver tedarls_checkpoint.h), com o
+    // modo da janela do TEDA e seu parâmetro (lambda ou W) no início do payload.
+    // serialize() escreve serialized_size() bytes em buf e retorna esse tamanho;
+    // deserialize() retorna false, sem alterar o modelo, se o snapshot for inválido
+    // ou de outra janela do TEDA.
+    // As amostras da janela deslizante não são gravadas: nesse modo o TEDA recomeça
+    // vazio após deserialize() (o RLS é restaurado). O estado do AR(p) também fica fora.
+    size_t serialized_size() const;
+    size_t serialize(uint8_t* buf) const;
+    bool deserialize(const uint8_t* buf, size_t len);
+
 private:
+    double window_param() const;  // lambda (Exponential), W (Sliding) ou 0
+    void batch_scalar(const double* const cols[], size_t n_rows,
+                      double* const out_cols[], uint32_t* masks);
+    bool step(double x, double& x_out, int i);
     bool teda_outlier(double x, int i);
     double rls_predict(int i);
     void rls_update(double x, int i);
@@ -19,6 +59,7 @@ private:
     double threshold_;
     double rls_mu_;
     double rls_delta_;
+    double w_init_;
     bool correct_outlier_;
     int n_features_;
 
@@ -27,6 +68,23 @@ private:
     std::vector<double> var_;
     std::vector<double> w_;   // pesos do RLS
     std::vector<double> P_;   // matriz P univariada (1x1 por feature)
+
+    // janela do TEDA
+    TedaWindow window_mode_ = TedaWindow::Cumulative;
+    double forget_ = 0.0;            // 1 - lambda (Exponential)
+    size_t window_len_ = 0;          // W (Sliding)
+    std::vector<double> window_;     // W amostras por feature, circular (Sliding)
+    std::vector<size_t> window_head_;
+
+    // preditor AR(p)
+    int ar_order_ = 0;
+    double ar_mu_ = 0.0;
+    std::vector<double> ar_w_;      // p pesos por feature
+    std::vector<double> ar_P_;      // p x p por feature
+    std::vector<double> ar_lags_;   // 2p por feature (ver mstedarls_ar_push)
+    std::vector<int> ar_head_;
+    std::vector<uint8_t> ar_ready_;
+    std::vector<double> ar_Pphi_;   // área de trabalho (p)
 };
 
 #endif // MSTEDARLS_H
\ No newline at end of file
@@ -0,0 +1,287 @@
+#ifndef MSTEDARLS_FIXED_H
+#define MSTEDARLS_FIXED_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "tedarls_checkpoint.h"
+#include "teda_window.h"
+
+// Núcleo por feature compartilhado entre MSTEDARLS (dinâmico) e MSTEDARLSFixed.
+// 'n' já deve estar incrementado para a amostra atual.
+template <typename T>
+inline bool mstedarls_teda(T x, T n, T& mean, T& var, T threshold) {
+    T delta = x - mean;
+    mean += delta / n;
+    var += delta * (x - mean);
+
+    if (n < T(2.0)) return false;
+
+    T sigma2 = var / (n - T(1.0));
+    if (sigma2 == T(0.0)) return false;
+
+    T d2 = (x - mean) * (x - mean) / sigma2;
+    return d2 > threshold;
+}
+
+// Variante com esquecimento exponencial (TedaWindow::Exponential); var guarda a
+// variância populacional exponencial em vez da soma M2
+template <typename T>
+inline bool mstedarls_teda_exp(T x, T n, T& mean, T& var, T threshold, T one_minus_lambda) {
+    T alpha = teda_exp_alpha(n, one_minus_lambda);
+    teda_exp_update(x, alpha, mean, var);
+
+    if (n < T(2.0)) return false;
+
+    T sigma2 = teda_exp_sigma2(var, alpha);
+    if (sigma2 == T(0.0)) return false;
+
+    T d2 = (x - mean) * (x - mean) / sigma2;
+    return d2 > threshold;
+}
+
+// RLS univariado (phi = 1): w é a predição, P a covariância 1x1
+template <typename T>
+inline void mstedarls_rls(T x, T& w, T& P, T rls_mu) {
+    const T phi = T(1.0);
+    T k = P * phi / (rls_mu + phi * P * phi);
+    T err = x - (phi * w);
+    T w_new = w + k * err;
+    T P_new = (P - k * phi * P) / rls_mu;
+
+    w = w_new;
+    P = P_new;
+}
+
+// ---------------------------------------------------------------------------
+// RLS autoregressivo AR(p) por feature: x_t ≈ aᵀ·[x_{t-1} ... x_{t-p}].
+// Histórico 'lags' com 2p posições: cada amostra é gravada em head e head + p, de modo
+// que lags[head .. head + p) é sempre o regressor contíguo, mais recente primeiro.
+// P (p x p, row-major) é mantida simétrica. Sem excitação (sinal parado) o
+// esquecimento faria P crescer sem limite: acima de trace_max a divisão por rls_mu
+// é suspensa.
+// ---------------------------------------------------------------------------
+
+// Insere x no histórico (O(1))
+template <typename T>
+inline void mstedarls_ar_push(T x, T* lags, int& head, int p) {
+    head = (head == 0 ? p : head) - 1;
+    lags[head] = x;
+    lags[head + p] = x;
+}
+
+// Predição aᵀ·phi
+template <typename T>
+inline T mstedarls_ar_predict(const T* a, const T* phi, int p) {
+    T y = T(0.0);
+    for (int j = 0; j < p; ++j) y += a[j] * phi[j];
+    return y;
+}
+
+// Atualiza a e P com a amostra x e o regressor phi; Pphi: área de trabalho de p valores
+template <typename T>
+inline void mstedarls_ar_rls(T x, T* a, T* P, const T* phi, int p, T rls_mu, T trace_max, T* Pphi) {
+    T denom = rls_mu;
+    for (int r = 0; r < p; ++r) {
+        const T* Pr = P + r * p;
+        T sum = T(0.0);
+        for (int c = 0; c < p; ++c) sum += Pr[c] * phi[c];
+        Pphi[r] = sum;
+        denom += phi[r] * sum;
+    }
+
+    T inv = T(1.0) / denom;
+    T err = x - mstedarls_ar_predict(a, phi, p);
+    for (int j = 0; j < p; ++j) a[j] += Pphi[j] * inv * err;
+
+    // P ← (P − (Pφ)(Pφ)ᵀ/denom) / μ, com o produto simétrico calculado igual nos dois lados
+    T trace = T(0.0);
+    for (int r = 0; r < p; ++r) {
+        T* Pr = P + r * p;
+        for (int c = 0; c < p; ++c) Pr[c] -= Pphi[r] * Pphi[c] * inv;
+        trace += Pr[r];
+    }
+    if (trace / rls_mu <= trace_max) {
+        T inv_mu = T(1.0) / rls_mu;
+        for (int j = 0; j < p * p; ++j) P[j] *= inv_mu;
+    }
+}
+
+// MSTEDARLS com número de features fixo em tempo de compilação.
+// Estado em std::array e update() sem nenhuma alocação de heap. Aceita TEDA cumulativo
+// (padrão) ou com esquecimento exponencial; a janela deslizante exata fica no MSTEDARLS
+// dinâmico, por exigir um buffer de W x N amostras.
+// AR > 0 troca o RLS univariado (phi = 1) por um AR(AR) por feature; w_init vira o
+// peso inicial do primeiro atraso e o esquecimento do AR é rls_mu (ver set_ar_mu()).
+template <std::size_t N, typename T = double, std::size_t AR = 0>
+class MSTEDARLSFixed {
+    static_assert(N >= 1 && N <= 32, "MSTEDARLSFixed: N deve estar em [1, 32] (máscara de 32 bits)");
+    static_assert(AR <= 16, "MSTEDARLSFixed: ordem AR no máximo 16");
+
+public:
+    static constexpr std::size_t n_features = N;
+    static constexpr std::size_t ar_order = AR;
+
+    MSTEDARLSFixed(T threshold = T(4.0), T rls_mu = T(1.0), T rls_delta = T(1000.0),
+                   T w_init = T(0.0), bool correct_outlier = false)
+        : threshold_(threshold), rls_mu_(rls_mu), rls_delta_(rls_delta),
+          correct_outlier_(correct_outlier), forget_(T(0.0)), ar_mu_(rls_mu), n_(T(0.0))
+    {
+        mean_.fill(T(0.0));
+        var_.fill(T(0.0));
+        w_.fill(w_init);
+        P_.fill(rls_delta_);
+
+        ar_w_.fill(T(0.0));
+        ar_P_.fill(T(0.0));
+        ar_lags_.fill(T(0.0));
+        for (std::size_t i = 0; i < N * AR; i += AR) {
+            ar_w_[i] = w_init;
+            for (std::size_t j = 0; j < AR; ++j) ar_P_[(i + j) * AR + j] = rls_delta_;
+        }
+    }
+
+    // Esquecimento exponencial do TEDA com fator lambda em (0, 1); lambda >= 1 volta ao
+    // cumulativo. Reinicia média e variância (o RLS é mantido).
+    void set_forgetting(T lambda) {
+        forget_ = lambda < T(1.0) ? T(1.0) - lambda : T(0.0);
+        n_ = T(0.0);
+        mean_.fill(T(0.0));
+        var_.fill(T(0.0));
+    }
+
+    // Fator de esquecimento do AR, em (0, 1]; com poucas amostras de memória (rls_mu
+    // baixo) os p pesos ficam ruidosos
+    void set_ar_mu(T mu) { ar_mu_ = mu; }
+
+    // in/out podem apontar para o mesmo buffer; bit i da máscara = outlier na feature i
+    void update(const T* in, T* out, uint32_t& outlier_mask) {
+        n_ += T(1.0);
+        uint32_t mask = 0;
+
+        for (std::size_t i = 0; i < N; ++i) {
+            T x = in[i];
+            bool outlier = forget_ > T(0.0)
+                ? mstedarls_teda_exp(x, n_, mean_[i], var_[i], threshold_, forget_)
+                : mstedarls_teda(x, n_, mean_[i], var_[i], threshold_);
+            if (outlier) {
+                mask |= (uint32_t(1) << i);
+                if (correct_outlier_) x = predict(i, x);
+            }
+            rls_update(x, i);
+            out[i] = x;
+        }
+
+        // o histórico do AR avança uma vez por linha, com os valores aceitos
+        if constexpr (AR > 0) {
+            if (ar_ready_) {
+                int head = ar_head_ == 0 ? int(AR) - 1 : ar_head_ - 1;
+                for (std::size_t i = 0; i < N; ++i) {
+                    T* lags = &ar_lags_[i * 2 * AR];
+                    lags[head] = out[i];
+                    lags[head + AR] = out[i];
+                }
+                ar_head_ = head;
+            }
+            ar_ready_ = true;
+        }
+
+        outlier_mask = mask;
+    }
+
+    // Checkpoint do estado aprendido (mesmo formato do MSTEDARLS dinâmico, "MSTD", com
+    // o modo da janela do TEDA e lambda); o estado do AR não faz parte do snapshot
+    static constexpr std::size_t serialized_size() {
+        return TEDARLS_CKPT_HEADER + sizeof(uint8_t) + sizeof(T) + 5 * N * sizeof(T) + TEDARLS_CKPT_TRAILER;
+    }
+
+    // buf deve ter serialized_size() bytes; retorna o número de bytes escritos
+    std::size_t serialize(uint8_t* buf) const {
+        CheckpointWriter w(buf);
+        w.begin("MSTD", tedarls_type_tag<T>::value, uint16_t(N));
+        w.put(uint8_t(window_mode()));
+        w.put(window_lambda());
+        for (std::size_t i = 0; i < N; ++i) w.put(n_);
+        for (std::size_t i = 0; i < N; ++i) w.put(mean_[i]);
+        for (std::size_t i = 0; i < N; ++i) w.put(var_[i]);
+        for (std::size_t i = 0; i < N; ++i) w.put(w_[i]);
+        for (std::size_t i = 0; i < N; ++i) w.put(P_[i]);
+        return w.finish();
+    }
+
+    // Restaura o estado; retorna false (sem alterar o modelo) se o snapshot for inválido
+    // ou de outra janela do TEDA (var_ é M2 no cumulativo e variância no exponencial)
+    bool deserialize(const uint8_t* buf, std::size_t len) {
+        CheckpointReader r(buf, len);
+        if (!r.check("MSTD", tedarls_type_tag<T>::value, uint16_t(N), serialized_size())) {
+            return false;
+        }
+        if (r.get<uint8_t>() != uint8_t(window_mode()) || r.get<T>() != window_lambda()) {
+            return false;
+        }
+
+        // aqui o contador é único: exige o mesmo n em todas as features
+        T n = r.get<T>();
+        for (std::size_t i = 1; i < N; ++i) {
+            if (r.get<T>() != n) return false;
+        }
+        n_ = n;
+        for (std::size_t i = 0; i < N; ++i) mean_[i] = r.get<T>();
+        for (std::size_t i = 0; i < N; ++i) var_[i] = r.get<T>();
+        for (std::size_t i = 0; i < N; ++i) w_[i] = r.get<T>();
+        for (std::size_t i = 0; i < N; ++i) P_[i] = r.get<T>();
+        return true;
+    }
+
+private:
+    TedaWindow window_mode() const { return forget_ > T(0.0) ? TedaWindow::Exponential : TedaWindow::Cumulative; }
+    T window_lambda() const { return forget_ > T(0.0) ? T(1.0) - forget_ : T(0.0); }
+
+    T predict(std::size_t i, T x) const {
+        if constexpr (AR > 0) {
+            if (!ar_ready_) return x;
+            return mstedarls_ar_predict(&ar_w_[i * AR], &ar_lags_[i * 2 * AR + ar_head_], int(AR));
+        } else {
+            (void)x;
+            return w_[i];
+        }
+    }
+
+    void rls_update(T x, std::size_t i) {
+        if constexpr (AR > 0) {
+            T* lags = &ar_lags_[i * 2 * AR];
+            if (!ar_ready_) {
+                // primeira amostra: histórico preenchido com ela
+                for (std::size_t j = 0; j < 2 * AR; ++j) lags[j] = x;
+                return;
+            }
+            mstedarls_ar_rls(x, &ar_w_[i * AR], &ar_P_[i * AR * AR], lags + ar_head_, int(AR),
+                             ar_mu_, rls_delta_ * T(AR), ar_Pphi_.data());
+        } else {
+            mstedarls_rls(x, w_[i], P_[i], rls_mu_);
+        }
+    }
+
+    T threshold_;
+    T rls_mu_;
+    T rls_delta_;
+    bool correct_outlier_;
+    T forget_;  // 1 - lambda; 0 = TEDA cumulativo
+    T ar_mu_;
+
+    T n_;  // contador de amostras (igual para todas as features)
+    std::array<T, N> mean_;
+    std::array<T, N> var_;
+    std::array<T, N> w_;   // pesos do RLS
+    std::array<T, N> P_;   // matriz P univariada (1x1 por feature)
+
+    // AR(AR): pesos, P (AR x AR) e histórico duplicado (2 AR) por feature
+    std::array<T, N * AR> ar_w_;
+    std::array<T, N * AR * AR> ar_P_;
+    std::array<T, N * 2 * AR> ar_lags_;
+    std::array<T, AR> ar_Pphi_;
+    int ar_head_ = 0;
+    bool ar_ready_ = false;
+};
+
+#endif // MSTEDARLS_FIXED_H
@@ -0,0 +1,204 @@
+#include "result_writer.h"
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+static const size_t OUT_BUFFER_SIZE = 1 << 20;
+// maior campo possível: double em formato fixo (309 dígitos) + casas + separador
+static const size_t MAX_FIELD = 400;
+
+// Grava os n bytes menos significativos de v em little-endian, qualquer que seja a
+// ordem de bytes do host
+static void store_le(char* dst, uint64_t v, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = char(uint8_t(v >> (8 * i)));
+}
+
+static uint64_t double_bits(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+// std::to_chars com o resultado verificado: se o campo pedido não couber (precisão
+// muito grande em formato fixo), grava a representação mais curta que reproduz o
+// valor. nullptr se nem essa couber.
+static char* format_double(char* p, char* end, double v, std::chars_format fmt, int precision) {
+    std::to_chars_result r = std::to_chars(p, end, v, fmt, precision);
+    if (r.ec == std::errc()) return r.ptr;
+    r = std::to_chars(p, end, v);
+    return r.ec == std::errc() ? r.ptr : nullptr;
+}
+
+ResultWriter::ResultWriter(const std::string& filename, const std::vector<ResultColumn>& columns,
+                           ResultFormat format, size_t block_rows)
+    : columns_(columns), format_(format), block_rows_(block_rows ? block_rows : 1)
+{
+    file_ = std::fopen(filename.c_str(), "wb");
+    if (!file_) throw std::runtime_error("Erro ao criar arquivo de saída: " + filename);
+
+    filling_.values.resize(block_rows_ * columns_.size());
+    pending_.values.resize(block_rows_ * columns_.size());
+    out_.resize(OUT_BUFFER_SIZE);
+
+    write_header();
+    thread_ = std::thread(&ResultWriter::writer_loop, this);
+}
+
+ResultWriter::~ResultWriter() {
+    try {
+        close();
+    } catch (...) {
+        // erros de escrita só são reportados por close() explícito
+    }
+}
+
+ResultFormat ResultWriter::format_for(const std::string& filename) {
+    size_t n = filename.size();
+    return n >= 4 && filename.compare(n - 4, 4, ".bin") == 0 ? ResultFormat::Binary : ResultFormat::Csv;
+}
+
+void ResultWriter::append(const double* values) {
+    std::memcpy(&filling_.values[filling_.rows * columns_.size()], values,
+                columns_.size() * sizeof(double));
+    if (++filling_.rows == block_rows_) submit();
+}
+
+// Entrega o bloco cheio à thread de escrita (espera se a anterior ainda não terminou)
+void ResultWriter::submit() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return !has_pending_; });
+    std::swap(filling_, pending_);
+    filling_.rows = 0;
+    has_pending_ = true;
+    cv_.notify_all();
+}
+
+void ResultWriter::close() {
+    if (!file_) return;
+
+    if (filling_.rows > 0) submit();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+
+    flush_text(OUT_BUFFER_SIZE);  // esvazia o buffer
+    if (std::fclose(file_) != 0) io_error_ = true;
+    file_ = nullptr;
+
+    if (io_error_) throw std::runtime_error("Erro ao gravar arquivo de saída.");
+}
+
+void ResultWriter::writer_loop() {
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return has_pending_ || done_; });
+        if (!has_pending_) return;  // done_ e nada pendente
+
+        // formata fora do lock; o produtor só toca em pending_ depois de has_pending_ = false
+        lock.unlock();
+        write_block(pending_);
+        lock.lock();
+
+        has_pending_ = false;
+        cv_.notify_all();
+    }
+}
+
+// Grava out_ no arquivo se couberem menos de 'reserve' bytes
+void ResultWriter::flush_text(size_t reserve) {
+    if (out_len_ + reserve <= out_.size()) return;
+    if (out_len_ > 0 && std::fwrite(out_.data(), 1, out_len_, file_) != out_len_) io_error_ = true;
+    out_len_ = 0;
+}
+
+void ResultWriter::write_header() {
+    if (format_ == ResultFormat::Csv) {
+        for (size_t c = 0; c < columns_.size(); ++c) {
+            const std::string& name = columns_[c].name;
+            flush_text(name.size() + 2);
+            std::memcpy(&out_[out_len_], name.data(), name.size());
+            out_len_ += name.size();
+            out_[out_len_++] = c + 1 < columns_.size() ? ',' : '\n';
+        }
+        return;
+    }
+
+    auto put = [&](const void* p, size_t n) {
+        flush_text(n);
+        std::memcpy(&out_[out_len_], p, n);
+        out_len_ += n;
+    };
+    auto put_le = [&](uint64_t v, size_t n) {
+        flush_text(n);
+        store_le(&out_[out_len_], v, n);
+        out_len_ += n;
+    };
+    put("TEDR", 4);
+    put_le(1, 1);  // versão
+    put_le(columns_.size(), 2);
+    for (const auto& col : columns_) {
+        put_le(col.type, 1);
+        put_le(col.name.size(), 2);
+        put(col.name.data(), col.name.size());
+    }
+}
+
+void ResultWriter::write_block(const Block& block) {
+    if (format_ == ResultFormat::Csv) write_csv(block);
+    else write_binary(block);
+}
+
+void ResultWriter::write_csv(const Block& block) {
+    const size_t n_cols = columns_.size();
+    for (size_t r = 0; r < block.rows; ++r) {
+        const double* row = &block.values[r * n_cols];
+        for (size_t c = 0; c < n_cols; ++c) {
+            flush_text(MAX_FIELD);
+            char* p = &out_[out_len_];
+            char* end = p + MAX_FIELD - 1;
+            const ResultColumn& col = columns_[c];
+
+            char* field = p;
+            if (col.type == ResultColumn::FLAG) {
+                std::to_chars_result r = std::to_chars(p, end, long(row[c]));
+                p = r.ec == std::errc() ? r.ptr : nullptr;
+            } else if (col.fixed) {
+                p = format_double(p, end, row[c], std::chars_format::fixed, col.precision);
+            } else {
+                p = format_double(p, end, row[c], std::chars_format::general, col.precision);
+            }
+            if (!p) {
+                // não acontece com MAX_FIELD: campo vazio e erro reportado em close()
+                io_error_ = true;
+                p = field;
+            }
+            *p++ = c + 1 < n_cols ? ',' : '\n';
+            out_len_ = p - out_.data();
+        }
+    }
+}
+
+void ResultWriter::write_binary(const Block& block) {
+    const size_t n_cols = columns_.size();
+    flush_text(4);
+    store_le(&out_[out_len_], block.rows, 4);
+    out_len_ += 4;
+
+    for (size_t c = 0; c < n_cols; ++c) {
+        bool flag = columns_[c].type == ResultColumn::FLAG;
+        for (size_t r = 0; r < block.rows; ++r) {
+            double v = block.values[r * n_cols + c];
+            if (flag) {
+                flush_text(1);
+                out_[out_len_++] = char(uint8_t(v));
+            } else {
+                flush_text(8);
+                store_le(&out_[out_len_], double_bits(v), 8);
+                out_len_ += 8;
+            }
+        }
+    }
+}
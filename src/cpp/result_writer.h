@@ -0,0 +1,90 @@
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Coluna de saída. Em CSV, 'fixed' = casas decimais fixas (como std::fixed +
+// setprecision) e caso contrário formato geral com 'precision' dígitos significativos
+// (o padrão do ostream é 6). Colunas FLAG são gravadas como inteiros (CSV) ou u8 (binário).
+struct ResultColumn {
+    enum Type : uint8_t { F64 = 1, FLAG = 2 };
+
+    std::string name;
+    Type type = F64;
+    bool fixed = false;
+    int precision = 6;
+};
+
+enum class ResultFormat { Csv, Binary };
+
+// Gravador de resultados em blocos, com a formatação e a escrita numa thread separada:
+// o processamento preenche um bloco enquanto o anterior é formatado e gravado.
+//
+// CSV: std::to_chars num buffer grande, mesmo texto que ofstream << com as mesmas
+// opções de formatação.
+// Binário (colunar, little-endian):
+//   "TEDR" | versão u8 | n_cols u16 | por coluna: tipo u8, tamanho do nome u16, nome
+//   blocos: n_rows u32, depois cada coluna com n_rows valores contíguos
+//           (F64: 8 bytes, FLAG: 1 byte), até o fim do arquivo
+class ResultWriter {
+public:
+    ResultWriter(const std::string& filename, const std::vector<ResultColumn>& columns,
+                 ResultFormat format = ResultFormat::Csv, size_t block_rows = 8192);
+    ~ResultWriter();
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    // Formato escolhido pela extensão: ".bin" = binário, qualquer outra = CSV
+    static ResultFormat format_for(const std::string& filename);
+
+    size_t columns() const { return columns_.size(); }
+
+    // Acrescenta uma linha com columns() valores
+    void append(const double* values);
+
+    // Grava o que falta e encerra a thread; lança std::runtime_error em erro de escrita
+    void close();
+
+private:
+    struct Block {
+        std::vector<double> values;  // block_rows x n_cols, row-major
+        size_t rows = 0;
+    };
+
+    void writer_loop();
+    void write_header();
+    void write_block(const Block& block);
+    void write_csv(const Block& block);
+    void write_binary(const Block& block);
+    void flush_text(size_t reserve);
+    void submit();
+
+    std::vector<ResultColumn> columns_;
+    ResultFormat format_;
+    size_t block_rows_;
+    std::FILE* file_ = nullptr;
+    bool io_error_ = false;
+
+    // bloco em preenchimento (produtor) e bloco entregue à thread de escrita
+    Block filling_;
+    Block pending_;
+    bool has_pending_ = false;
+    bool done_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+
+    // buffer de texto/binário da thread de escrita
+    std::vector<char> out_;
+    size_t out_len_ = 0;
+};
+
+#endif // RESULT_WRITER_H
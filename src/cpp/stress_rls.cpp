@@ -0,0 +1,193 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "mptedarls.h"
+#include "anomaly_injector.h"
+
+// Para compilar:
+// g++ -std=c++17 -O2 stress_rls.cpp -o stress_rls
+// Uso: ./stress_rls [--samples N] [--check-every M] [--type float|double|all]
+//                   [--backend cov|sqrt|all] [--seed S]
+//
+// Teste de resistência do RLS do MPTEDARLS: roda o modelo por --samples amostras
+// (padrão 1e8) de um sinal sintético com picos, travamentos e perdas de sinal (trechos
+// sem excitação, onde P tende a crescer) e, a cada --check-every amostras (padrão 1e6),
+// confere cada P_i fora da linha/coluna mascarada: valores finitos, simetria e
+// Cholesky em double com todos os pivôs positivos. Para cada combinação de tipo e motor
+// imprime o menor pivô relativo (pivô² / maior diagonal) e o maior traço observados, e
+// a primeira amostra em que P_i deixou de ser definida positiva, se houver.
+// O modelo roda sem reset por outliers consecutivos (window_outlier_limit = 0).
+// Só o motor SquareRoot decide o código de saída; o Covariance é referência.
+
+static const int N_FEATURES = 5;
+
+struct Health {
+    bool ok = true;
+    double min_pivot = 1.0;   // menor pivô² / maior diagonal
+    double max_trace = 0.0;
+    double max_asym = 0.0;    // maior |P_rc - P_cr| / sqrt(P_rr * P_cc)
+    const char* reason = "";
+};
+
+// Confere o bloco (n-1)x(n-1) de P_i sem a linha/coluna i
+static void check_covariance(const double* P, int n, int skip, Health& h) {
+    const int m = n - 1;
+    double A[N_FEATURES * N_FEATURES];
+    int idx[N_FEATURES];
+    for (int r = 0, k = 0; r < n; ++r) if (r != skip) idx[k++] = r;
+
+    double max_diag = 0.0, trace = 0.0;
+    for (int r = 0; r < m; ++r) {
+        for (int c = 0; c < m; ++c) {
+            double v = P[idx[r] * n + idx[c]];
+            if (!std::isfinite(v)) {
+                h.ok = false;
+                h.reason = "valor não finito";
+                return;
+            }
+            A[r * m + c] = v;
+        }
+        max_diag = std::max(max_diag, A[r * m + r]);
+        trace += A[r * m + r];
+    }
+    h.max_trace = std::max(h.max_trace, trace);
+
+    for (int r = 0; r < m; ++r) {
+        for (int c = r + 1; c < m; ++c) {
+            double scale = std::sqrt(std::fabs(A[r * m + r] * A[c * m + c]));
+            double asym = scale > 0.0 ? std::fabs(A[r * m + c] - A[c * m + r]) / scale : 0.0;
+            h.max_asym = std::max(h.max_asym, asym);
+        }
+    }
+
+    // Cholesky usando o triângulo inferior
+    for (int j = 0; j < m; ++j) {
+        double pivot = A[j * m + j];
+        for (int k = 0; k < j; ++k) pivot -= A[j * m + k] * A[j * m + k];
+        if (!(pivot > 0.0)) {
+            h.ok = false;
+            h.reason = "pivô de Cholesky não positivo";
+            h.min_pivot = std::min(h.min_pivot, max_diag > 0.0 ? pivot / max_diag : pivot);
+            return;
+        }
+        h.min_pivot = std::min(h.min_pivot, pivot / max_diag);
+        double ljj = std::sqrt(pivot);
+        A[j * m + j] = ljj;
+        for (int r = j + 1; r < m; ++r) {
+            double v = A[r * m + j];
+            for (int k = 0; k < j; ++k) v -= A[r * m + k] * A[j * m + k];
+            A[r * m + j] = v / ljj;
+        }
+    }
+}
+
+template <typename T>
+static bool run(RlsBackend backend, const char* name, uint64_t samples, uint64_t check_every, uint64_t seed,
+                bool reference) {
+    // window_outlier_limit = 0: sem o resetCovariance() após outliers seguidos, que
+    // esconderia a perda de definição positiva de P
+    MPTEDARLSBasic<T> model(5.592, N_FEATURES, 0.9249, 0.1, std::vector<double>(N_FEATURES, 0.0),
+                            true, 0, 0, false, 6.0, 1e-6, true, true,
+                            {-100.0, 100.0}, {-100.0, 100.0}, 10.0, false);
+    model.setRlsBackend(backend);
+
+    AnomalyConfig config;
+    config.spike_rate = 0.002;
+    config.stuck_rate = 0.0005;
+    config.dropout_rate = 0.0002;
+    config.max_duration = 2000;
+    config.seed = seed;
+    SyntheticStream stream(N_FEATURES, seed);
+    AnomalyInjector injector(N_FEATURES, config);
+
+    double xd[N_FEATURES];
+    uint8_t types[N_FEATURES];
+    T x[N_FEATURES], y_pred[N_FEATURES], x_filtered[N_FEATURES];
+    double P[N_FEATURES * N_FEATURES];
+    Health total;
+    uint64_t first_failure = 0, flags = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t k = 1; k <= samples; ++k) {
+        stream.next(xd);
+        injector.apply(xd, types);
+        for (int i = 0; i < N_FEATURES; ++i) x[i] = T(xd[i]);
+        flags += model.run(x, y_pred, x_filtered);
+
+        if (k % check_every == 0 || k == samples) {
+            Health h;
+            for (int i = 0; i < N_FEATURES && h.ok; ++i) {
+                model.getCovariance(i, P);
+                check_covariance(P, N_FEATURES, i, h);
+            }
+            total.min_pivot = std::min(total.min_pivot, h.min_pivot);
+            total.max_trace = std::max(total.max_trace, h.max_trace);
+            total.max_asym = std::max(total.max_asym, h.max_asym);
+            if (!h.ok) {
+                total.ok = false;
+                total.reason = h.reason;
+                first_failure = k;
+                break;
+            }
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    const char* status = total.ok ? "ok" : "FALHA";
+    if (reference) status = total.ok ? "ok (ref.)" : "FALHA (ref.)";
+    std::printf("%-16s %-12s  pivô mín %.3e  traço máx %.3e  assimetria máx %.3e  flags %llu  %.1f ns/amostra",
+                name, status, total.min_pivot, total.max_trace, total.max_asym,
+                (unsigned long long)flags, secs * 1e9 / double(first_failure ? first_failure : samples));
+    if (!total.ok) {
+        std::printf("  (%s na amostra %llu)", total.reason, (unsigned long long)first_failure);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+    return total.ok;
+}
+
+int main(int argc, char** argv) {
+    uint64_t samples = 100000000ull;
+    uint64_t check_every = 1000000ull;
+    uint64_t seed = 1;
+    std::string type = "all", backend = "all";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--samples" && i + 1 < argc) samples = (uint64_t)std::atof(argv[++i]);
+        else if (a == "--check-every" && i + 1 < argc) check_every = (uint64_t)std::atof(argv[++i]);
+        else if (a == "--type" && i + 1 < argc) type = argv[++i];
+        else if (a == "--backend" && i + 1 < argc) backend = argv[++i];
+        else if (a == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Opção desconhecida: " << a << std::endl;
+            return 1;
+        }
+    }
+    if (samples == 0 || check_every == 0) {
+        std::cerr << "Erro: --samples e --check-every devem ser positivos." << std::endl;
+        return 1;
+    }
+
+    std::cout << samples << " amostras, P conferida a cada " << check_every << "\n";
+
+    // só o motor SquareRoot conta para o código de saída; o Covariance sem o reset
+    // periódico perde a definição positiva e entra apenas como referência ("ref.")
+    bool ok = true;
+    bool do_cov = backend == "all" || backend == "cov";
+    bool do_sqrt = backend == "all" || backend == "sqrt";
+    bool do_double = type == "all" || type == "double";
+    bool do_float = type == "all" || type == "float";
+    if (do_double && do_cov) run<double>(RlsBackend::Covariance, "double cov", samples, check_every, seed, true);
+    if (do_double && do_sqrt) ok &= run<double>(RlsBackend::SquareRoot, "double sqrt", samples, check_every, seed, false);
+    if (do_float && do_cov) run<float>(RlsBackend::Covariance, "float cov", samples, check_every, seed, true);
+    if (do_float && do_sqrt) ok &= run<float>(RlsBackend::SquareRoot, "float sqrt", samples, check_every, seed, false);
+    if (do_cov) std::cout << "(ref.): motor Covariance, só referência, não entra no código de saída\n";
+    return ok ? 0 : 1;
+}
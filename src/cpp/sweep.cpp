@@ -0,0 +1,453 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include "mstedarls.h"
+#include "mptedarls.h"
+#include "csv_reader.h"
+#include "result_writer.h"
+#include "detector_pool.h"
+#include "tedarls_metrics.h"
+#include "anomaly_injector.h"
+
+// Para compilar: cmake -S . -B build && cmake --build build --target sweep
+// Uso: ./sweep [opções] dados1.csv [dados2.csv ...]
+//
+// Varredura de hiperparâmetros em paralelo. Os datasets são lidos uma única vez e
+// compartilhados (somente leitura) entre os workers; cada configuração roda um modelo
+// novo sobre todos os datasets e é avaliada contra os rótulos:
+//   - colunas label_<feature> (0/1): rótulo por feature; ou coluna label: rótulo por linha
+//   - colunas clean_<feature>: sinal limpo para o MAE (padrão: a própria entrada)
+//   - sem rótulos: injeta picos com AnomalyInjector (--inject-rate, --seed) e usa o
+//     original como sinal limpo; para outros tipos de anomalia, gere o dataset com inject
+// Com rótulos por feature, o MST é avaliado por célula (linha, feature); o MPT, que
+// sinaliza a linha inteira, e os datasets com rótulo por linha são avaliados por linha.
+
+static const char* USAGE =
+    "Uso: sweep [opções] dados1.csv [dados2.csv ...]\n"
+    "\n"
+    "  --algo mst|mpt          algoritmo (padrão: mst)\n"
+    "  --columns a,b,...       features usadas (padrão: todas exceto label*/clean_*)\n"
+    "  --min v1,... --max v1,...  escalonador min-max do mpt (padrão: faixa de cada dataset)\n"
+    "  -j, --threads N         threads (padrão: núcleos)\n"
+    "  -o arquivo.csv          grava todas as configurações avaliadas\n"
+    "  --top N                 configurações mostradas no resumo (padrão: 10)\n"
+    "  --objective f1|mae      critério de ordenação (padrão: f1)\n"
+    "  --inject-rate R         fração de linhas com pico quando não há rótulos (0.02)\n"
+    "  --seed S                semente da injeção e da amostragem (1)\n"
+    "\n"
+    "Espaço de busca (valor único, lista a,b,c ou grade ini:fim:passo):\n"
+    "  --threshold  (mst 8.414 / mpt 5.592)   --mu      (0.7 / 0.9249)\n"
+    "  --delta      (1000 / 0.1)              --ecc-div (mpt, 6.0)\n"
+    "  --max-dw     (mpt, 10.0)               --window-limit (mpt, 5)\n"
+    "\n"
+    "Amostragem (padrão: grade completa):\n"
+    "  --random N              N configurações uniformes dentro dos limites de cada parâmetro\n"
+    "  --refine R              R rodadas extras, amostrando em torno das melhores configurações\n";
+
+static const int N_PARAMS = 6;
+static const char* PARAM_NAMES[N_PARAMS] = { "threshold", "mu", "delta", "ecc_div", "max_dw", "window_limit" };
+
+// Configuração avaliada: valores na ordem de PARAM_NAMES
+struct Config {
+    double p[N_PARAMS];
+};
+
+// Métricas acumuladas de uma configuração sobre todos os datasets
+struct Metrics : TEDARLSMetrics {
+    double seconds = 0;
+};
+
+struct Dataset {
+    std::string name;
+    size_t n_rows = 0;
+    int n_features = 0;
+    std::vector<double> x;          // entrada (com anomalias), n_rows x n_features
+    std::vector<double> clean;      // referência para o MAE
+    std::vector<uint32_t> labels;   // bit i = anomalia na feature i (ou linha inteira)
+    bool per_feature = true;        // rótulos por feature ou só por linha
+    std::vector<double> lo, hi;     // escalonador min-max do mpt
+};
+
+struct Options {
+    std::string algo = "mst";
+    std::vector<std::string> columns;
+    std::vector<double> min_vals, max_vals;
+    int threads = 0;
+    std::string output;
+    size_t top = 10;
+    std::string objective = "f1";
+    double inject_rate = 0.02;
+    unsigned seed = 1;
+    std::vector<double> space[N_PARAMS];
+    bool space_set[N_PARAMS] = {};
+    size_t random = 0;
+    int refine = 0;
+    std::vector<std::string> inputs;
+};
+
+static double parse_double(const std::string& s, const std::string& opt) {
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    if (s.empty() || *end != '\0') throw std::invalid_argument("Valor inválido para " + opt + ": " + s);
+    return v;
+}
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    std::istringstream ss(s);
+    std::string token;
+    while (std::getline(ss, token, sep)) out.push_back(token);
+    return out;
+}
+
+// "v", "a,b,c" ou "ini:fim:passo"
+static std::vector<double> parse_space(const std::string& s, const std::string& opt) {
+    std::vector<double> values;
+    std::vector<std::string> range = split(s, ':');
+    if (range.size() == 3) {
+        double lo = parse_double(range[0], opt), hi = parse_double(range[1], opt);
+        double step = parse_double(range[2], opt);
+        if (!(step > 0) || hi < lo) throw std::invalid_argument("Grade inválida para " + opt + ": " + s);
+        size_t n = (size_t)std::floor((hi - lo) / step + 1e-9) + 1;
+        for (size_t i = 0; i < n; ++i) values.push_back(lo + i * step);
+    } else {
+        for (const auto& token : split(s, ',')) values.push_back(parse_double(token, opt));
+    }
+    if (values.empty()) throw std::invalid_argument("Nenhum valor para " + opt);
+    return values;
+}
+
+static Options parse_args(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("Falta valor para " + a);
+            return argv[++i];
+        };
+        auto param = [&](int p) {
+            opt.space[p] = parse_space(value(), a);
+            opt.space_set[p] = true;
+        };
+
+        if (a == "-h" || a == "--help") { std::cout << USAGE; std::exit(0); }
+        else if (a == "--algo") opt.algo = value();
+        else if (a == "--columns") opt.columns = split(value(), ',');
+        else if (a == "--min") for (const auto& t : split(value(), ',')) opt.min_vals.push_back(parse_double(t, a));
+        else if (a == "--max") for (const auto& t : split(value(), ',')) opt.max_vals.push_back(parse_double(t, a));
+        else if (a == "-j" || a == "--threads") opt.threads = (int)parse_double(value(), a);
+        else if (a == "-o") opt.output = value();
+        else if (a == "--top") opt.top = (size_t)parse_double(value(), a);
+        else if (a == "--objective") opt.objective = value();
+        else if (a == "--inject-rate") opt.inject_rate = parse_double(value(), a);
+        else if (a == "--seed") opt.seed = (unsigned)parse_double(value(), a);
+        else if (a == "--threshold") param(0);
+        else if (a == "--mu") param(1);
+        else if (a == "--delta") param(2);
+        else if (a == "--ecc-div") param(3);
+        else if (a == "--max-dw") param(4);
+        else if (a == "--window-limit") param(5);
+        else if (a == "--random") opt.random = (size_t)parse_double(value(), a);
+        else if (a == "--refine") opt.refine = (int)parse_double(value(), a);
+        else if (a.size() > 1 && a[0] == '-') throw std::invalid_argument("Opção desconhecida: " + a);
+        else opt.inputs.push_back(a);
+    }
+
+    if (opt.algo != "mst" && opt.algo != "mpt") throw std::invalid_argument("Algoritmo desconhecido: " + opt.algo);
+    if (opt.objective != "f1" && opt.objective != "mae") throw std::invalid_argument("Objetivo desconhecido: " + opt.objective);
+    if (opt.inputs.empty()) throw std::invalid_argument("Nenhum arquivo de entrada.");
+    if (opt.min_vals.size() != opt.max_vals.size()) throw std::invalid_argument("--min e --max devem ter o mesmo número de valores.");
+
+    // padrões dos drivers; parâmetros só do mpt ficam fixos no mst
+    bool mst = opt.algo == "mst";
+    const double defaults[N_PARAMS] = { mst ? 8.414 : 5.592, mst ? 0.7 : 0.9249, mst ? 1000.0 : 0.1, 6.0, 10.0, 5 };
+    for (int p = 0; p < N_PARAMS; ++p) {
+        if (!opt.space_set[p] || (mst && p >= 3)) opt.space[p] = { defaults[p] };
+    }
+    return opt;
+}
+
+static bool starts_with(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Carrega o dataset inteiro; sem rótulos, injeta picos com a semente dada
+static Dataset load_dataset(const Options& opt, const std::string& filename, unsigned seed) {
+    CsvReader reader(filename);
+    const std::vector<std::string>& header = reader.header();
+    auto find = [&](const std::string& name) -> int {
+        for (size_t i = 0; i < header.size(); ++i) if (header[i] == name) return (int)i;
+        return -1;
+    };
+
+    std::vector<std::string> names = opt.columns;
+    if (names.empty()) {
+        for (const auto& h : header) {
+            if (!starts_with(h, "label") && !starts_with(h, "clean_")) names.push_back(h);
+        }
+    }
+
+    Dataset ds;
+    ds.name = filename;
+    ds.n_features = (int)names.size();
+    if (ds.n_features == 0 || ds.n_features > 32) throw std::runtime_error("Entre 1 e 32 features: " + filename);
+
+    std::vector<int> cols, label_cols, clean_cols;
+    for (const auto& name : names) {
+        int c = find(name);
+        if (c < 0) throw std::runtime_error("Coluna " + name + " não encontrada em " + filename);
+        cols.push_back(c);
+        label_cols.push_back(find("label_" + name));
+        clean_cols.push_back(find("clean_" + name));
+    }
+    bool has_feature_labels = std::find(label_cols.begin(), label_cols.end(), -1) == label_cols.end();
+    int row_label = find("label");
+    bool labelled = has_feature_labels || row_label >= 0;
+    ds.per_feature = has_feature_labels || !labelled;
+
+    while (reader.next()) {
+        const double* row = reader.row();
+        uint32_t mask = 0;
+        for (int i = 0; i < ds.n_features; ++i) {
+            ds.x.push_back(row[cols[i]]);
+            ds.clean.push_back(clean_cols[i] >= 0 ? row[clean_cols[i]] : row[cols[i]]);
+            if (has_feature_labels && row[label_cols[i]] != 0.0) mask |= 1u << i;
+        }
+        if (!has_feature_labels && row_label >= 0 && row[row_label] != 0.0) mask = 1;
+        ds.labels.push_back(mask);
+        ++ds.n_rows;
+    }
+    if (ds.n_rows == 0) throw std::runtime_error("Arquivo CSV vazio ou inválido: " + filename);
+
+    // faixa de cada feature no sinal limpo
+    ds.lo.assign(ds.n_features, 0.0);
+    ds.hi.assign(ds.n_features, 0.0);
+    for (int i = 0; i < ds.n_features; ++i) {
+        ds.lo[i] = ds.hi[i] = ds.clean[i];
+        for (size_t r = 0; r < ds.n_rows; ++r) {
+            ds.lo[i] = std::min(ds.lo[i], ds.clean[r * ds.n_features + i]);
+            ds.hi[i] = std::max(ds.hi[i], ds.clean[r * ds.n_features + i]);
+        }
+        if (!(ds.hi[i] > ds.lo[i])) ds.hi[i] = ds.lo[i] + 1.0;
+    }
+
+    if (!labelled) {
+        // picos do AnomalyInjector; a taxa por feature mantém inject_rate por linha
+        AnomalyConfig config;
+        config.spike_rate = opt.inject_rate / ds.n_features;
+        config.seed = seed;
+        AnomalyInjector injector(ds.n_features, config);
+        std::vector<uint8_t> types(ds.n_features);
+        for (size_t r = 0; r < ds.n_rows; ++r) {
+            ds.labels[r] = injector.apply(&ds.x[r * ds.n_features], types.data());
+        }
+    }
+
+    if (!opt.min_vals.empty()) {
+        if ((int)opt.min_vals.size() != ds.n_features) throw std::runtime_error("Escalonador incompatível com " + filename);
+        ds.lo = opt.min_vals;
+        ds.hi = opt.max_vals;
+    }
+    return ds;
+}
+
+// Roda uma configuração sobre todos os datasets (modelo novo em cada um)
+static Metrics evaluate(const Options& opt, const std::vector<Dataset>& datasets, const Config& c) {
+    Metrics m;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const Dataset& ds : datasets) {
+        const int n = ds.n_features;
+        if (opt.algo == "mst") {
+            MSTEDARLS model(c.p[0], c.p[1], c.p[2], 1.0, n, true);
+            std::vector<double> out(n);
+            for (size_t r = 0; r < ds.n_rows; ++r) {
+                uint32_t mask = 0;
+                model.update(&ds.x[r * n], out.data(), mask);
+                if (ds.per_feature) m.add_detection(mask, ds.labels[r], n);
+                else m.add_detection(mask != 0, ds.labels[r] != 0);
+                m.add_error(out.data(), &ds.clean[r * n], n);
+            }
+        } else {
+            MPTEDARLS model(c.p[0], n, c.p[1], c.p[2], std::vector<double>(n, 0.0), true,
+                            0, (int)c.p[5], false, c.p[3], 1e-6, true, true,
+                            {-100.0, 100.0}, {-100.0, 100.0}, c.p[4], false);
+            std::vector<double> x(n), y_pred(n), corr(n);
+            for (size_t r = 0; r < ds.n_rows; ++r) {
+                for (int i = 0; i < n; ++i) x[i] = (ds.x[r * n + i] - ds.lo[i]) / (ds.hi[i] - ds.lo[i]);
+                int flag = model.run(x.data(), y_pred.data(), x.data());
+                m.add_detection(flag != 0, ds.labels[r] != 0);
+                for (int i = 0; i < n; ++i) corr[i] = x[i] * (ds.hi[i] - ds.lo[i]) + ds.lo[i];
+                m.add_error(corr.data(), &ds.clean[r * n], n);
+            }
+        }
+    }
+
+    m.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return m;
+}
+
+// Produto cartesiano do espaço de busca
+static std::vector<Config> grid(const Options& opt) {
+    std::vector<Config> configs(1);
+    for (int p = 0; p < N_PARAMS; ++p) {
+        std::vector<Config> next;
+        for (const Config& c : configs) {
+            for (double v : opt.space[p]) {
+                Config n = c;
+                n.p[p] = v;
+                next.push_back(n);
+            }
+        }
+        configs.swap(next);
+    }
+    return configs;
+}
+
+// Limites de cada parâmetro (menor e maior valor do espaço)
+static void bounds(const Options& opt, double lo[], double hi[]) {
+    for (int p = 0; p < N_PARAMS; ++p) {
+        lo[p] = *std::min_element(opt.space[p].begin(), opt.space[p].end());
+        hi[p] = *std::max_element(opt.space[p].begin(), opt.space[p].end());
+    }
+}
+
+static std::vector<Config> random_configs(const Options& opt, size_t n, std::mt19937_64& rng) {
+    double lo[N_PARAMS], hi[N_PARAMS];
+    bounds(opt, lo, hi);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::vector<Config> configs(n);
+    for (Config& c : configs) {
+        for (int p = 0; p < N_PARAMS; ++p) c.p[p] = lo[p] + u(rng) * (hi[p] - lo[p]);
+        c.p[5] = std::round(c.p[5]);
+    }
+    return configs;
+}
+
+// Amostras gaussianas em torno das melhores configurações; o desvio cai pela metade
+// a cada rodada
+static std::vector<Config> refine_configs(const Options& opt, const std::vector<Config>& elite,
+                                          size_t n, int round, std::mt19937_64& rng) {
+    double lo[N_PARAMS], hi[N_PARAMS];
+    bounds(opt, lo, hi);
+    double scale = 0.1 * std::pow(0.5, round);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    std::uniform_int_distribution<size_t> pick(0, elite.size() - 1);
+    std::vector<Config> configs(n);
+    for (Config& c : configs) {
+        c = elite[pick(rng)];
+        for (int p = 0; p < N_PARAMS; ++p) {
+            c.p[p] = std::min(hi[p], std::max(lo[p], c.p[p] + gauss(rng) * scale * (hi[p] - lo[p])));
+        }
+        c.p[5] = std::round(c.p[5]);
+    }
+    return configs;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    std::vector<Dataset> datasets;
+    try {
+        opt = parse_args(argc, argv);
+        for (size_t i = 0; i < opt.inputs.size(); ++i) {
+            datasets.push_back(load_dataset(opt, opt.inputs[i], opt.seed + (unsigned)i));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Erro: " << e.what() << std::endl;
+        return 1;
+    }
+
+    size_t total_rows = 0, total_labels = 0;
+    for (const auto& ds : datasets) {
+        total_rows += ds.n_rows;
+        for (uint32_t l : ds.labels) total_labels += l != 0;
+    }
+    std::cout << datasets.size() << " dataset(s), " << total_rows << " linhas, "
+              << total_labels << " linhas com anomalia\n";
+
+    std::mt19937_64 rng(opt.seed);
+    std::vector<Config> configs = opt.random > 0 ? random_configs(opt, opt.random, rng) : grid(opt);
+    std::vector<Metrics> metrics;
+
+    // melhor primeiro conforme o objetivo (empate no F1 decidido pelo MAE)
+    auto better = [&](size_t a, size_t b) {
+        if (opt.objective == "mae" || metrics[a].f1() == metrics[b].f1()) return metrics[a].mae() < metrics[b].mae();
+        return metrics[a].f1() > metrics[b].f1();
+    };
+
+    ThreadPool pool(opt.threads);
+    auto start = std::chrono::steady_clock::now();
+    size_t batch = configs.size();
+    for (int round = 0;; ++round) {
+        size_t first = metrics.size();
+        metrics.resize(configs.size());
+        pool.run(configs.size() - first, [&](size_t t) {
+            metrics[first + t] = evaluate(opt, datasets, configs[first + t]);
+        });
+        if (round >= opt.refine) break;
+
+        std::vector<size_t> order(metrics.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        size_t n_elite = std::max<size_t>(1, batch / 10);
+        std::partial_sort(order.begin(), order.begin() + std::min(n_elite, order.size()), order.end(), better);
+        std::vector<Config> elite;
+        for (size_t i = 0; i < n_elite && i < order.size(); ++i) elite.push_back(configs[order[i]]);
+
+        std::vector<Config> next = refine_configs(opt, elite, batch, round, rng);
+        configs.insert(configs.end(), next.begin(), next.end());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<size_t> order(metrics.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), better);
+
+    std::cout << configs.size() << " configurações em " << seconds << " s ("
+              << pool.size() << " threads)\n\n";
+    std::cout << "threshold,mu,delta,ecc_div,max_dw,window_limit,precision,recall,f1,mae,rmse\n";
+    for (size_t i = 0; i < opt.top && i < order.size(); ++i) {
+        const Config& c = configs[order[i]];
+        const Metrics& m = metrics[order[i]];
+        for (int p = 0; p < N_PARAMS; ++p) std::cout << c.p[p] << ",";
+        std::cout << m.precision() << "," << m.recall() << "," << m.f1() << "," << m.mae() << "," << m.rmse() << "\n";
+    }
+
+    if (!opt.output.empty()) {
+        std::vector<ResultColumn> columns;
+        auto column = [&](const std::string& name) {
+            ResultColumn c;
+            c.name = name;
+            c.precision = 10;
+            columns.push_back(c);
+        };
+        for (int p = 0; p < N_PARAMS; ++p) column(PARAM_NAMES[p]);
+        for (const char* name : { "tp", "fp", "fn", "precision", "recall", "f1", "mae", "rmse", "seconds" }) column(name);
+
+        try {
+            ResultWriter out(opt.output, columns, ResultWriter::format_for(opt.output));
+            double row[N_PARAMS + 9];
+            for (size_t i : order) {
+                const Metrics& m = metrics[i];
+                std::copy(configs[i].p, configs[i].p + N_PARAMS, row);
+                double values[9] = { double(m.true_positives()), double(m.false_positives()),
+                                     double(m.false_negatives()), m.precision(), m.recall(), m.f1(),
+                                     m.mae(), m.rmse(), m.seconds };
+                std::copy(values, values + 9, row + N_PARAMS);
+                out.append(row);
+            }
+            out.close();
+        } catch (const std::exception& e) {
+            std::cerr << "Erro: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "\nResultados salvos em " << opt.output << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef TEDA_WINDOW_H
+#define TEDA_WINDOW_H
+
+#include <cstdint>
+
+// Janela da estatística do TEDA (média/variância):
+//  Cumulative  - todas as amostras desde o início (comportamento original)
+//  Exponential - esquecimento exponencial com fator λ: peso 1/n até a memória efetiva
+//                1/(1-λ), depois 1-λ; O(1) de memória por feature
+//  Sliding     - exatamente as últimas W amostras (Welford com inclusão e remoção,
+//                buffer circular de W amostras por feature)
+enum class TedaWindow : uint8_t { Cumulative = 0, Exponential = 1, Sliding = 2 };
+
+// Peso da amostra n (1, 2, ...) no modo exponencial; one_minus_lambda = 1 - λ
+template <typename T>
+inline T teda_exp_alpha(T n, T one_minus_lambda) {
+    T alpha = T(1.0) / n;
+    return alpha < one_minus_lambda ? one_minus_lambda : alpha;
+}
+
+// Média e variância populacional com esquecimento; com alpha = 1/n coincidem com as
+// cumulativas (var = M2 / n)
+template <typename T>
+inline void teda_exp_update(T x, T alpha, T& mean, T& var) {
+    T delta = x - mean;
+    mean += alpha * delta;
+    var = (T(1.0) - alpha) * (var + alpha * delta * delta);
+}
+
+// Variância amostral a partir da populacional exponencial (correção n/(n-1) com a
+// memória efetiva n = 1/alpha); exige alpha < 1
+template <typename T>
+inline T teda_exp_sigma2(T var, T alpha) {
+    return var / (T(1.0) - alpha);
+}
+
+// Welford: inclui x em (mean, m2); n_new = contagem já com x
+template <typename T>
+inline void teda_welford_add(T x, T n_new, T& mean, T& m2) {
+    T delta = x - mean;
+    mean += delta / n_new;
+    m2 += delta * (x - mean);
+}
+
+// Welford: remove x de (mean, m2); n_new = contagem já sem x
+template <typename T>
+inline void teda_welford_remove(T x, T n_new, T& mean, T& m2) {
+    if (n_new <= T(0.0)) {
+        mean = T(0.0);
+        m2 = T(0.0);
+        return;
+    }
+    T delta = x - mean;
+    mean -= delta / n_new;
+    m2 -= delta * (x - mean);
+    if (m2 < T(0.0)) m2 = T(0.0);  // arredondamento
+}
+
+#endif // TEDA_WINDOW_H
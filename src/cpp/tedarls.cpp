@@ -0,0 +1,525 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <memory>
+#include <mutex>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include "mstedarls.h"
+#include "mptedarls.h"
+#include "csv_reader.h"
+#include "result_writer.h"
+#include "detector_pool.h"
+#include "tedarls_metrics.h"
+
+// Para compilar: cmake -S . -B build && cmake --build build --target tedarls
+// ou: g++ -std=c++17 -O2 -pthread tedarls.cpp mstedarls.cpp csv_reader.cpp result_writer.cpp detector_pool.cpp -o tedarls
+// Uso: ./tedarls [opções] entrada1.csv [entrada2.csv ...]
+//
+// Executa MST ou MPT sobre cada arquivo de entrada, sem hiperparâmetros fixos no código.
+// Cada arquivo é processado por um worker (-j), com modelo próprio desde o estado inicial.
+// Os valores padrão reproduzem main_mstedarls (--algo mst) e main_mptedarls (--algo mpt).
+
+static const char* USAGE =
+    "Uso: tedarls [opções] entrada1.csv [entrada2.csv ...]\n"
+    "\n"
+    "Geral:\n"
+    "  --algo mst|mpt          algoritmo (padrão: mst)\n"
+    "  --columns a,b,...       colunas usadas, por nome (padrão: todas exceto label*/clean_*)\n"
+    "  --min v1,v2,...         escalonador min-max: mínimos por coluna\n"
+    "  --max v1,v2,...         escalonador min-max: máximos por coluna\n"
+    "  --no-scale              desativa o escalonador (padrão do mst)\n"
+    "  -o, --output-dir DIR    diretório de saída (padrão: o da entrada)\n"
+    "  --suffix S              sufixo do arquivo de saída (padrão: _<algo>)\n"
+    "  --format csv|bin        formato de saída (padrão: csv)\n"
+    "  --diff                  grava também <saída>_diff com |corrigido - original|\n"
+    "  -j, --threads N         arquivos processados em paralelo (padrão: núcleos)\n"
+    "  --metrics               precisão/recall contra colunas label_<col> (ou label),\n"
+    "                          MAE/RMSE contra clean_<col> (ou a entrada) e latência\n"
+    "\n"
+    "Hiperparâmetros (padrões do main_mstedarls / main_mptedarls):\n"
+    "  --threshold X           limiar TEDA (8.414 / 5.592)\n"
+    "  --mu X                  fator de esquecimento RLS (0.7 / 0.9249)\n"
+    "  --delta X               inicialização de P (1000 / 0.1)\n"
+    "  --w-init X              peso inicial (1.0 / 0.0)\n"
+    "  --no-correct            apenas detecta, não corrige\n"
+    "  --teda-window M         estatística do TEDA: cum (padrão), exp:LAMBDA\n"
+    "                          (esquecimento exponencial) ou sliding:W (últimas W amostras)\n"
+    "Somente mst:\n"
+    "  --ar-order P            correção por AR(P) por feature em vez de phi = 1 (0)\n"
+    "  --ar-mu X               fator de esquecimento do AR (padrão: --mu)\n"
+    "Somente mpt:\n"
+    "  --window-size N         o mesmo que --teda-window sliding:N (0 = cum)\n"
+    "  --window-limit N        limite de outliers na janela (5)\n"
+    "  --per-dim               TEDA por dimensão\n"
+    "  --ecc-div X             divisor da excentricidade (6.0)\n"
+    "  --epsilon X             piso da variância (1e-6)\n"
+    "  --output-clip A,B       faixa de saída (-100,100); --no-clip-output desativa\n"
+    "  --weight-clip A,B       faixa dos pesos (-100,100); --no-clip-weights desativa\n"
+    "  --max-dw X              passo máximo dos pesos (10.0)\n"
+    "  --rls cov|sqrt          motor do RLS: covariância (padrão) ou raiz quadrada\n"
+    "  --rls-trace-max X       limite do traço de P no motor sqrt (0 = automático)\n";
+
+// Linhas por bloco do MST (process_batch), como no main_mstedarls
+static const size_t CHUNK_ROWS = 4096;
+
+struct Options {
+    std::string algo = "mst";
+    std::vector<std::string> columns;
+    std::vector<double> min_vals, max_vals;
+    bool scale_set = false;
+    bool no_scale = false;
+    std::string output_dir;
+    std::string suffix;
+    ResultFormat format = ResultFormat::Csv;
+    bool diff = false;
+    bool metrics = false;
+    int threads = 0;
+
+    // NaN = usar o padrão do algoritmo
+    double threshold = NAN, mu = NAN, delta = NAN, w_init = NAN;
+    bool correct = true;
+    TedaWindow teda_window = TedaWindow::Cumulative;
+    double teda_param = 0.0;
+    int ar_order = 0;
+    double ar_mu = 0.0;
+
+    int window_size = 0;
+    int window_limit = 5;
+    bool per_dim = false;
+    double ecc_div = 6.0;
+    double epsilon = 1e-6;
+    bool clip_output = true, clip_weights = true;
+    std::pair<double, double> output_clip = {-100.0, 100.0};
+    std::pair<double, double> weight_clip = {-100.0, 100.0};
+    double max_dw = 10.0;
+    RlsBackend rls_backend = RlsBackend::Covariance;
+    double rls_trace_max = 0.0;
+
+    std::vector<std::string> inputs;
+};
+
+static double parse_double(const std::string& s, const std::string& opt) {
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    if (s.empty() || *end != '\0') throw std::invalid_argument("Valor inválido para " + opt + ": " + s);
+    return v;
+}
+
+static int parse_int(const std::string& s, const std::string& opt) {
+    char* end = nullptr;
+    long v = std::strtol(s.c_str(), &end, 10);
+    if (s.empty() || *end != '\0') throw std::invalid_argument("Valor inválido para " + opt + ": " + s);
+    return (int)v;
+}
+
+// cum | exp:LAMBDA | sliding:W
+static void parse_teda_window(const std::string& s, Options& opt) {
+    size_t colon = s.find(':');
+    std::string mode = s.substr(0, colon);
+    if (mode == "cum" && colon == std::string::npos) {
+        opt.teda_window = TedaWindow::Cumulative;
+        opt.teda_param = 0.0;
+        return;
+    }
+    if (colon == std::string::npos || (mode != "exp" && mode != "sliding"))
+        throw std::invalid_argument("Janela do TEDA inválida: " + s);
+    opt.teda_window = mode == "exp" ? TedaWindow::Exponential : TedaWindow::Sliding;
+    opt.teda_param = parse_double(s.substr(colon + 1), "--teda-window");
+    bool ok = opt.teda_window == TedaWindow::Exponential ? opt.teda_param > 0.0 && opt.teda_param < 1.0
+                                                         : opt.teda_param >= 2.0;
+    if (!ok) throw std::invalid_argument("Parâmetro fora da faixa em --teda-window: " + s);
+}
+
+static std::vector<std::string> split(const std::string& s) {
+    std::vector<std::string> out;
+    std::istringstream ss(s);
+    std::string token;
+    while (std::getline(ss, token, ',')) out.push_back(token);
+    return out;
+}
+
+static std::vector<double> parse_list(const std::string& s, const std::string& opt) {
+    std::vector<double> out;
+    for (const auto& token : split(s)) out.push_back(parse_double(token, opt));
+    return out;
+}
+
+static std::pair<double, double> parse_range(const std::string& s, const std::string& opt) {
+    std::vector<double> v = parse_list(s, opt);
+    if (v.size() != 2 || v[0] > v[1]) throw std::invalid_argument("Faixa inválida para " + opt + ": " + s);
+    return {v[0], v[1]};
+}
+
+static Options parse_args(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("Falta valor para " + a);
+            return argv[++i];
+        };
+
+        if (a == "-h" || a == "--help") { std::cout << USAGE; std::exit(0); }
+        else if (a == "--algo") opt.algo = value();
+        else if (a == "--columns") opt.columns = split(value());
+        else if (a == "--min") { opt.min_vals = parse_list(value(), a); opt.scale_set = true; }
+        else if (a == "--max") { opt.max_vals = parse_list(value(), a); opt.scale_set = true; }
+        else if (a == "--no-scale") opt.no_scale = true;
+        else if (a == "-o" || a == "--output-dir") opt.output_dir = value();
+        else if (a == "--suffix") opt.suffix = value();
+        else if (a == "--format") {
+            std::string f = value();
+            if (f == "csv") opt.format = ResultFormat::Csv;
+            else if (f == "bin") opt.format = ResultFormat::Binary;
+            else throw std::invalid_argument("Formato desconhecido: " + f);
+        }
+        else if (a == "--diff") opt.diff = true;
+        else if (a == "--metrics") opt.metrics = true;
+        else if (a == "-j" || a == "--threads") opt.threads = parse_int(value(), a);
+        else if (a == "--threshold") opt.threshold = parse_double(value(), a);
+        else if (a == "--mu") opt.mu = parse_double(value(), a);
+        else if (a == "--delta") opt.delta = parse_double(value(), a);
+        else if (a == "--w-init") opt.w_init = parse_double(value(), a);
+        else if (a == "--no-correct") opt.correct = false;
+        else if (a == "--teda-window") parse_teda_window(value(), opt);
+        else if (a == "--ar-order") opt.ar_order = parse_int(value(), a);
+        else if (a == "--ar-mu") opt.ar_mu = parse_double(value(), a);
+        else if (a == "--window-size") opt.window_size = parse_int(value(), a);
+        else if (a == "--window-limit") opt.window_limit = parse_int(value(), a);
+        else if (a == "--per-dim") opt.per_dim = true;
+        else if (a == "--ecc-div") opt.ecc_div = parse_double(value(), a);
+        else if (a == "--epsilon") opt.epsilon = parse_double(value(), a);
+        else if (a == "--output-clip") opt.output_clip = parse_range(value(), a);
+        else if (a == "--weight-clip") opt.weight_clip = parse_range(value(), a);
+        else if (a == "--no-clip-output") opt.clip_output = false;
+        else if (a == "--no-clip-weights") opt.clip_weights = false;
+        else if (a == "--max-dw") opt.max_dw = parse_double(value(), a);
+        else if (a == "--rls") {
+            std::string b = value();
+            if (b == "cov") opt.rls_backend = RlsBackend::Covariance;
+            else if (b == "sqrt") opt.rls_backend = RlsBackend::SquareRoot;
+            else throw std::invalid_argument("Motor RLS desconhecido: " + b);
+        }
+        else if (a == "--rls-trace-max") opt.rls_trace_max = parse_double(value(), a);
+        else if (a.size() > 1 && a[0] == '-') throw std::invalid_argument("Opção desconhecida: " + a);
+        else opt.inputs.push_back(a);
+    }
+
+    if (opt.algo != "mst" && opt.algo != "mpt") throw std::invalid_argument("Algoritmo desconhecido: " + opt.algo);
+    if (opt.inputs.empty()) throw std::invalid_argument("Nenhum arquivo de entrada.");
+    if (opt.ar_order < 0 || opt.ar_order > 16) throw std::invalid_argument("--ar-order deve estar em [0, 16].");
+    if (opt.ar_mu < 0.0 || opt.ar_mu > 1.0) throw std::invalid_argument("--ar-mu deve estar em (0, 1].");
+    if (opt.rls_trace_max < 0.0) throw std::invalid_argument("--rls-trace-max deve ser >= 0.");
+
+    // padrões de cada algoritmo (os mesmos dos drivers)
+    bool mst = opt.algo == "mst";
+    if (std::isnan(opt.threshold)) opt.threshold = mst ? 8.414 : 5.592;
+    if (std::isnan(opt.mu)) opt.mu = mst ? 0.7 : 0.9249;
+    if (std::isnan(opt.delta)) opt.delta = mst ? 1000.0 : 0.1;
+    if (std::isnan(opt.w_init)) opt.w_init = mst ? 1.0 : 0.0;
+    if (opt.suffix.empty()) opt.suffix = "_" + opt.algo;
+
+    if (opt.no_scale) {
+        opt.min_vals.clear();
+        opt.max_vals.clear();
+    } else if (!opt.scale_set && !mst) {
+        opt.min_vals = { 0., 0., 0., 0., -36. };
+        opt.max_vals = { 216.83813265, 6267.89629447, 265.92001187, 280.9220282, 127.99778524 };
+    }
+    if (opt.min_vals.size() != opt.max_vals.size())
+        throw std::invalid_argument("--min e --max devem ter o mesmo número de valores.");
+    for (size_t i = 0; i < opt.min_vals.size(); ++i) {
+        if (!(opt.max_vals[i] > opt.min_vals[i])) throw std::invalid_argument("--max deve ser maior que --min.");
+    }
+    return opt;
+}
+
+// <dir>/<nome sem extensão><sufixo><extra>.<csv|bin>
+static std::string output_path(const Options& opt, const std::string& input, const std::string& extra) {
+    size_t slash = input.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : input.substr(0, slash);
+    std::string name = slash == std::string::npos ? input : input.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) name = name.substr(0, dot);
+    if (!opt.output_dir.empty()) dir = opt.output_dir;
+    return dir + "/" + name + opt.suffix + extra + (opt.format == ResultFormat::Binary ? ".bin" : ".csv");
+}
+
+static bool starts_with(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Processa um arquivo do início ao fim; lança std::runtime_error em caso de erro.
+// Com metrics != nullptr, acumula detecção, distorção e latência (ns por amostra).
+static size_t process_file(const Options& opt, const std::string& input,
+                           std::string& output_file, std::string& diff_file,
+                           TEDARLSMetrics* metrics) {
+    CsvReader reader(input);
+    const std::vector<std::string>& header = reader.header();
+    if (header.empty()) throw std::runtime_error("Arquivo CSV vazio ou inválido: " + input);
+    auto find = [&](const std::string& name) -> int {
+        for (size_t i = 0; i < header.size(); ++i) if (header[i] == name) return (int)i;
+        return -1;
+    };
+
+    // índice de cada coluna usada
+    std::vector<size_t> cols;
+    std::vector<std::string> names;
+    if (opt.columns.empty()) {
+        for (size_t i = 0; i < header.size(); ++i) {
+            if (starts_with(header[i], "label") || starts_with(header[i], "clean_")) continue;
+            cols.push_back(i);
+            names.push_back(header[i]);
+        }
+    } else {
+        for (const auto& name : opt.columns) {
+            int i = find(name);
+            if (i < 0) throw std::runtime_error("Coluna " + name + " não encontrada em " + input);
+            cols.push_back(i);
+        }
+        names = opt.columns;
+    }
+
+    int n_features = (int)cols.size();
+    if (n_features == 0) throw std::runtime_error("Nenhuma coluna de entrada em " + input);
+    if (n_features > 32) throw std::runtime_error("Máximo de 32 features (máscara de outliers): " + input);
+
+    bool scale = !opt.min_vals.empty();
+    if (scale && opt.min_vals.size() != cols.size()) {
+        std::ostringstream msg;
+        msg << "Escalonador com " << opt.min_vals.size() << " valores para " << n_features
+            << " colunas em " << input;
+        throw std::runtime_error(msg.str());
+    }
+
+    bool mst = opt.algo == "mst";
+    output_file = output_path(opt, input, "");
+    diff_file = opt.diff ? output_path(opt, input, "_diff") : "";
+
+    // Colunas de saída no mesmo layout dos drivers
+    std::vector<ResultColumn> out_columns, diff_columns;
+    for (const auto& name : names) {
+        ResultColumn c;
+        c.name = mst ? name + "_corrected" : name;
+        c.fixed = !mst;
+        c.precision = mst ? 6 : 16;
+        out_columns.push_back(c);
+    }
+    for (const auto& name : names) {
+        ResultColumn c;
+        if (mst) {
+            c.name = "outlier_" + name;
+            c.type = ResultColumn::FLAG;
+        } else {
+            c.name = "y_" + name;
+            c.fixed = true;
+            c.precision = 16;
+        }
+        out_columns.push_back(c);
+    }
+    for (const auto& name : names) {
+        ResultColumn c;
+        c.name = name + "_diff";
+        diff_columns.push_back(c);
+    }
+
+    ResultWriter out(output_file, out_columns, opt.format);
+    std::unique_ptr<ResultWriter> out_diff;
+    if (opt.diff) out_diff.reset(new ResultWriter(diff_file, diff_columns, opt.format));
+
+    // colunas de rótulo e de sinal limpo para as métricas (-1 = ausente)
+    std::vector<int> label_cols(n_features, -1), clean_cols(n_features, -1);
+    int row_label = -1;
+    bool per_feature = false;
+    if (metrics) {
+        per_feature = true;
+        for (int i = 0; i < n_features; ++i) {
+            label_cols[i] = find("label_" + names[i]);
+            clean_cols[i] = find("clean_" + names[i]);
+            if (label_cols[i] < 0) per_feature = false;
+        }
+        row_label = find("label");
+    }
+
+    std::vector<double> x(n_features), raw(n_features), clean(n_features);
+    std::vector<double> out_row(2 * n_features), diff_row(n_features);
+    uint32_t label_mask = 0;
+    size_t n_rows = 0;
+
+    // lê a próxima linha: raw = colunas selecionadas, x = normalizada
+    auto next_row = [&]() {
+        if (!reader.next()) return false;
+        const double* row = reader.row();
+        for (int i = 0; i < n_features; ++i) {
+            raw[i] = row[cols[i]];
+            x[i] = scale ? (raw[i] - opt.min_vals[i]) / (opt.max_vals[i] - opt.min_vals[i]) : raw[i];
+        }
+        if (metrics) {
+            label_mask = 0;
+            for (int i = 0; i < n_features; ++i) {
+                clean[i] = clean_cols[i] >= 0 ? row[clean_cols[i]] : raw[i];
+                if (per_feature && row[label_cols[i]] != 0.0) label_mask |= 1u << i;
+            }
+            if (!per_feature && row_label >= 0 && row[row_label] != 0.0) label_mask = 1;
+        }
+        return true;
+    };
+    auto unscale = [&](int i, double v) {
+        return scale ? v * (opt.max_vals[i] - opt.min_vals[i]) + opt.min_vals[i] : v;
+    };
+
+    if (mst && metrics) {
+        // linha a linha para medir a latência de cada update(); mesma saída do lote
+        MSTEDARLS model(opt.threshold, opt.mu, opt.delta, opt.w_init, n_features, opt.correct);
+        if (opt.teda_window != TedaWindow::Cumulative) model.set_teda_window(opt.teda_window, opt.teda_param);
+        if (opt.ar_order > 0) model.set_ar_order(opt.ar_order, opt.ar_mu);
+        std::vector<double> corrected(n_features);
+        uint32_t mask = 0;
+
+        while (next_row()) {
+            metrics->time_call([&] { model.update(x.data(), corrected.data(), mask); });
+            for (int i = 0; i < n_features; ++i) {
+                double corr = unscale(i, corrected[i]);
+                out_row[i] = corr;
+                out_row[n_features + i] = (mask >> i) & 1u;
+                diff_row[i] = std::abs(corr - raw[i]);
+            }
+            if (per_feature) metrics->add_detection(mask, label_mask, n_features);
+            else metrics->add_detection(mask != 0, label_mask != 0);
+            metrics->add_error(out_row.data(), clean.data(), n_features);
+
+            out.append(out_row.data());
+            if (out_diff) out_diff->append(diff_row.data());
+            ++n_rows;
+        }
+    } else if (mst) {
+        MSTEDARLS model(opt.threshold, opt.mu, opt.delta, opt.w_init, n_features, opt.correct);
+        if (opt.teda_window != TedaWindow::Cumulative) model.set_teda_window(opt.teda_window, opt.teda_param);
+        if (opt.ar_order > 0) model.set_ar_order(opt.ar_order, opt.ar_mu);
+
+        std::vector<std::vector<double>> in_cols(n_features, std::vector<double>(CHUNK_ROWS));
+        std::vector<std::vector<double>> raw_cols(n_features, std::vector<double>(CHUNK_ROWS));
+        std::vector<std::vector<double>> corrected(n_features, std::vector<double>(CHUNK_ROWS));
+        std::vector<uint32_t> masks(CHUNK_ROWS);
+        std::vector<const double*> in_ptrs(n_features);
+        std::vector<double*> out_ptrs(n_features);
+        for (int i = 0; i < n_features; ++i) {
+            in_ptrs[i] = in_cols[i].data();
+            out_ptrs[i] = corrected[i].data();
+        }
+
+        bool more = true;
+        while (more) {
+            size_t chunk = 0;
+            while (chunk < CHUNK_ROWS && (more = next_row())) {
+                for (int i = 0; i < n_features; ++i) {
+                    in_cols[i][chunk] = x[i];
+                    raw_cols[i][chunk] = raw[i];
+                }
+                ++chunk;
+            }
+            if (chunk == 0) break;
+
+            model.process_batch(in_ptrs.data(), chunk, out_ptrs.data(), masks.data());
+
+            for (size_t r = 0; r < chunk; ++r) {
+                for (int i = 0; i < n_features; ++i) {
+                    double corr = unscale(i, corrected[i][r]);
+                    out_row[i] = corr;
+                    out_row[n_features + i] = (masks[r] >> i) & 1u;
+                    diff_row[i] = std::abs(corr - raw_cols[i][r]);
+                }
+                out.append(out_row.data());
+                if (out_diff) out_diff->append(diff_row.data());
+            }
+            n_rows += chunk;
+        }
+    } else {
+        MPTEDARLS model(opt.threshold, n_features, opt.mu, opt.delta,
+                        std::vector<double>(n_features, opt.w_init), opt.correct,
+                        opt.window_size, opt.window_limit, opt.per_dim, opt.ecc_div, opt.epsilon,
+                        opt.clip_output, opt.clip_weights, opt.output_clip, opt.weight_clip,
+                        opt.max_dw, false);
+        if (opt.teda_window != TedaWindow::Cumulative) model.setTedaWindow(opt.teda_window, opt.teda_param);
+        model.setRlsBackend(opt.rls_backend, opt.rls_trace_max);
+
+        std::vector<double> y_pred(n_features), x_filtered(n_features);
+        int flag = 0;
+        while (next_row()) {
+            if (metrics) metrics->time_call([&] { flag = model.run(x.data(), y_pred.data(), x_filtered.data()); });
+            else flag = model.run(x.data(), y_pred.data(), x_filtered.data());
+            for (int i = 0; i < n_features; ++i) {
+                double corr = unscale(i, x_filtered[i]);
+                out_row[i] = corr;
+                out_row[n_features + i] = unscale(i, y_pred[i]);
+                diff_row[i] = std::abs(corr - raw[i]);
+            }
+            if (metrics) {
+                metrics->add_detection(flag != 0, label_mask != 0);
+                metrics->add_error(out_row.data(), clean.data(), n_features);
+            }
+
+            out.append(out_row.data());
+            if (out_diff) out_diff->append(diff_row.data());
+            ++n_rows;
+        }
+    }
+
+    out.close();
+    if (out_diff) out_diff->close();
+    if (n_rows == 0) throw std::runtime_error("Arquivo CSV vazio ou inválido: " + input);
+    return n_rows;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    try {
+        opt = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Erro: " << e.what() << "\n\n" << USAGE;
+        return 1;
+    }
+
+    int n_threads = opt.threads > 0 ? opt.threads : (int)std::thread::hardware_concurrency();
+    if (n_threads <= 0) n_threads = 1;
+    if ((size_t)n_threads > opt.inputs.size()) n_threads = (int)opt.inputs.size();
+
+    // um arquivo por tarefa; mensagens agrupadas por arquivo para não intercalar
+    std::mutex log_mutex;
+    std::atomic<int> n_failed{0};
+    ThreadPool pool(n_threads);
+    pool.run(opt.inputs.size(), [&](size_t task) {
+        const std::string& input = opt.inputs[task];
+        std::ostringstream msg;
+        bool ok = true;
+        try {
+            std::string output_file, diff_file;
+            TEDARLSMetrics metrics;
+            size_t n_rows = process_file(opt, input, output_file, diff_file, opt.metrics ? &metrics : nullptr);
+            msg << input << ": " << n_rows << " linhas -> " << output_file;
+            if (!diff_file.empty()) msg << ", " << diff_file;
+            msg << "\n";
+            if (opt.metrics) {
+                char line[256];
+                metrics.format(line, sizeof(line));
+                msg << "  " << line << " (latência em ns)\n";
+            }
+        } catch (const std::exception& e) {
+            msg << "Erro: " << e.what() << "\n";
+            ok = false;
+            ++n_failed;
+        }
+        std::lock_guard<std::mutex> lock(log_mutex);
+        (ok ? std::cout : std::cerr) << msg.str();
+    });
+
+    if (n_failed > 0) {
+        std::cerr << n_failed << " de " << opt.inputs.size() << " arquivo(s) com erro." << std::endl;
+        return 1;
+    }
+    return 0;
+}
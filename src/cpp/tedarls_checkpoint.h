@@ -0,0 +1,107 @@
+#ifndef TEDARLS_CHECKPOINT_H
+#define TEDARLS_CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "tedarls_numeric.h"
+
+// Checkpoint binário do estado aprendido dos detectores (média/variância do TEDA,
+// pesos e covariâncias do RLS). Os hiperparâmetros não são salvos: o snapshot é
+// restaurado num modelo já construído com a mesma configuração. O MSTD grava a
+// janela do TEDA (modo e parâmetro), pois dela depende o significado da variância.
+//
+// Layout (bytes na ordem nativa, little-endian no ESP32 e no x86):
+//   magic[4] | versão u8 | tipo numérico u8 | n_dims u16 | payload | crc32 u32
+// O CRC-32 (IEEE 802.3) cobre tudo que vem antes dele.
+
+const uint8_t TEDARLS_CKPT_VERSION = 1;
+const size_t TEDARLS_CKPT_HEADER = 8;
+const size_t TEDARLS_CKPT_TRAILER = 4;
+
+template <typename T> struct tedarls_type_tag;
+template <> struct tedarls_type_tag<double> { static const uint8_t value = 1; };
+template <> struct tedarls_type_tag<float>  { static const uint8_t value = 2; };
+template <> struct tedarls_type_tag<q16_16> { static const uint8_t value = 3; };
+
+// CRC-32 bit a bit, sem tabela (poucos bytes de flash no ESP32)
+inline uint32_t tedarls_crc32(const uint8_t* data, size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; ++b) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+// Escrita sequencial; begin() grava o cabeçalho e finish() o CRC
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(uint8_t* buf) : buf_(buf), p_(buf) {}
+
+    void begin(const char magic[4], uint8_t type_tag, uint16_t n_dims) {
+        std::memcpy(p_, magic, 4);
+        p_[4] = TEDARLS_CKPT_VERSION;
+        p_[5] = type_tag;
+        p_ += 6;
+        put(n_dims);
+    }
+
+    template <typename V>
+    void put(const V& v) {
+        std::memcpy(p_, &v, sizeof(V));
+        p_ += sizeof(V);
+    }
+
+    size_t finish() {
+        uint32_t crc = tedarls_crc32(buf_, p_ - buf_);
+        put(crc);
+        return p_ - buf_;
+    }
+
+private:
+    uint8_t* buf_;
+    uint8_t* p_;
+};
+
+// Leitura sequencial; check() valida tamanho, CRC, magic, versão, tipo e dimensão
+// antes de qualquer get(), para que um snapshot inválido não altere o modelo
+class CheckpointReader {
+public:
+    CheckpointReader(const uint8_t* buf, size_t len) : buf_(buf), p_(buf), len_(len) {}
+
+    bool check(const char magic[4], uint8_t type_tag, uint16_t n_dims, size_t expected_len) {
+        if (!buf_ || len_ != expected_len || len_ < TEDARLS_CKPT_HEADER + TEDARLS_CKPT_TRAILER) {
+            return false;
+        }
+        uint32_t crc;
+        std::memcpy(&crc, buf_ + len_ - TEDARLS_CKPT_TRAILER, sizeof(crc));
+        if (crc != tedarls_crc32(buf_, len_ - TEDARLS_CKPT_TRAILER)) return false;
+
+        uint16_t n;
+        std::memcpy(&n, buf_ + 6, sizeof(n));
+        if (std::memcmp(buf_, magic, 4) != 0 || buf_[4] != TEDARLS_CKPT_VERSION ||
+            buf_[5] != type_tag || n != n_dims) {
+            return false;
+        }
+        p_ = buf_ + TEDARLS_CKPT_HEADER;
+        return true;
+    }
+
+    template <typename V>
+    V get() {
+        V v;
+        std::memcpy(&v, p_, sizeof(V));
+        p_ += sizeof(V);
+        return v;
+    }
+
+private:
+    const uint8_t* buf_;
+    const uint8_t* p_;
+    size_t len_;
+};
+
+#endif // TEDARLS_CHECKPOINT_H
@@ -0,0 +1,149 @@
+#ifndef TEDARLS_METRICS_H
+#define TEDARLS_METRICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+// Métricas incrementais de um detector, com memória O(1): matriz de confusão contra
+// rótulos de anomalias injetadas, MAE/RMSE entre sinal corrigido e limpo e histograma
+// de latência. Sem alocação, para uso nos drivers do host e no processOBD() do firmware.
+//
+// Latência em unidades livres (µs no ESP32 com micros(), ns no host com time_call()):
+// o bucket b conta amostras em [2^(b-1), 2^b), o bucket 0 conta latência 0.
+class TEDARLSMetrics {
+public:
+    static const int LATENCY_BUCKETS = 33;
+
+    TEDARLSMetrics() { reset(); }
+
+    void reset() {
+        tp_ = fp_ = fn_ = tn_ = 0;
+        err_count_ = 0;
+        abs_err_ = sq_err_ = max_err_ = 0.0;
+        lat_count_ = 0;
+        lat_sum_ = 0.0;
+        lat_max_ = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; ++b) lat_hist_[b] = 0;
+    }
+
+    // Detecção por feature: bit i das máscaras = outlier previsto/rotulado na feature i.
+    // Sem rótulos (no veículo), actual = 0: flagged() continua correto.
+    void add_detection(uint32_t predicted, uint32_t actual, int n) {
+        for (int i = 0; i < n; ++i) add_detection(((predicted >> i) & 1u) != 0, ((actual >> i) & 1u) != 0);
+    }
+
+    // Detecção por linha (ex.: flag global do MPT)
+    void add_detection(bool predicted, bool actual) {
+        if (predicted) { if (actual) ++tp_; else ++fp_; }
+        else           { if (actual) ++fn_; else ++tn_; }
+    }
+
+    // Distorção: n valores corrigidos contra o sinal limpo (ou a entrada, sem referência)
+    void add_error(const double* corrected, const double* clean, int n) {
+        for (int i = 0; i < n; ++i) {
+            double e = std::fabs(corrected[i] - clean[i]);
+            abs_err_ += e;
+            sq_err_ += e * e;
+            if (e > max_err_) max_err_ = e;
+        }
+        err_count_ += n;
+    }
+
+    void add_latency(uint32_t t) {
+        int b = 0;
+        while (b < LATENCY_BUCKETS - 1 && (t >> b) != 0) ++b;
+        ++lat_hist_[b];
+        ++lat_count_;
+        lat_sum_ += t;
+        if (t > lat_max_) lat_max_ = t;
+    }
+
+#ifndef ARDUINO
+    // Executa fn() e registra a latência em ns
+    template <typename Fn>
+    void time_call(Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        add_latency(ns > 0xFFFFFFFFll ? 0xFFFFFFFFu : (uint32_t)ns);
+    }
+#endif
+
+    // Soma os contadores de outro acumulador (ex.: um por thread)
+    void merge(const TEDARLSMetrics& o) {
+        tp_ += o.tp_; fp_ += o.fp_; fn_ += o.fn_; tn_ += o.tn_;
+        err_count_ += o.err_count_;
+        abs_err_ += o.abs_err_;
+        sq_err_ += o.sq_err_;
+        if (o.max_err_ > max_err_) max_err_ = o.max_err_;
+        lat_count_ += o.lat_count_;
+        lat_sum_ += o.lat_sum_;
+        if (o.lat_max_ > lat_max_) lat_max_ = o.lat_max_;
+        for (int b = 0; b < LATENCY_BUCKETS; ++b) lat_hist_[b] += o.lat_hist_[b];
+    }
+
+    uint64_t true_positives() const { return tp_; }
+    uint64_t false_positives() const { return fp_; }
+    uint64_t false_negatives() const { return fn_; }
+    uint64_t true_negatives() const { return tn_; }
+    uint64_t flagged() const { return tp_ + fp_; }
+    uint64_t detections() const { return tp_ + fp_ + fn_ + tn_; }
+
+    double precision() const { return tp_ + fp_ > 0 ? double(tp_) / double(tp_ + fp_) : 0.0; }
+    double recall() const { return tp_ + fn_ > 0 ? double(tp_) / double(tp_ + fn_) : 0.0; }
+    double f1() const {
+        double p = precision(), r = recall();
+        return p + r > 0 ? 2.0 * p * r / (p + r) : 0.0;
+    }
+
+    double mae() const { return err_count_ > 0 ? abs_err_ / double(err_count_) : 0.0; }
+    double rmse() const { return err_count_ > 0 ? std::sqrt(sq_err_ / double(err_count_)) : 0.0; }
+    double max_error() const { return max_err_; }
+
+    uint64_t latency_count() const { return lat_count_; }
+    double latency_mean() const { return lat_count_ > 0 ? lat_sum_ / double(lat_count_) : 0.0; }
+    uint32_t latency_max() const { return lat_max_; }
+
+    // Quantil q em [0, 1] estimado pelo histograma: interpolação linear dentro do bucket,
+    // limitada pela latência máxima observada
+    double latency_quantile(double q) const {
+        if (lat_count_ == 0) return 0.0;
+        double target = q * double(lat_count_);
+        uint64_t seen = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; ++b) {
+            if (lat_hist_[b] == 0) continue;
+            if (double(seen + lat_hist_[b]) >= target) {
+                if (b == 0) return 0.0;
+                double lo = std::ldexp(1.0, b - 1), hi = std::ldexp(1.0, b);
+                double v = lo + (hi - lo) * (target - double(seen)) / double(lat_hist_[b]);
+                return v < double(lat_max_) ? v : double(lat_max_);
+            }
+            seen += lat_hist_[b];
+        }
+        return double(lat_max_);
+    }
+
+    // Resumo numa linha; retorna o tamanho como snprintf
+    int format(char* buf, size_t len) const {
+        return std::snprintf(buf, len,
+            "n=%llu flagged=%llu P=%.4f R=%.4f F1=%.4f MAE=%.6g RMSE=%.6g lat p50=%.0f p99=%.0f max=%lu",
+            (unsigned long long)detections(), (unsigned long long)flagged(), precision(), recall(), f1(),
+            mae(), rmse(), latency_quantile(0.5), latency_quantile(0.99), (unsigned long)lat_max_);
+    }
+
+private:
+    uint64_t tp_, fp_, fn_, tn_;
+    uint64_t err_count_;
+    double abs_err_, sq_err_, max_err_;
+    uint64_t lat_count_;
+    double lat_sum_;
+    uint32_t lat_max_;
+    uint32_t lat_hist_[LATENCY_BUCKETS];
+};
+
+#endif // TEDARLS_METRICS_H
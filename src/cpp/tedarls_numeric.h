@@ -0,0 +1,124 @@
+#ifndef TEDARLS_NUMERIC_H
+#define TEDARLS_NUMERIC_H
+
+#include <cstdint>
+#include <cmath>
+
+// Tipos numéricos para MSTEDARLSFixed<N, T> e MPTEDARLSBasic<T>:
+//   double  - referência
+//   float   - usa a FPU de precisão simples do ESP32 (sem emulação em software)
+//   q16_16  - ponto fixo Q16.16 com saturação, para alvos sem FPU
+//
+// Q16.16 cobre [-32768, 32768) com resolução 2^-16 (~1.5e-5). Por isso as entradas
+// devem estar normalizadas (ex.: min-max em [0, 1], como o MPTEDARLS já usa); com
+// valores brutos (rpm ~ 6000) a variância acumulada satura.
+
+// Ponto fixo Q16.16 com saturação em todas as operações (nunca dá wrap-around)
+class q16_16 {
+public:
+    static const int FRAC_BITS = 16;
+
+    q16_16() : raw_(0) {}
+    q16_16(double v) : raw_(from_double(v)) {}
+
+    static q16_16 from_raw(int32_t r) {
+        q16_16 q;
+        q.raw_ = r;
+        return q;
+    }
+
+    int32_t raw() const { return raw_; }
+    double to_double() const { return raw_ / 65536.0; }
+    explicit operator double() const { return to_double(); }
+    explicit operator float() const { return float(to_double()); }
+
+    q16_16& operator+=(q16_16 o) { raw_ = sat(int64_t(raw_) + o.raw_); return *this; }
+    q16_16& operator-=(q16_16 o) { raw_ = sat(int64_t(raw_) - o.raw_); return *this; }
+    q16_16& operator*=(q16_16 o) {
+        // arredonda para o mais próximo
+        raw_ = sat((int64_t(raw_) * o.raw_ + (int64_t(1) << (FRAC_BITS - 1))) >> FRAC_BITS);
+        return *this;
+    }
+    q16_16& operator/=(q16_16 o) {
+        if (o.raw_ == 0) {
+            raw_ = raw_ >= 0 ? INT32_MAX : INT32_MIN;  // divisão por zero satura
+        } else {
+            raw_ = sat((int64_t(raw_) * (int64_t(1) << FRAC_BITS)) / o.raw_);
+        }
+        return *this;
+    }
+
+    friend q16_16 operator+(q16_16 a, q16_16 b) { return a += b; }
+    friend q16_16 operator-(q16_16 a, q16_16 b) { return a -= b; }
+    friend q16_16 operator*(q16_16 a, q16_16 b) { return a *= b; }
+    friend q16_16 operator/(q16_16 a, q16_16 b) { return a /= b; }
+    friend q16_16 operator-(q16_16 a) { return from_raw(sat(-int64_t(a.raw_))); }
+
+    friend bool operator==(q16_16 a, q16_16 b) { return a.raw_ == b.raw_; }
+    friend bool operator!=(q16_16 a, q16_16 b) { return a.raw_ != b.raw_; }
+    friend bool operator<(q16_16 a, q16_16 b) { return a.raw_ < b.raw_; }
+    friend bool operator>(q16_16 a, q16_16 b) { return a.raw_ > b.raw_; }
+    friend bool operator<=(q16_16 a, q16_16 b) { return a.raw_ <= b.raw_; }
+    friend bool operator>=(q16_16 a, q16_16 b) { return a.raw_ >= b.raw_; }
+
+private:
+    static int32_t sat(int64_t v) {
+        if (v > INT32_MAX) return INT32_MAX;
+        if (v < INT32_MIN) return INT32_MIN;
+        return int32_t(v);
+    }
+
+    static int32_t from_double(double v) {
+        if (v != v) return 0;  // NaN
+        double r = std::floor(v * 65536.0 + 0.5);
+        if (r >= 2147483647.0) return INT32_MAX;
+        if (r <= -2147483648.0) return INT32_MIN;
+        return int32_t(r);
+    }
+
+    int32_t raw_;
+};
+
+inline q16_16 abs(q16_16 a) { return a < q16_16() ? -a : a; }
+
+// Raiz quadrada inteira sobre o valor bruto (negativos retornam 0)
+inline q16_16 sqrt(q16_16 a) {
+    if (a.raw() <= 0) return q16_16();
+    uint64_t v = uint64_t(a.raw()) << q16_16::FRAC_BITS;
+    uint64_t r = 0;
+    uint64_t bit = uint64_t(1) << 62;
+    while (bit > v) bit >>= 2;
+    while (bit != 0) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return q16_16::from_raw(int32_t(r));
+}
+
+// Salvaguardas numéricas por tipo, aplicadas no construtor dos modelos:
+//   min_epsilon: piso para o epsilon usado em max(sigma², epsilon) no TEDA e em
+//                max(rls_mu + xᵀPx, epsilon) no rlsUpdateAll. Em Q16.16 um epsilon
+//                de 1e-6 vira 0 e a divisão satura; 2^-12 ainda mantém
+//                dist²/(k·epsilon) dentro da faixa para entradas normalizadas.
+// Os clippings de saída, de pesos e de ||dw|| (max_dw) continuam valendo para todos os
+// tipos e são o que impede P/pesos de divergirem em float e Q16.16.
+template <typename T>
+struct tedarls_numeric {
+    static T min_epsilon() { return T(0); }
+};
+
+template <>
+struct tedarls_numeric<q16_16> {
+    static q16_16 min_epsilon() { return q16_16::from_raw(1 << 4); }  // 2^-12
+};
+
+// Conversão explícita para double (trace, histórico, comparação)
+template <typename T>
+inline double tedarls_to_double(T v) { return double(v); }
+
+#endif // TEDARLS_NUMERIC_H
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include "mptedarls.h"
+#include "mptedarls_reference.h"
+#include "csv_reader.h"
+
+// Teste de regressão da atualização do RLS (ctest -R rls_update):
+// ./test_rls_update [--tol 1e-12] arquivo.csv ...
+//
+// Roda o MPTEDARLS atual (W/P contíguos, atualização de posto 1 in-place) e a
+// implementação anterior (mptedarls_reference.h) lado a lado, com os
+// hiperparâmetros de main_mptedarls, TEDA global e por dimensão. Falha se alguma
+// flag de outlier divergir ou se predição/valor corrigido (escala normalizada, a
+// saída do modelo) diferir mais que a tolerância. Também informa o maior desvio
+// em unidades originais.
+
+static const double MIN_VALS[] = { 0., 0., 0., 0., -36. };
+static const double MAX_VALS[] = { 216.83813265, 6267.89629447, 265.92001187, 280.9220282, 127.99778524 };
+static const int N_FEATURES = 5;
+
+struct Deviation {
+    double norm = 0.0;     // escala normalizada
+    double orig = 0.0;     // unidades originais
+    size_t flag_mismatch = 0;
+    size_t samples = 0;
+};
+
+static Deviation compare(const std::string& file, bool per_dim) {
+    MPTEDARLS model(5.592, N_FEATURES, 0.9249, 0.1, std::vector<double>(N_FEATURES, 0.0),
+                    true, 0, 5, per_dim, 6.0, 1e-6, true, true,
+                    {-100.0, 100.0}, {-100.0, 100.0}, 10.0, false);
+    MPTEDARLSReference ref(5.592, N_FEATURES, 0.9249, 0.1, std::vector<double>(N_FEATURES, 0.0),
+                           true, 0, 5, per_dim, 6.0, 1e-6, true, true,
+                           {-100.0, 100.0}, {-100.0, 100.0}, 10.0, false);
+
+    CsvReader reader(file);
+    if ((int)reader.columns() != N_FEATURES) {
+        throw std::runtime_error(file + ": esperadas 5 colunas (speed, rpm, tp, load, timing).");
+    }
+
+    Deviation dev;
+    std::vector<double> x(N_FEATURES), y(N_FEATURES), xf(N_FEATURES);
+    while (reader.next()) {
+        const double* row = reader.row();
+        for (int i = 0; i < N_FEATURES; ++i)
+            x[i] = (row[i] - MIN_VALS[i]) / (MAX_VALS[i] - MIN_VALS[i]);
+
+        int flag = model.run(x.data(), y.data(), xf.data());
+        MPTEDARLSReference::RunResult r = ref.run(x);
+
+        if (flag != r.outlier_flag) ++dev.flag_mismatch;
+        for (int i = 0; i < N_FEATURES; ++i) {
+            double range = MAX_VALS[i] - MIN_VALS[i];
+            double d = std::max(std::abs(y[i] - r.y_pred[i]), std::abs(xf[i] - r.x_filtered[i]));
+            dev.norm = std::max(dev.norm, d);
+            dev.orig = std::max(dev.orig, d * range);
+        }
+        ++dev.samples;
+    }
+    return dev;
+}
+
+int main(int argc, char** argv) {
+    double tol = 1e-12;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tol" && i + 1 < argc) {
+            tol = std::stod(argv[++i]);
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
+        files = { "../../data/dados_sem_outliers_fastback.csv", "../../data/dados_sem_outliers_polo.csv" };
+    }
+
+    int failures = 0;
+    try {
+        for (const std::string& file : files) {
+            for (bool per_dim : { false, true }) {
+                Deviation dev = compare(file, per_dim);
+                bool ok = dev.samples > 0 && dev.flag_mismatch == 0 && dev.norm <= tol;
+                std::cout << (ok ? "OK    " : "FALHA ") << file << (per_dim ? " (TEDA por dimensão)" : " (TEDA global)")
+                          << ": " << dev.samples << " amostras, flags divergentes " << dev.flag_mismatch
+                          << ", desvio máx. " << dev.norm << " (normalizado), " << dev.orig << " (unidades originais)\n";
+                if (!ok) ++failures;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Erro: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << (failures ? "Falhou" : "Passou") << " (tolerância " << tol << ")\n";
+    return failures ? 1 : 0;
+}
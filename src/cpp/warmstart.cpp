@@ -0,0 +1,157 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include "mstedarls_fixed.h"
+#include "mptedarls.h"
+
+// Para compilar: g++ -std=c++17 -O2 warmstart.cpp -o warmstart
+// Uso: ./warmstart [-o prefixo] [--header arquivo.h] viagem1.csv [viagem2.csv ...]
+//
+// Reproduz viagens históricas (colunas speed, rpm, tp, load, timing) pelos detectores
+// com a mesma configuração do telelogger e grava snapshots de partida a quente:
+//   <prefixo>_mst.bin, <prefixo>_mpt.bin  - checkpoints binários (deserialize())
+//   --header arquivo.h                      - os mesmos bytes como arrays C, para o
+//                                             firmware usar quando a NVS estiver vazia
+
+static const int N_FEATURES = 5;
+
+// Escalonador min-max do telelogger (X_norm = (X - min) * scale)
+static const double min_values[N_FEATURES] = { 0., 0., 0., 0., -36. };
+static const double scale_values[N_FEATURES] = { 0.00461173, 0.00015954, 0.00376053, 0.00355971, 0.00609764 };
+
+std::vector<std::vector<double>> load_csv(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) throw std::runtime_error("Erro ao abrir arquivo: " + filename);
+
+    std::vector<std::vector<double>> data;
+    std::string line;
+    std::getline(file, line); // Ignora cabeçalho
+
+    while (std::getline(file, line)) {
+        std::vector<double> row;
+        std::istringstream ss(line);
+        std::string token;
+        while ((int)row.size() < N_FEATURES && std::getline(ss, token, ',')) {
+            try {
+                row.push_back(std::stod(token));
+            } catch (...) {
+                row.push_back(0.0);
+            }
+        }
+        if (row.empty()) continue;
+        row.resize(N_FEATURES, 0.0);
+        data.push_back(row);
+    }
+    return data;
+}
+
+bool write_binary(const std::string& filename, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) return false;
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return out.good();
+}
+
+void write_array(std::ofstream& out, const char* name, const std::vector<uint8_t>& bytes) {
+    out << "static const uint8_t " << name << "[" << bytes.size() << "] = {";
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        if (i % 16 == 0) out << "\n   ";
+        char hex[8];
+        std::snprintf(hex, sizeof(hex), " 0x%02x,", bytes[i]);
+        out << hex;
+    }
+    out << "\n};\n";
+}
+
+int main(int argc, char** argv) {
+    std::string prefix = "warmstart";
+    std::string header_file;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) prefix = argv[++i];
+        else if (std::strcmp(argv[i], "--header") == 0 && i + 1 < argc) header_file = argv[++i];
+        else files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        std::cerr << "Uso: " << argv[0] << " [-o prefixo] [--header arquivo.h] viagem1.csv [viagem2.csv ...]\n";
+        return 1;
+    }
+
+    // mesma configuração do telelogger.ino
+    MSTEDARLSFixed<N_FEATURES, double> mst(8.414, 0.7, 1000.0, 1.0, true);
+    MPTEDARLS mpt(5.592, N_FEATURES, 0.9249, 0.1, std::vector<double>(N_FEATURES, 0.0),
+                  true, 0, 5, false, 6.0, 1e-6, true, true,
+                  {-100.0, 100.0}, {-100.0, 100.0}, 10.0, false);
+
+    size_t total_rows = 0;
+    for (const auto& file : files) {
+        std::vector<std::vector<double>> data;
+        try {
+            data = load_csv(file);
+        } catch (const std::exception& e) {
+            std::cerr << "Erro: " << e.what() << std::endl;
+            return 1;
+        }
+
+        double out[N_FEATURES];
+        uint32_t mask = 0;
+        std::vector<double> x_norm(N_FEATURES);
+        for (const auto& row : data) {
+            mst.update(row.data(), out, mask);
+            for (int i = 0; i < N_FEATURES; ++i) x_norm[i] = (row[i] - min_values[i]) * scale_values[i];
+            mpt.run(x_norm);
+        }
+        total_rows += data.size();
+        std::cout << file << ": " << data.size() << " linhas\n";
+    }
+
+    std::vector<uint8_t> mst_bytes(mst.serialized_size());
+    std::vector<uint8_t> mpt_bytes(mpt.serializedSize());
+    mst.serialize(mst_bytes.data());
+    mpt.serialize(mpt_bytes.data());
+
+    // confere a volta: restaurar num modelo novo e serializar de novo dá os mesmos bytes
+    MSTEDARLSFixed<N_FEATURES, double> mst_check(8.414, 0.7, 1000.0, 1.0, true);
+    MPTEDARLS mpt_check(5.592, N_FEATURES, 0.9249, 0.1, std::vector<double>(N_FEATURES, 0.0),
+                        true, 0, 5, false, 6.0, 1e-6, true, true,
+                        {-100.0, 100.0}, {-100.0, 100.0}, 10.0, false);
+    std::vector<uint8_t> check_mst(mst_bytes.size()), check_mpt(mpt_bytes.size());
+    if (!mst_check.deserialize(mst_bytes.data(), mst_bytes.size()) ||
+        !mpt_check.deserialize(mpt_bytes.data(), mpt_bytes.size())) {
+        std::cerr << "Erro: snapshot gerado não pôde ser restaurado." << std::endl;
+        return 1;
+    }
+    mst_check.serialize(check_mst.data());
+    mpt_check.serialize(check_mpt.data());
+    if (check_mst != mst_bytes || check_mpt != mpt_bytes) {
+        std::cerr << "Erro: snapshot restaurado difere do original." << std::endl;
+        return 1;
+    }
+
+    if (!write_binary(prefix + "_mst.bin", mst_bytes) || !write_binary(prefix + "_mpt.bin", mpt_bytes)) {
+        std::cerr << "Erro ao gravar os snapshots." << std::endl;
+        return 1;
+    }
+    std::cout << total_rows << " amostras -> " << prefix << "_mst.bin (" << mst_bytes.size() << " bytes), "
+              << prefix << "_mpt.bin (" << mpt_bytes.size() << " bytes)\n";
+
+    if (!header_file.empty()) {
+        std::ofstream out(header_file);
+        if (!out.is_open()) {
+            std::cerr << "Erro ao criar: " << header_file << std::endl;
+            return 1;
+        }
+        out << "// Gerado por warmstart a partir de " << files.size() << " viagem(ns), "
+            << total_rows << " amostras\n";
+        out << "#include <stdint.h>\n\n";
+        write_array(out, "warmstart_mst", mst_bytes);
+        out << "\n";
+        write_array(out, "warmstart_mpt", mpt_bytes);
+        std::cout << "Arrays C gravados em " << header_file << "\n";
+    }
+    return 0;
+}